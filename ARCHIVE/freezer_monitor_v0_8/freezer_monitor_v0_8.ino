@@ -18,6 +18,7 @@
 #include <RFM12B.h>
 #include <OneWire.h>
 #include <DallasTemperature.h>
+#include <DallasConverter.h>
 #include <TimerOne.h>
 #include <EmBencode.h>
 
@@ -56,18 +57,18 @@ struct SensorData {
   boolean status;
   unsigned int ldr;
   unsigned int hall;
-  float tempInsideC;
-  float tempOutsideC;
+  temp_q4_t tempInside;
+  temp_q4_t tempOutside;
   float batteryVoltage;
 };
 
 struct SensorThresholds {
   unsigned int light;
   unsigned int door;
-  float minTempInsideC;
-  float maxTempInsideC;
-  float minTempOutsideC;
-  float maxTempOutsideC;
+  temp_q4_t minTempInside;
+  temp_q4_t maxTempInside;
+  temp_q4_t minTempOutside;
+  temp_q4_t maxTempOutside;
 };
 
 // rfm12b radio
@@ -76,10 +77,15 @@ char buffer[BUFFER_SIZE];
 long lastPeriod = -1;
 
 // dallas onewire configuration
+#define THERMOMETER_INSIDE  0
+#define THERMOMETER_OUTSIDE 1
 OneWire oneWire(DPIN_ONEWIRE);
-DallasTemperature oneWireSensors(&oneWire);
-DeviceAddress thermometerInside  = { 0x28, 0xC3, 0x42, 0x77, 0x03, 0x00, 0x00, 0x78 };
-DeviceAddress thermometerOutside  = { 0x10, 0x74, 0x6C, 0x53, 0x02, 0x08, 0x00, 0xE6 };
+DeviceAddress thermometers[] = {
+  { 0x28, 0xC3, 0x42, 0x77, 0x03, 0x00, 0x00, 0x78 },  // inside
+  { 0x10, 0x74, 0x6C, 0x53, 0x02, 0x08, 0x00, 0xE6 }   // outside
+};
+DallasConverter oneWireSensors(oneWire, thermometers, 2);
+temp_q4_t temperatures[2] = { TEMP_Q4_INVALID, TEMP_Q4_INVALID };
 
 // container for sensor data
 SensorData sensorData;
@@ -174,10 +180,10 @@ int check_status() {
   if (sensorData.hall == sensorThresholds.door) {
     status = LOW;
   }
-  if (sensorData.tempInsideC < sensorThresholds.minTempInsideC) {
+  if (sensorData.tempInside < sensorThresholds.minTempInside) {
     status = LOW;
   }
-  if (sensorData.tempInsideC > sensorThresholds.maxTempInsideC) {
+  if (sensorData.tempInside > sensorThresholds.maxTempInside) {
     status = LOW;
   }
   return status;
@@ -193,10 +199,12 @@ void log() {
   Serial.print(", Hall: "); 
   Serial.print(sensorData.hall);
   Serial.print(", Temp: "); 
-  Serial.print(sensorData.tempInsideC);
-  Serial.print("C, "); 
-  Serial.print(sensorData.tempOutsideC);
-  Serial.print("C");
+  Serial.print(DallasConverter::toCentiC(sensorData.tempInside));
+  Serial.print("cC, "); 
+  Serial.print(DallasConverter::toCentiC(sensorData.tempOutside));
+  Serial.print("cC (awake ");
+  Serial.print(oneWireSensors.awakeMicros());
+  Serial.print("us)");
   Serial.print(", Battery: "); 
   Serial.println(sensorData.batteryVoltage);
 }
@@ -214,10 +222,14 @@ void interogate_sensors() {
   // read door status
   sensorData.hall = digitalRead(DPIN_HALL);
   
-  // read one-wire sensors
-  oneWireSensors.requestTemperatures();
-  sensorData.tempInsideC = oneWireSensors.getTempC(thermometerInside);
-  sensorData.tempOutsideC = oneWireSensors.getTempC(thermometerOutside);
+  // collect the conversion started on the previous tick, then start the next
+  // one; the timer period outlasts the conversion, so nothing waits on it
+  if (oneWireSensors.done()) {
+    oneWireSensors.read(temperatures);
+  }
+  oneWireSensors.start();
+  sensorData.tempInside = temperatures[THERMOMETER_INSIDE];
+  sensorData.tempOutside = temperatures[THERMOMETER_OUTSIDE];
   
   // read battery voltage
   int val = analogRead(APIN_BATTERY);
@@ -238,8 +250,8 @@ void send_reading(unsigned int command) {
   
     // assemble sensor reading message
     int batteryVoltage = int(sensorData.batteryVoltage * 100);
-    int tempInsideC = int(sensorData.tempInsideC * 100);
-    int tempOutsideC = int(sensorData.tempOutsideC * 100);
+    int tempInsideC = DallasConverter::toCentiC(sensorData.tempInside);
+    int tempOutsideC = DallasConverter::toCentiC(sensorData.tempOutside);
     
     buffer[0] = '\0';
     EmBencode encoder;
@@ -15,9 +15,27 @@
 #define LOOP_MULTIPLIER   10
 #define ALTER_MULTIPLIER  2
 
+#define BATTERY_DEADBAND  2   // battery: 0..255
+#define TEMP_DEADBAND     1   // temperature: C
+#define LIGHT_DEADBAND    16  // light: 0..255
+#define HEARTBEAT         30  // max cycles between reports
+#define ALERT_HEARTBEAT   1   // max cycles between reports while door is open
+
+// lowest and highest value accepted over the air, per key from
+// CONFIG_KEY_FIRST; a multiplier of 0 would stop the mote sleeping
+static const byte limits[][2] = {
+  { 1, 255 },                 // loopMultiplier: seconds
+  { 1, 255 },                 // alertMultiplier: seconds
+  { 0, 255 },                 // batteryDeadband
+  { 0, 255 },                 // tempDeadband
+  { 0, 255 },                 // lightDeadband
+  { 1, 255 },                 // heartbeat: cycles
+  { 1, 255 },                 // alertHeartbeat: cycles
+};
+
 
 //-----------------------------------------------------------------------------
-Config::Config(bool init) {
+Config::Config(bool init) : _store(EEPROM, CONFIG_VERSION) {
   if (init) {
     initConfig();
     storeConfig();
@@ -33,6 +51,11 @@ void Config::initConfig() {
   rfFrequency = FREQUENCY;
   loopMultiplier = LOOP_MULTIPLIER;
   alertMultiplier = ALTER_MULTIPLIER;
+  batteryDeadband = BATTERY_DEADBAND;
+  tempDeadband = TEMP_DEADBAND;
+  lightDeadband = LIGHT_DEADBAND;
+  heartbeat = HEARTBEAT;
+  alertHeartbeat = ALERT_HEARTBEAT;
 }
 
 //-----------------------------------------------------------------------------
@@ -40,15 +63,61 @@ void Config::loadConfig() {
   #if DEBUG
     Serial.print("loading configuration from eeprom...");
   #endif
-  rfNodeId = EEPROM.read(0);
-  rfNetworkId = EEPROM.read(1);
-  rfGatewayId = EEPROM.read(2);
-  rfFrequency = EEPROM.read(3);
-  loopMultiplier = EEPROM.read(4);
-  alertMultiplier = EEPROM.read(5);
-  #if DEBUG
-    Serial.println("ok!");
-  #endif
+  if (_store.load(*this)) {
+    #if DEBUG
+      Serial.println("ok!");
+    #endif
+  } else if (loadLegacy()) {
+    #if DEBUG
+      Serial.println("migrated from the raw layout");
+    #endif
+    storeConfig();
+  } else {
+    #if DEBUG
+      Serial.println("invalid, using defaults");
+    #endif
+    initConfig();
+    storeConfig();
+  }
+}
+
+//-----------------------------------------------------------------------------
+// Motes flashed before ConfigStore kept their radio identity and multipliers
+// as raw bytes at EEPROM 0..5, in ConfigData order. Takes them when they are
+// plausible, so an upgraded mote keeps its node id and frequency; the fields
+// added since come from the defaults. Must run before the first store(),
+// which overwrites those cells.
+//
+bool Config::loadLegacy() {
+  byte raw[LEGACY_CONFIG_SIZE];
+  for (byte i = 0; i < LEGACY_CONFIG_SIZE; i++) {
+    raw[i] = EEPROM.read(i);
+  }
+  // slot 0 of a damaged ConfigStore record, not a raw layout
+  if (raw[0] == CONFIG_STORE_MAGIC && raw[1] == CONFIG_VERSION) {
+    return false;
+  }
+  if (raw[0] == 0 || raw[0] == RF69_BROADCAST_ADDR
+      || raw[1] == 0xFF
+      || raw[2] == 0 || raw[2] == RF69_BROADCAST_ADDR || raw[2] == raw[0]) {
+    return false;
+  }
+  if (raw[3] != RF69_315MHZ && raw[3] != RF69_433MHZ
+      && raw[3] != RF69_868MHZ && raw[3] != RF69_915MHZ) {
+    return false;
+  }
+  initConfig();
+  rfNodeId = raw[0];
+  rfNetworkId = raw[1];
+  rfGatewayId = raw[2];
+  rfFrequency = raw[3];
+  for (byte key = CONFIG_KEY_FIRST; key < LEGACY_CONFIG_SIZE; key++) {
+    const byte* limit = limits[key - CONFIG_KEY_FIRST];
+    if (raw[key] >= limit[0] && raw[key] <= limit[1]) {
+      ((byte*) (ConfigData*) this)[key] = raw[key];
+    }
+  }
+  return true;
 }
 
 //-----------------------------------------------------------------------------
@@ -56,14 +125,35 @@ void Config::storeConfig() {
   #if DEBUG
     Serial.print("storing configuration to eeprom...");
   #endif
-  EEPROM.write(0, rfNodeId);
-  EEPROM.write(1, rfNetworkId);
-  EEPROM.write(2, rfGatewayId);
-  EEPROM.write(3, rfFrequency);
-  EEPROM.write(4, loopMultiplier);
-  EEPROM.write(5, alertMultiplier);
+  boolean written = _store.store(*this);
   #if DEBUG
-    Serial.println("ok!");
+    Serial.println(written ? "ok!" : "unchanged");
   #endif
 }
 
+//-----------------------------------------------------------------------------
+bool Config::get(byte key, byte* value) {
+  if (key > CONFIG_KEY_LAST) {
+    return false;
+  }
+  *value = ((byte*) (ConfigData*) this)[key];
+  return true;
+}
+
+//-----------------------------------------------------------------------------
+// Writes a key settable over the air; false for any other key, or a value
+// outside the key's limits.
+//
+bool Config::set(byte key, byte value) {
+  if (key < CONFIG_KEY_FIRST || key > CONFIG_KEY_LAST
+      || (byte) (key - CONFIG_KEY_FIRST) >= sizeof(limits) / sizeof(limits[0])) {
+    return false;
+  }
+  const byte* limit = limits[key - CONFIG_KEY_FIRST];
+  if (value < limit[0] || value > limit[1]) {
+    return false;
+  }
+  ((byte*) (ConfigData*) this)[key] = value;
+  storeConfig();
+  return true;
+}
@@ -7,22 +7,44 @@
 #define Config_h
 
 #include "Arduino.h"
+#include <ConfigStore.h>
 #include <EEPROM.h>
 #include <RFM69.h>
 
-class Config {
+#define CONFIG_VERSION      1   // bump whenever ConfigData changes layout
+#define LEGACY_CONFIG_SIZE  6   // raw bytes at EEPROM 0 before ConfigStore
+
+typedef struct {
+  byte rfNodeId;
+  byte rfNetworkId;
+  byte rfGatewayId;
+  byte rfFrequency;
+  byte loopMultiplier;
+  byte alertMultiplier;
+  byte batteryDeadband;
+  byte tempDeadband;
+  byte lightDeadband;
+  byte heartbeat;
+  byte alertHeartbeat;
+} ConfigData;
+
+// over-the-air config keys are byte offsets into ConfigData; the radio
+// identity (node, network, gateway, frequency) is not settable over the air
+#define CONFIG_KEY_FIRST   4
+#define CONFIG_KEY_LAST    (sizeof(ConfigData) - 1)
+
+class Config : public ConfigData {
   public:
     Config(bool init);
     void loadConfig();
     void storeConfig();
-    byte rfNodeId;
-    byte rfNetworkId;
-    byte rfGatewayId;
-    byte rfFrequency;
-    byte loopMultiplier;
-    byte alertMultiplier;
+    bool get(byte key, byte* value);
+    bool set(byte key, byte value);
   protected:
     void initConfig();
+    bool loadLegacy();
+  private:
+    ConfigStore<ConfigData, EEPROMClass> _store;
 };
 
 #endif
@@ -5,6 +5,7 @@
 */
 #include "Sensors.h"
 #include "Reading.h"
+#include <AdcSampler.h>
 
 #define DEBUG               1
 
@@ -19,9 +20,16 @@
 #define TEMP_OUTSIDE_PIN     A3
 #define TEMP_OUTSIDE_PERIOD  500
 
-#define VOLTAGE              3.3
+#define VOLTAGE_MV           3300
 #define SUPPLY_VOLTAGE       6
 
+// analog channels are acquired together in one noise-reduced batch per cycle
+static const byte analogPins[] = { 
+  BATTERY_PIN, LIGHT_PIN, TEMP_INSIDE_PIN, TEMP_OUTSIDE_PIN 
+};
+#define ANALOG_CHANNELS      sizeof(analogPins)
+static adc_q16_t analogValues[ANALOG_CHANNELS];
+
 //-----------------------------------------------------------------------------
 Sensors::Sensors() {
   #if DEBUG
@@ -43,6 +51,7 @@ Sensors::Sensors() {
 
 //-----------------------------------------------------------------------------
 void Sensors::measure() {
+  Adc.sample(analogPins, analogValues, ANALOG_CHANNELS);
   _battery->measure();
   _door->measure();
   _light->measure();
@@ -75,7 +84,7 @@ void Sensors::report(SensorData* sensorData) {
 
 //-----------------------------------------------------------------------------
 int Sensors::readBattery(byte pin) {
-  return map(analogRead(pin), 0, 1023, 0, 255);
+  return AdcSampler::toByte(readAnalog(pin));
 }
 
 //-----------------------------------------------------------------------------
@@ -85,14 +94,23 @@ int Sensors::readDoor(byte pin) {
 
 //-----------------------------------------------------------------------------
 int Sensors::readLight(byte pin) {
-  return map(analogRead(pin), 0, 1023, 0, 255);
+  return AdcSampler::toByte(readAnalog(pin));
 }
 
 //-----------------------------------------------------------------------------
 int Sensors::readTemp(byte pin) {
-  int tempRaw = analogRead(pin);
-  float tempVolts = (((float)tempRaw / 1024) * VOLTAGE);
-  return int((tempVolts - 0.5) / 0.01);
+  int tempMillivolts = AdcSampler::toMillivolts(readAnalog(pin), VOLTAGE_MV);
+  return (tempMillivolts - 500) / 10;
+}
+
+//-----------------------------------------------------------------------------
+adc_q16_t Sensors::readAnalog(byte pin) {
+  for (byte i = 0; i < ANALOG_CHANNELS; i++) {
+    if (analogPins[i] == pin) {
+      return analogValues[i];
+    }
+  }
+  return 0;
 }
 
 
@@ -8,6 +8,7 @@
 
 #include "Arduino.h"
 #include "Reading.h"
+#include <AdcSampler.h>
 
 typedef struct SensorData {
   byte battery;      // battery voltage
@@ -32,6 +33,7 @@ class Sensors {
     static int readDoor(byte pin);
     static int readLight(byte pin);
     static int readTemp(byte pin);
+    static adc_q16_t readAnalog(byte pin);
 };
 
 #endif
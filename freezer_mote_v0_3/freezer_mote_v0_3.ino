@@ -14,11 +14,21 @@
  
    Created 13-APR-2015 by Jon Brule
 ----------------------------------------------------------------------------- */
+#include <AdcSampler.h>
+#include <ChannelPlan.h>
+#include <ConfigStore.h>
 #include <EEPROM.h>
+#include <EnergyMeter.h>
 #include <LowPower.h>
+#include <MeshRouter.h>
 #include <Message.h>
+#include <PowerControl.h>
 #include <RFM69.h>
 #include <Reading.h>
+#include <ReportPolicy.h>
+#include <SleepManager.h>
+#include <SleepManagerPCINT.h>
+#include <SlotSchedule.h>
 #include <SPI.h>
 #include "Config.h"
 #include "Sensors.h"
@@ -29,19 +39,63 @@
 #define SERIAL     1
 #define DEBUG      1
 #define BAUD_RATE  9600
+#define LISTEN_MODE 0   // set to 1 to hear gateway commands while asleep (RFM69 listen mode, about 20-30uA more)
+#define CHANNEL_PLAN 0  // set to 1 to take the channel the gateway assigns (see ChannelPlan)
+#define MESH       0    // set to 1 to report through a repeater when the gateway is out of reach (see MeshRouter)
+#define SLOT_SCHEDULE 0 // set to 1 to report in a slot the gateway assigns (see SlotSchedule)
 
+#if CHANNEL_PLAN && MESH
+  #error "repeaters stay on one channel: MESH and CHANNEL_PLAN do not go together"
+#endif
+#if SLOT_SCHEDULE && (MESH || CHANNEL_PLAN)
+  #error "slots are kept by the gateway's clock on its channel: SLOT_SCHEDULE goes with neither MESH nor CHANNEL_PLAN"
+#endif
+
+#define COMMAND_WINDOW_MS  150   // how long to listen for each queued command
+#define SLOT_LEAD_MS       20    // wake this much before the beacon, to measure first
+
+const int DOOR_WAKE_PIN = 3;
 const int EXTR_LED_PIN = 7;
 const int MOTE_LED_PIN = 9;
 
 Sensors* sensors;
 SensorData* sensorData;
+ReportPolicy* policy;
 
 RFM69 radio;
+PowerControl power(radio);
+#if CHANNEL_PLAN
+  ChannelPlan channels(radio);
+#endif
+#if MESH
+  MeshRouter mesh(radio);
+#endif
+#if SLOT_SCHEDULE
+  SlotSchedule slots(radio);
+#endif
 Message inbound, outbound;
+SleepManager sleeper;
+EnergyMeter meter;
+
+// report payload: the sensor readings, then the energy summary the gateway
+// uses to predict battery life
+typedef struct {
+  SensorData sensors;
+  EnergySummary energy;
+} ReportRecord;
 
 Config* config;
 
-volatile int intr1 = false;
+typedef struct {
+  unsigned int cycles;     // measurement cycles since boot
+  unsigned int sent;       // messages acknowledged by the gateway
+  unsigned int noAcks;     // messages that exhausted their retries
+  unsigned int commands;   // commands received
+} MoteStats;
+MoteStats stats;
+
+byte pending = 0;          // commands held by the gateway, from the last ACK
+boolean reportNow = false;
 
 
 //-----------------------------------------------------------------------------
@@ -63,6 +117,8 @@ void setup() {
   setupLeds();
   setupRadio();
   setupSensors();
+  setupReporting();
+  setupSleep();
 }
 
 void setupPorts() {
@@ -88,6 +144,16 @@ void setupRadio() {
                    config->rfNodeId, 
                    config->rfNetworkId);
   radio.setHighPower();
+  power.begin();
+  #if CHANNEL_PLAN
+    channels.begin();
+  #endif
+  #if MESH
+    mesh.begin(config->rfNodeId, config->rfGatewayId);
+  #endif
+  #if SLOT_SCHEDULE
+    slots.begin(config->rfNodeId, config->rfGatewayId, config->loopMultiplier * 1000UL);
+  #endif
   delay(1000);
   
   #if DEBUG
@@ -101,19 +167,63 @@ void setupSensors() {
   memset(sensorData, 0, sizeof(*sensorData));
 }
 
+void setupReporting() {
+  policy = new ReportPolicy(sizeof(SensorData));
+  applyReporting();
+}
+
+void setupSleep() {
+  #if LISTEN_MODE
+    sleeper.wakeOn(RF69_IRQ_PIN, RISING);   // DIO0, a frame for us while listening
+  #else
+    sleeper.setRadio(radio);
+  #endif
+  sleeper.wakeOn(DOOR_WAKE_PIN, CHANGE);
+  sleeper.begin();
+  meter.attachRadio(radio);
+  meter.begin();
+}
+
+void applyReporting() {
+  policy->setDeadband(0, config->batteryDeadband);
+  policy->setDeadband(1, config->tempDeadband, true);
+  policy->setDeadband(2, config->tempDeadband, true);
+  policy->setDeadband(3, config->lightDeadband);
+  policy->setDeadband(4, DEADBAND_ANY_CHANGE);
+  policy->setHeartbeat(config->heartbeat, config->alertHeartbeat);
+  #if SLOT_SCHEDULE
+    slots.setInterval(config->loopMultiplier * 1000UL);
+  #endif
+}
 
 //-----------------------------------------------------------------------------
 // Main Loop
 //-----------------------------------------------------------------------------
 
 void loop() {  
+  stats.cycles++;
+  meter.enter(ENERGY_ADC);
   sensors->measure();
+  meter.enter(ENERGY_ACTIVE);
   sensors->report(sensorData);
-  sendToRF((sensorData->door) ? MSG_ALERT : MSG_READING, 0);
+  if (policy->due((byte*) sensorData, sensorData->door)) {
+    byte type = (sensorData->door) ? MSG_ALERT : MSG_READING;
+    ReportRecord report;
+    report.sensors = *sensorData;
+    meter.summarize(&report.energy);
+    waitForSlot(sensorData->door);
+    if (sendToRF(type, 0, &report, sizeof(report))) {
+      policy->sent((byte*) sensorData);
+    }
+    listenForCommands();
+  }
   
   blink(MOTE_LED_PIN, EXTR_LED_PIN, sensorData);
   
-  sleep(sensorData);
+  if (!reportNow) {
+    sleep(sensorData);
+  }
+  reportNow = false;
 }
 
 
@@ -130,44 +240,201 @@ void blink(const int pin1, const int pin2, SensorData* sensorData) {
 }
 
 void sleep(SensorData* sensorData) {
-  attachInterrupt(1, wakeup, CHANGE);
   byte multiplier = (sensorData->door) 
                     ? config->alertMultiplier 
                     : config->loopMultiplier;
-  for (int i = 0; i < multiplier; i++) {
-    LowPower.powerDown(SLEEP_1S, ADC_OFF, BOD_OFF);
-    if (intr1) break;
+  unsigned long ms = multiplier * 1000UL;
+  #if SLOT_SCHEDULE
+    // wake for our cell instead, measuring just before its beacon
+    if (!sensorData->door && slots.assigned()) {
+      ms = slots.untilCell(SLOT_LEAD_MS);
+    }
+  #endif
+  #if DEBUG
+    if ((stats.cycles & 0x3F) == 0) {
+      sleeper.printLog(Serial);
+      meter.printLog(Serial);
+    }
+    Serial.flush();
+  #endif
+  meter.enter(ENERGY_SLEEP);
+  #if LISTEN_MODE
+    radio.listenModeStart();
+  #endif
+  byte woke = sleeper.sleepFor(ms);
+  meter.enter(ENERGY_ACTIVE);
+  #if LISTEN_MODE
+    if (radio.listenModeEnd()) {
+      answerWakeup();
+    } else {
+      radio.sleep();
+    }
+  #endif
+  if (woke == DOOR_WAKE_PIN) {
+    #if DEBUG
+      Serial.println("DOOR Change");
+    #endif
   }
-  detachInterrupt(1);
-  intr1 = false;
 }
 
-void sendToRF(byte type, byte component) {
+//-----------------------------------------------------------------------------
+// With SLOT_SCHEDULE, sleeps until the report's turn: a periodic report
+// waits for our slot once the superframe's beacon is heard, an alert for
+// the contention slots at the end of the superframe. Anything else, or a
+// missed beacon, goes at once. The watchdog wakes us early rather than
+// late, and send() waits out the rest awake.
+//
+void waitForSlot(boolean alert) {
+  #if SLOT_SCHEDULE
+    unsigned long ms = 0;
+    if (alert) {
+      ms = slots.untilSlot(true);
+    } else if (slots.sync()) {
+      ms = slots.untilSlot();
+    }
+    if (ms > 0) {
+      meter.enter(ENERGY_SLEEP);
+      sleeper.sleepFor(ms);
+      meter.enter(ENERGY_ACTIVE);
+    }
+  #endif
+}
+
+boolean sendToRF(byte type, byte component, const void* data, byte length) {
   memset(&outbound, 0, sizeof(outbound));
   outbound.msg.type = type;
   outbound.msg.source = config->rfNodeId;
   outbound.msg.destination = 0;
   outbound.msg.component = component;
   outbound.msg.rssi = 0;
-  memcpy(&outbound.msg.data, sensorData, sizeof(*sensorData));
+  memcpy(&outbound.msg.data, data, min(length, MSG_DATA_LENGTH));
     
   #if DEBUG
     Serial.print("Broadcasting report to gateway...");
   #endif
-  if (radio.sendWithRetry(config->rfGatewayId, outbound.raw, MSG_LENGTH)) {
-    #if DEBUG
-      Serial.println("ACK");
+  #if MESH
+    boolean acked = mesh.send(config->rfGatewayId, outbound.raw, MSG_LENGTH);
+  #elif SLOT_SCHEDULE
+    boolean acked = slots.send(outbound.raw, MSG_LENGTH);
+  #else
+    boolean acked = radio.sendWithRetry(config->rfGatewayId, outbound.raw, MSG_LENGTH);
+  #endif
+  #if CHANNEL_PLAN
+    if (!acked) {
+      channels.missed();
+      if (channels.bad()) {
+        acked = channels.rejoin(config->rfGatewayId, outbound.raw, MSG_LENGTH);
+      }
+    }
+  #endif
+  if (acked) {
+    // the payload of the ACK: the gateway's, or a repeater's
+    #if MESH
+      const byte* ack = mesh.ack();
+      byte ackLength = mesh.ackLength();
+    #else
+      const byte* ack = (const byte*) radio.DATA;
+      byte ackLength = radio.DATALEN;
     #endif
-  } else {
-    #if DEBUG
-      Serial.println("No ACK!");
+    stats.sent++;
+    pending = (ackLength > 0) ? ack[0] : 0;
+    if (ackLength > offsetof(AckRecord, rssi)) {   // older gateways send no rssi
+      power.acked((int8_t) ack[offsetof(AckRecord, rssi)]);
+    }
+    #if CHANNEL_PLAN
+      if (ackLength > offsetof(AckRecord, channel)) {
+        channels.acked(ack[offsetof(AckRecord, channel)]);
+      }
     #endif
+  } else {
+    stats.noAcks++;
+    pending = 0;
+    power.missed();
   }
+  #if DEBUG
+    Serial.print(acked ? "ACK" : "No ACK!");
+    Serial.print(", power ");
+    Serial.print(power.dBm());
+    Serial.println("dBm");
+  #endif
+  return acked;
 }
 
-void wakeup() {
-  #if DEBUG
-    Serial.println("DOOR Change");
+//-----------------------------------------------------------------------------
+// Keeps the receiver on only while the gateway says it is holding commands
+// for us, then puts the radio to sleep until the next report, on the
+// channel the gateway last assigned.
+//
+void listenForCommands() {
+  unsigned long start = millis();
+  while (pending > 0 && millis() - start < COMMAND_WINDOW_MS) {
+    if (radio.receiveDone()) {
+      boolean fromGateway = radio.SENDERID == config->rfGatewayId 
+                            && radio.DATALEN == MSG_LENGTH;
+      if (fromGateway) {
+        memcpy(&inbound, (byte*) radio.DATA, MSG_LENGTH);
+      }
+      if (radio.ACK_REQUESTED) {
+        radio.sendACK();
+      }
+      if (fromGateway && inbound.msg.type == MSG_CONFIG) {
+        handleCommand();
+        start = millis();
+      }
+    }
+  }
+  #if CHANNEL_PLAN
+    channels.follow();
   #endif
-  intr1 = true;
+  radio.sleep();
+}
+
+//-----------------------------------------------------------------------------
+// A wake-up burst from the gateway came in while we slept. The gateway is
+// not listening until the burst is over, so sleep through the rest of it,
+// then answer the command and take any more it holds for us.
+//
+void answerWakeup() {
+  boolean fromGateway = radio.SENDERID == config->rfGatewayId 
+                        && radio.DATALEN == MSG_LENGTH;
+  if (fromGateway) {
+    memcpy(&inbound, (byte*) radio.DATA, MSG_LENGTH);
+  }
+  radio.sleep();
+  if (!fromGateway || inbound.msg.type != MSG_CONFIG) {
+    return;
+  }
+  sleeper.sleepFor(radio.burstRemaining());
+  handleCommand();
+  listenForCommands();
+}
+
+void handleCommand() {
+  byte operation = inbound.msg.component;
+  byte reply[2] = { inbound.msg.data[0], 0 };
+  boolean ok = false;
+  
+  stats.commands++;
+  switch (operation) {
+    case CMD_GET:
+      ok = config->get(reply[0], &reply[1]);
+      break;
+    case CMD_SET:
+      // the reply carries the value in force, so a rejected one shows
+      ok = config->set(reply[0], inbound.msg.data[1]);
+      if (ok) {
+        applyReporting();
+      }
+      config->get(reply[0], &reply[1]);
+      break;
+    case CMD_STATS:
+      sendToRF(MSG_CONFIG, operation, &stats, sizeof(stats));
+      return;
+    case CMD_REPORT:
+      policy->force();
+      reportNow = true;
+      ok = true;
+      break;
+  }
+  sendToRF(MSG_CONFIG, ok ? operation : operation | CMD_ERROR, reply, sizeof(reply));
 }
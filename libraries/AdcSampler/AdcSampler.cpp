@@ -0,0 +1,136 @@
+/*
+  AdcSampler.cpp - Logic for oversampled, noise-reduced ADC acquisition
+  Created by Jon R. Brule, October 19, 2026.
+  Released into the public domain.
+*/
+#include "Arduino.h"
+#include <avr/power.h>
+#include <LowPower.h>
+#include "AdcSampler.h"
+
+// the ADC interrupt only has to exist to bring the CPU out of noise
+// reduction sleep; ADIF is cleared in hardware when it runs
+EMPTY_INTERRUPT(ADC_vect);
+
+//-----------------------------------------------------------------------------
+AdcSampler::AdcSampler(byte extraBits, bool noiseReduction) {
+  setExtraBits(extraBits);
+  _noiseReduction = noiseReduction;
+  _conversions = 0;
+}
+
+//-----------------------------------------------------------------------------
+// Takes a single oversampled reading of one analog pin.
+//
+adc_q16_t AdcSampler::sample(byte pin) {
+  adc_q16_t result;
+  sample(&pin, &result, 1);
+  return result;
+}
+
+//-----------------------------------------------------------------------------
+// Takes an oversampled reading of each pin in a single ADC session, so the
+// converter is powered and the reference settled only once per batch.
+//
+void AdcSampler::sample(const byte* pins, adc_q16_t* results, byte count) {
+  _conversions = 0;
+  begin();
+  for (byte i = 0; i < count; i++) {
+    selectChannel(pins[i]);
+    convert();  // discard the first conversion after a mux change
+    results[i] = oversample();
+  }
+  end();
+}
+
+//-----------------------------------------------------------------------------
+void AdcSampler::setExtraBits(byte extraBits) {
+  _extraBits = (extraBits > ADC_MAX_OVERSAMPLE_BITS) 
+               ? ADC_MAX_OVERSAMPLE_BITS 
+               : extraBits;
+}
+
+//-----------------------------------------------------------------------------
+void AdcSampler::setNoiseReduction(bool onOff) {
+  _noiseReduction = onOff;
+}
+
+//-----------------------------------------------------------------------------
+// Returns the number of conversions performed by the last sample() call.
+//
+unsigned int AdcSampler::conversions() {
+  return _conversions;
+}
+
+//-----------------------------------------------------------------------------
+unsigned int AdcSampler::toMillivolts(adc_q16_t value, unsigned int vref) {
+  return ((unsigned long) value * vref) >> 16;
+}
+
+//-----------------------------------------------------------------------------
+byte AdcSampler::toByte(adc_q16_t value) {
+  return value >> 8;
+}
+
+//-----------------------------------------------------------------------------
+void AdcSampler::begin() {
+  power_adc_enable();
+  _wasEnabled = bit_is_set(ADCSRA, ADEN);
+  ADCSRA |= _BV(ADEN);
+  if (_noiseReduction) {
+    ADCSRA |= _BV(ADIE);
+  }
+}
+
+//-----------------------------------------------------------------------------
+void AdcSampler::end() {
+  ADCSRA &= ~_BV(ADIE);
+  if (!_wasEnabled) {
+    ADCSRA &= ~_BV(ADEN);
+  }
+}
+
+//-----------------------------------------------------------------------------
+// Routes the multiplexer to an analog pin using the same reference as the
+// Arduino core (AVcc, i.e. analogReference(DEFAULT)).
+//
+void AdcSampler::selectChannel(byte pin) {
+  if (pin >= A0) {
+    pin -= A0;
+  }
+  ADMUX = (DEFAULT << 6) | (pin & 0x07);
+}
+
+//-----------------------------------------------------------------------------
+// Performs one conversion. In noise reduction mode the CPU sleeps until the
+// ADC interrupt fires; entering SLEEP_MODE_ADC starts the conversion itself.
+// Any other wake source simply puts it back to sleep until the result is in.
+//
+unsigned int AdcSampler::convert() {
+  if (_noiseReduction) {
+    do {
+      LowPower.adcNoiseReduction(SLEEP_FOREVER, ADC_ON, TIMER2_ON);
+    } while (bit_is_set(ADCSRA, ADSC));
+  } else {
+    ADCSRA |= _BV(ADSC);
+    while (bit_is_set(ADCSRA, ADSC));
+  }
+  _conversions++;
+  return ADC;
+}
+
+//-----------------------------------------------------------------------------
+// Oversampling and decimation: 4^n conversions summed and shifted right by n
+// yield n extra bits, which are then left-aligned into Q0.16.
+//
+adc_q16_t AdcSampler::oversample() {
+  unsigned int samples = 1 << (2 * _extraBits);
+  unsigned long sum = 0;
+  for (unsigned int i = 0; i < samples; i++) {
+    sum += convert();
+  }
+  sum >>= _extraBits;
+  return sum << (16 - ADC_NATIVE_BITS - _extraBits);
+}
+
+AdcSampler Adc;
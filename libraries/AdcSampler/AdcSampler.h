@@ -0,0 +1,45 @@
+/*
+  AdcSampler.h - Library for oversampled, noise-reduced ADC acquisition.
+  Created by Jon R. Brule, October 19, 2026.
+  Released into the public domain.
+*/
+#ifndef AdcSampler_h
+#define AdcSampler_h
+
+#include "Arduino.h"
+
+#define ADC_OVERSAMPLE_BITS      2   // default extra bits of resolution (16 samples)
+#define ADC_MAX_OVERSAMPLE_BITS  6   // 4096 samples per reading
+#define ADC_NATIVE_BITS          10
+
+// Readings are reported as an unsigned Q0.16 fraction of the ADC reference:
+// 0x0000 is 0V and 0xFFFF is just below AREF. A plain analogRead() value n
+// is therefore n << 6, and oversampling fills in the low-order bits.
+typedef uint16_t adc_q16_t;
+
+class AdcSampler {
+  public:
+    AdcSampler(byte extraBits = ADC_OVERSAMPLE_BITS, bool noiseReduction = true);
+    adc_q16_t sample(byte pin);
+    void sample(const byte* pins, adc_q16_t* results, byte count);
+    void setExtraBits(byte extraBits);
+    void setNoiseReduction(bool onOff);
+    unsigned int conversions();
+    static unsigned int toMillivolts(adc_q16_t value, unsigned int vref);
+    static byte toByte(adc_q16_t value);
+  protected:
+    void begin();
+    void end();
+    void selectChannel(byte pin);
+    unsigned int convert();
+    adc_q16_t oversample();
+  private:
+    byte _extraBits;
+    bool _noiseReduction;
+    bool _wasEnabled;
+    unsigned int _conversions;
+};
+
+extern AdcSampler Adc;
+
+#endif
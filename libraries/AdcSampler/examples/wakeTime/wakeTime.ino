@@ -0,0 +1,74 @@
+/* -----------------------------------------------------------------------------
+   ADC Wake Time Comparison
+  
+   Compares the CPU-awake time needed to read four analog channels with plain
+   analogRead() against an AdcSampler batch, with and without ADC noise
+   reduction sleep.
+   
+   Timer0 is halted while the CPU sits in ADC noise reduction mode, so the
+   micros() delta around a noise-reduced batch counts only the time the CPU
+   was actually awake.
+ 
+   Circuit:
+   * Moteino R4 (ATmega328P @ 16MHz)
+   * A0..A3 - any analog sources
+----------------------------------------------------------------------------- */
+#include <AdcSampler.h>
+#include <LowPower.h>
+
+#define BAUD_RATE  9600
+#define CHANNELS   4
+
+const byte pins[CHANNELS] = { A0, A1, A2, A3 };
+adc_q16_t results[CHANNELS];
+
+void setup() {
+  Serial.begin(BAUD_RATE);
+  Serial.println("\n[adc wake time]");
+}
+
+void loop() {
+  unsigned long start, elapsed;
+
+  start = micros();
+  for (byte i = 0; i < CHANNELS; i++) {
+    results[i] = analogRead(pins[i]) << 6;
+  }
+  elapsed = micros() - start;
+  report("analogRead x1      ", elapsed, CHANNELS);
+
+  for (byte bits = 0; bits <= 3; bits++) {
+    AdcSampler busy(bits, false);
+    start = micros();
+    busy.sample(pins, results, CHANNELS);
+    elapsed = micros() - start;
+    report("busy-wait  +", elapsed, busy.conversions(), bits);
+
+    AdcSampler quiet(bits, true);
+    start = micros();
+    quiet.sample(pins, results, CHANNELS);
+    elapsed = micros() - start;
+    report("noise-red. +", elapsed, quiet.conversions(), bits);
+  }
+
+  Serial.println();
+  Serial.flush();
+  LowPower.powerDown(SLEEP_8S, ADC_OFF, BOD_OFF);
+}
+
+void report(const char* label, unsigned long awake, unsigned int conversions) {
+  Serial.print(label);
+  Serial.print(" awake(us)=");
+  Serial.print(awake);
+  Serial.print(" conversions=");
+  Serial.print(conversions);
+  Serial.print(" A0=0x");
+  Serial.println(results[0], HEX);
+}
+
+void report(const char* label, unsigned long awake, unsigned int conversions, byte bits) {
+  Serial.print(label);
+  Serial.print(bits);
+  Serial.print(" bits");
+  report(" ", awake, conversions);
+}
@@ -0,0 +1,190 @@
+/*
+  ChannelPlan.cpp - Logic for multi-channel RFM69 networks.
+  Created by Jon R. Brule, October 19, 2026.
+  Released into the public domain.
+*/
+#include "Arduino.h"
+#include "ChannelPlan.h"
+
+//-----------------------------------------------------------------------------
+ChannelPlan::ChannelPlan(RFM69& radio) : _radio(radio) {
+  _channel = 0;
+  _assigned = CHANNEL_COUNT;
+  _moves = 0;
+  _per = 0;
+  _retries = 0;
+  _sampledAt = 0;
+}
+
+//-----------------------------------------------------------------------------
+// Starts on the given channel; call after the radio is initialized.
+//
+void ChannelPlan::begin(byte channel) {
+  _channel = channel % CHANNEL_COUNT;
+  _assigned = CHANNEL_COUNT;
+  tune(_channel);
+}
+
+//-----------------------------------------------------------------------------
+// Moves the radio to a channel, with a clean error rate. The radio is left
+// asleep, as a frequency change only takes effect outside RX; the next
+// receiveDone() or send wakes it.
+//
+void ChannelPlan::tune(byte channel) {
+  _channel = channel;
+  _radio.sleep();
+  _radio.setFrequency(frf(channel));
+  _per = 0;
+  _retries = _radio.stats.retries;
+  _sampledAt = millis();
+}
+
+//-----------------------------------------------------------------------------
+// Packet error rate on the current channel, in percent.
+//
+byte ChannelPlan::errorRate() {
+  return ((uint32_t) _per * 100) >> 16;
+}
+
+//-----------------------------------------------------------------------------
+uint32_t ChannelPlan::frf(byte channel) {
+  return CHANNEL_BASE_FRF + (uint32_t) channel * CHANNEL_SPACING_FRF;
+}
+
+//-----------------------------------------------------------------------------
+// A report was acknowledged, after the retries it took, and the ACK
+// assigned the mote a channel; one outside the plan, such as
+// ACK_NO_CHANNEL, assigns none. The mote moves there on follow().
+//
+void ChannelPlan::acked(byte assigned) {
+  for (unsigned int lost = retries(); lost > 0; lost--) {
+    record(true, CHANNEL_FRAME_SHIFT);
+  }
+  record(false, CHANNEL_FRAME_SHIFT);
+  _retries = _radio.stats.retries;
+  if (assigned < CHANNEL_COUNT) {
+    _assigned = assigned;
+  }
+}
+
+//-----------------------------------------------------------------------------
+// A report went unacknowledged after all its retries.
+//
+void ChannelPlan::missed() {
+  for (unsigned int lost = retries() + 1; lost > 0; lost--) {
+    record(true, CHANNEL_FRAME_SHIFT);
+  }
+  _retries = _radio.stats.retries;
+}
+
+//-----------------------------------------------------------------------------
+// Moves to the channel the gateway assigned, once the exchange the ACK
+// belongs to is over: the gateway delivers queued commands on the channel
+// it heard the report on.
+//
+void ChannelPlan::follow() {
+  if (_assigned < CHANNEL_COUNT && _assigned != _channel) {
+    tune(_assigned);
+    _moves++;
+  }
+}
+
+//-----------------------------------------------------------------------------
+// Looks for the gateway after the current channel went bad: sends the
+// report once on each other channel in turn, and then once more on this
+// one, until a frame is acknowledged. Returns true with the ACK in the
+// radio's DATA, as sendWithRetry() does, on the channel that answered.
+//
+boolean ChannelPlan::rejoin(byte gateway, const void* buffer, byte size) {
+  byte start = _channel;
+  for (byte i = 1; i <= CHANNEL_COUNT; i++) {
+    tune((start + i) % CHANNEL_COUNT);
+    if (_radio.sendWithRetry(gateway, buffer, size, 0)) {
+      _retries = _radio.stats.retries;
+      if (_channel != start) {
+        _moves++;
+      }
+      return true;
+    }
+  }
+  _retries = _radio.stats.retries;
+  return false;
+}
+
+//-----------------------------------------------------------------------------
+// Samples the carrier every CHANNEL_SAMPLE_MS while the radio is idle in
+// RX; call from the gateway's loop, after receiveDone().
+//
+void ChannelPlan::sample() {
+  if (millis() - _sampledAt < CHANNEL_SAMPLE_MS) {
+    return;
+  }
+  if (_radio._mode != RF69_MODE_RX || _radio.PAYLOADLEN != 0) {
+    return;
+  }
+  _sampledAt = millis();
+  record(_radio.readRSSI() >= CSMA_LIMIT, CHANNEL_SAMPLE_SHIFT);
+}
+
+//-----------------------------------------------------------------------------
+// Moves the radio to the quietest channel of the plan, leaving out the
+// current one and those set in taken (bit n for channel n, e.g. another
+// radio's). The survey takes about CHANNEL_SURVEY_SAMPLES ms per channel,
+// during which nothing is received. Returns the new channel.
+//
+byte ChannelPlan::migrate(uint16_t taken) {
+  byte best = _channel;
+  byte quietest = CHANNEL_SURVEY_SAMPLES + 1;
+  for (byte i = 1; i < CHANNEL_COUNT; i++) {
+    byte channel = (_channel + i) % CHANNEL_COUNT;
+    if (taken & (1 << channel)) {
+      continue;
+    }
+    byte busy = survey(channel);
+    if (busy < quietest) {
+      best = channel;
+      quietest = busy;
+    }
+  }
+  if (best != _channel) {
+    _moves++;
+  }
+  tune(best);
+  return best;
+}
+
+//-----------------------------------------------------------------------------
+// Retries since the last report. Someone else may zero radio.stats, as
+// EnergyMeter::begin() does; a counter below the snapshot has restarted
+// since, and all it holds are new retries.
+//
+unsigned int ChannelPlan::retries() {
+  unsigned int now = _radio.stats.retries;
+  return now < _retries ? now : now - _retries;
+}
+
+//-----------------------------------------------------------------------------
+void ChannelPlan::record(boolean lost, byte shift) {
+  if (lost) {
+    _per += (0xFFFF - _per) >> shift;
+  } else {
+    _per -= _per >> shift;
+  }
+}
+
+//-----------------------------------------------------------------------------
+// Counts the RSSI samples on a channel that find a carrier.
+//
+byte ChannelPlan::survey(byte channel) {
+  _radio.sleep();
+  _radio.setFrequency(frf(channel));
+  _radio.receiveDone();
+  byte busy = 0;
+  for (byte i = 0; i < CHANNEL_SURVEY_SAMPLES; i++) {
+    delay(1);
+    if (_radio.readRSSI() >= CSMA_LIMIT) {
+      busy++;
+    }
+  }
+  return busy;
+}
@@ -0,0 +1,73 @@
+/*
+  ChannelPlan.h - Library for multi-channel RFM69 networks.
+  Created by Jon R. Brule, October 19, 2026.
+  Released into the public domain.
+
+  Spreads an RFM69 network over CHANNEL_COUNT channels and moves it off a
+  channel that a neighbour's traffic or noise has taken. Channel n sits at
+  CHANNEL_BASE_FRF + n * CHANNEL_SPACING_FRF, tuned with setFrequency().
+
+  The gateway assigns each mote its channel in the ACK to every report
+  (AckRecord.channel); a gateway with two radios spreads the motes over
+  both of their channels. Each side keeps a running packet error rate for
+  the channel it is on:
+  * a mote counts the frames of its reports that were not acknowledged;
+  * a gateway cannot count the frames it missed, so it samples readRSSI()
+    while idle in RX and counts the samples that find a carrier, i.e. the
+    chance that a frame arriving then is lost. Its own network's frames
+    count as well, so CHANNEL_PER_LIMIT must sit well above that load.
+  Over CHANNEL_PER_LIMIT, the gateway surveys the plan with readRSSI() and
+  moves the radio to the quietest free channel (migrate()), and a mote
+  whose report went unacknowledged tries it on every channel in turn until
+  one gets an ACK (rejoin()).
+*/
+#ifndef ChannelPlan_h
+#define ChannelPlan_h
+
+#include "Arduino.h"
+#include <RFM69.h>
+
+#define CHANNEL_COUNT          8         // channels in the plan
+#define CHANNEL_BASE_FRF       0xE4C000  // channel 0: 915MHz, in 61.035Hz steps
+#define CHANNEL_SPACING_FRF    0x2000    // 500kHz on to the next channel
+#define CHANNEL_PER_LIMIT      30        // % error rate over which a channel is left
+#define CHANNEL_FRAME_SHIFT    4         // a mote's error rate averages over ~2^4 frames...
+#define CHANNEL_SAMPLE_SHIFT   6         // ...a gateway's over ~2^6 RSSI samples
+#define CHANNEL_SAMPLE_MS      20        // gateway RSSI sample interval
+#define CHANNEL_SURVEY_SAMPLES 16        // RSSI samples per channel in a survey, 1ms apart
+
+class ChannelPlan {
+  public:
+    ChannelPlan(RFM69& radio);
+    void begin(byte channel = 0);
+    void tune(byte channel);
+    inline byte channel() { return _channel; }
+    inline unsigned int moves() { return _moves; }     // channel changes since the plan began
+    byte errorRate();
+    inline boolean bad() { return errorRate() > CHANNEL_PER_LIMIT; }
+    static uint32_t frf(byte channel);
+
+    // motes
+    void acked(byte assigned);
+    void missed();
+    void follow();
+    boolean rejoin(byte gateway, const void* buffer, byte size);
+
+    // gateways
+    void sample();
+    byte migrate(uint16_t taken = 0);
+  protected:
+    unsigned int retries();
+    void record(boolean lost, byte shift);
+    byte survey(byte channel);
+  private:
+    RFM69& _radio;
+    byte _channel;
+    byte _assigned;               // channel from the last ACK, see follow(); CHANNEL_COUNT for none
+    unsigned int _moves;
+    uint16_t _per;                // error rate, in 1/65536
+    unsigned int _retries;        // radio.stats.retries at the last report
+    unsigned long _sampledAt;
+};
+
+#endif
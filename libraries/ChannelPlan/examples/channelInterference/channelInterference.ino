@@ -0,0 +1,232 @@
+/* -----------------------------------------------------------------------------
+   ChannelPlan Channel Interference
+
+   Runs a gateway and a fleet of motes on the simulated medium while a
+   neighbour's transmitter, on another network and without carrier sense,
+   takes an increasing share of channel 0, and prints the reports offered
+   and delivered per second with fixed channels and with ChannelPlan. The
+   gateway has one radio, or two that split the motes between them by node
+   parity, as oha_gateway_rf_v0_2 does with RADIO2; it ACKs each report
+   with the RSSI and the channel assigned to the mote.
+
+   With fixed channels every mote stays where it starts, on its gateway
+   radio's channel, 0 and with two radios 1. With ChannelPlan the motes all
+   start on channel 0 and follow the channel in their ACKs; the gateway
+   samples the carrier and migrates a radio off a busy channel, and motes
+   rejoin when their reports stop getting through.
+
+   Counts run from JAM_START_MS, when the neighbour starts; the gateway and
+   mote moves are the channel changes up to the end of the run.
+
+   Host only, on the simulated radios: make -C libraries/VirtualAir/host channelInterference
+----------------------------------------------------------------------------- */
+#include <ChannelPlan.h>
+#include <Message.h>
+#include <RFM69.h>
+#include <VirtualAir.h>
+
+#define BAUD_RATE     57600
+#define GATEWAY_ID    1
+#define NETWORK_ID    99
+#define FREQUENCY     RF69_915MHZ
+#define MOTES         40
+#define PERIOD_MS     2000     // report interval of each mote
+#define RUN_MS        600000UL
+#define JAM_START_MS  60000UL  // the neighbour starts this far into the run
+#define JAMMER_ID     250
+#define JAM_NETWORK   7
+#define JAM_LENGTH    61       // bytes per neighbour frame
+
+const byte duties[] = { 0, 25, 50, 90 };   // % of channel 0 airtime the neighbour takes
+
+// a transmitter that does not listen before talking
+class Jammer : public RFM69 {
+  public:
+    void blast(const void* buffer, byte size) {
+      sendFrame(RF69_BROADCAST_ADDR, buffer, size);
+    }
+};
+
+VirtualAir& air = VirtualAir::medium();
+RFM69 gatewayRadios[2];
+ChannelPlan* gatewayPlans[2];
+RFM69 moteRadios[MOTES];
+ChannelPlan* motePlans[MOTES];
+Jammer jammer;
+
+byte radios;
+bool adaptive;
+byte duty;
+unsigned long offered;
+unsigned long delivered;
+uint32_t lastSeq[MOTES];
+
+typedef struct {
+  uint32_t seq;
+  byte counted;            // started after JAM_START_MS
+} Stamp;
+
+//------------------------------------------------------------------------------
+// The gateway: count each report once, ACK with the mote's channel, and
+// with ChannelPlan, move a radio off a busy channel.
+//
+static void receive(byte r) {
+  RFM69& radio = gatewayRadios[r];
+  if (!radio.receiveDone()) {
+    return;
+  }
+  byte i = radio.SENDERID - GATEWAY_ID - 1;
+  if (radio.DATALEN == sizeof(Message) && i < MOTES) {
+    Message msg;
+    Stamp stamp;
+    memcpy(&msg, (byte*) radio.DATA, sizeof(msg));
+    memcpy(&stamp, msg.msg.data, sizeof(stamp));
+    if (stamp.seq != lastSeq[i]) {
+      lastSeq[i] = stamp.seq;
+      if (stamp.counted) delivered++;
+    }
+  }
+  if (radio.ACK_REQUESTED) {
+    AckRecord ack;
+    ack.pending = 0;
+    ack.rssi = radio.RSSI;
+    ack.channel = gatewayPlans[radio.SENDERID % radios]->channel();
+    radio.sendACK(&ack, sizeof(ack));
+  }
+}
+
+static void gateway(void* arg) {
+  for (byte r = 0; r < radios; r++) {
+    gatewayRadios[r].initialize(FREQUENCY, GATEWAY_ID, NETWORK_ID);
+    gatewayRadios[r].setHighPower();
+    gatewayPlans[r]->begin(r);
+  }
+  while (true) {
+    for (byte r = 0; r < radios; r++) {
+      receive(r);
+      if (!adaptive) continue;
+      ChannelPlan& plan = *gatewayPlans[r];
+      plan.sample();
+      if (plan.bad()) {
+        plan.migrate(radios > 1 ? 1 << gatewayPlans[1 - r]->channel() : 0);
+      }
+    }
+  }
+}
+
+//------------------------------------------------------------------------------
+// A mote: report, rejoin when the channel has gone bad, follow the ACK.
+//
+static void mote(void* arg) {
+  byte i = (RFM69*) arg - moteRadios;
+  RFM69& radio = moteRadios[i];
+  ChannelPlan& plan = *motePlans[i];
+  byte id = GATEWAY_ID + 1 + i;
+  radio.initialize(FREQUENCY, id, NETWORK_ID);
+  radio.setHighPower();
+  plan.begin(adaptive ? 0 : id % radios);
+  Message msg;
+  Stamp stamp;
+  stamp.seq = 0;
+  while (true) {
+    radio.sleep();
+    air.wait((PERIOD_MS * (90 + air.random(21)) / 100) * 1000ULL);
+    memset(&msg, 0, sizeof(msg));
+    msg.msg.type = MSG_READING;
+    msg.msg.source = id;
+    stamp.seq++;
+    stamp.counted = air.millis() >= JAM_START_MS;
+    memcpy(msg.msg.data, &stamp, sizeof(stamp));
+    if (stamp.counted) offered++;
+
+    bool acked = radio.sendWithRetry(GATEWAY_ID, msg.raw, MSG_LENGTH);
+    if (!adaptive) {
+      continue;
+    }
+    if (!acked) {
+      plan.missed();
+      if (plan.bad()) acked = plan.rejoin(GATEWAY_ID, msg.raw, MSG_LENGTH);
+    }
+    if (acked && radio.DATALEN >= sizeof(AckRecord)) {
+      plan.acked(radio.DATA[offsetof(AckRecord, channel)]);
+    }
+    plan.follow();
+  }
+}
+
+//------------------------------------------------------------------------------
+// The neighbour: frames at random on channel 0, duty % of the time.
+//
+static void neighbour(void* arg) {
+  jammer.initialize(FREQUENCY, JAMMER_ID, JAM_NETWORK);
+  jammer.setHighPower();
+  jammer.setFrequency(ChannelPlan::frf(0));
+  byte noise[JAM_LENGTH];
+  memset(noise, 0x55, sizeof(noise));
+  unsigned long frameUs = air.airtime(&jammer, 4 + JAM_LENGTH + RF69_SIM_OVERHEAD);
+  float gapUs = frameUs * (100.0 - duty) / duty;
+  while (true) {
+    jammer.blast(noise, sizeof(noise));
+    air.wait((uint64_t) (-log((air.random(65535) + 1) / 65536.0) * gapUs));
+  }
+}
+
+static void run() {
+  air.reset();
+  air.seed(42);
+  offered = 0;
+  delivered = 0;
+  memset(lastSeq, 0, sizeof(lastSeq));
+  for (byte r = 0; r < 2; r++) {
+    delete gatewayPlans[r];
+    gatewayPlans[r] = new ChannelPlan(gatewayRadios[r]);
+  }
+  uint64_t start = air.now();
+  air.spawn(gateway, NULL);
+  for (byte i = 0; i < MOTES; i++) {
+    delete motePlans[i];
+    motePlans[i] = new ChannelPlan(moteRadios[i]);
+    air.spawn(mote, &moteRadios[i], air.random(PERIOD_MS) * 1000ULL);
+  }
+  if (duty > 0) {
+    air.spawn(neighbour, NULL, JAM_START_MS * 1000ULL);
+  }
+  air.run(start + RUN_MS * 1000ULL);
+}
+
+void setup() {
+  Serial.begin(BAUD_RATE);
+  Serial.println("radios, channels, neighbour %, offered/s, delivered/s, delivered %, gateway moves, mote moves");
+  float seconds = (RUN_MS - JAM_START_MS) / 1000.0;
+  for (radios = 1; radios <= 2; radios++) {
+    for (byte a = 0; a < 2; a++) {
+      for (byte d = 0; d < sizeof(duties); d++) {
+        adaptive = a;
+        duty = duties[d];
+        run();
+        unsigned int gatewayMoves = 0, moteMoves = 0;
+        for (byte r = 0; r < radios; r++) gatewayMoves += gatewayPlans[r]->moves();
+        for (byte i = 0; i < MOTES; i++) moteMoves += motePlans[i]->moves();
+        Serial.print(radios);
+        Serial.print(", ");
+        Serial.print(adaptive ? "plan" : "fixed");
+        Serial.print(", ");
+        Serial.print(duty);
+        Serial.print(", ");
+        Serial.print(offered / seconds, 2);
+        Serial.print(", ");
+        Serial.print(delivered / seconds, 2);
+        Serial.print(", ");
+        Serial.print(offered ? 100.0 * delivered / offered : 0.0, 2);
+        Serial.print(", ");
+        Serial.print(gatewayMoves);
+        Serial.print(", ");
+        Serial.println(moteMoves);
+      }
+    }
+  }
+}
+
+void loop() {
+  air.wait(1000000);
+}
@@ -0,0 +1,17 @@
+/*
+  ConfigStore.cpp - Logic for configuration record checksums
+  Created by Jon R. Brule, October 19, 2026.
+  Released into the public domain.
+*/
+#include "ConfigStore.h"
+
+//-----------------------------------------------------------------------------
+// CRC-16/CCITT, bit-compatible with avr-libc's _crc_ccitt_update() but
+// portable so that host builds and the simulated EEPROM agree with the mote.
+//
+uint16_t configCrc16(uint16_t crc, uint8_t data) {
+  data ^= (uint8_t) (crc & 0xFF);
+  data ^= data << 4;
+  return ((((uint16_t) data << 8) | (crc >> 8)) ^ (uint8_t) (data >> 4) 
+         ^ ((uint16_t) data << 3));
+}
@@ -0,0 +1,190 @@
+/*
+  ConfigStore.h - Library for versioned, CRC-protected configuration records.
+  Created by Jon R. Brule, October 19, 2026.
+  Released into the public domain.
+  
+  A record of type T is kept in SLOTS rotating EEPROM slots, each holding a
+  header (magic, schema version, sequence number, CRC) followed by the record.
+  load() picks the valid slot with the newest sequence number; store() writes
+  the next slot only when the record differs from the current one, and only
+  the cells whose contents actually change, so repeated over-the-air tuning
+  spreads its wear over SLOTS times as many cells.
+  
+  Storage is any class with byte read(int) and write(int, byte), such as the
+  Arduino EEPROM object or a SimulatedEEPROM on the host.
+*/
+#ifndef ConfigStore_h
+#define ConfigStore_h
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define CONFIG_STORE_MAGIC   0xC5
+#define CONFIG_STORE_SLOTS   4
+
+typedef struct {
+  uint8_t magic;
+  uint8_t version;
+  uint16_t sequence;
+  uint16_t crc;
+} ConfigHeader;
+
+uint16_t configCrc16(uint16_t crc, uint8_t data);
+
+template <typename T, typename Storage, uint8_t SLOTS = CONFIG_STORE_SLOTS>
+class ConfigStore {
+  public:
+    enum { SLOT_SIZE = sizeof(ConfigHeader) + sizeof(T), 
+           SIZE = SLOTS * SLOT_SIZE };
+    
+    ConfigStore(Storage& storage, uint8_t version, int base = 0) 
+      : _storage(storage) {
+      _version = version;
+      _base = base;
+      _scanned = false;
+      _valid = false;
+      _current = SLOTS - 1;
+      _sequence = 0;
+    }
+    
+    bool load(T& record);
+    bool store(const T& record);
+    inline uint8_t slot() { return _current; }
+    inline uint16_t sequence() { return _sequence; }
+    
+  protected:
+    void scan();
+    bool validSlot(uint8_t slot, ConfigHeader& header);
+    bool matches(uint8_t slot, const T& record);
+    void update(int address, uint8_t value);
+    inline int address(uint8_t slot) { return _base + slot * SLOT_SIZE; }
+    
+  private:
+    Storage& _storage;
+    uint8_t _version;
+    int _base;
+    bool _scanned;
+    bool _valid;
+    uint8_t _current;
+    uint16_t _sequence;
+};
+
+
+//-----------------------------------------------------------------------------
+// Loads the newest valid record; returns false (leaving the record alone)
+// when no slot holds a record with a matching schema version and CRC.
+//
+template <typename T, typename Storage, uint8_t SLOTS>
+bool ConfigStore<T, Storage, SLOTS>::load(T& record) {
+  scan();
+  if (!_valid) {
+    return false;
+  }
+  uint8_t* p = (uint8_t*) &record;
+  int start = address(_current) + sizeof(ConfigHeader);
+  for (unsigned int i = 0; i < sizeof(T); i++) {
+    p[i] = _storage.read(start + i);
+  }
+  return true;
+}
+
+//-----------------------------------------------------------------------------
+// Writes the record into the next slot unless it matches the current one;
+// returns true if the EEPROM was touched. The CRC goes in last, so a write
+// torn by a reset leaves an invalid slot and the previous record in force.
+//
+template <typename T, typename Storage, uint8_t SLOTS>
+bool ConfigStore<T, Storage, SLOTS>::store(const T& record) {
+  scan();
+  if (_valid && matches(_current, record)) {
+    return false;
+  }
+  
+  ConfigHeader header;
+  header.magic = CONFIG_STORE_MAGIC;
+  header.version = _version;
+  header.sequence = _sequence + 1;
+  header.crc = 0xFFFF;
+  const uint8_t* h = (const uint8_t*) &header;
+  const uint8_t* p = (const uint8_t*) &record;
+  for (uint8_t i = 0; i < offsetof(ConfigHeader, crc); i++) {
+    header.crc = configCrc16(header.crc, h[i]);
+  }
+  for (unsigned int i = 0; i < sizeof(T); i++) {
+    header.crc = configCrc16(header.crc, p[i]);
+  }
+  
+  uint8_t next = (_current + 1) % SLOTS;
+  int start = address(next);
+  for (unsigned int i = 0; i < sizeof(T); i++) {
+    update(start + sizeof(ConfigHeader) + i, p[i]);
+  }
+  for (uint8_t i = 0; i < sizeof(ConfigHeader); i++) {
+    update(start + i, h[i]);
+  }
+  
+  _current = next;
+  _sequence = header.sequence;
+  _valid = true;
+  return true;
+}
+
+//-----------------------------------------------------------------------------
+template <typename T, typename Storage, uint8_t SLOTS>
+void ConfigStore<T, Storage, SLOTS>::scan() {
+  if (_scanned) return;
+  _scanned = true;
+  ConfigHeader header;
+  for (uint8_t slot = 0; slot < SLOTS; slot++) {
+    if (!validSlot(slot, header)) continue;
+    if (!_valid || (int16_t) (header.sequence - _sequence) > 0) {
+      _valid = true;
+      _current = slot;
+      _sequence = header.sequence;
+    }
+  }
+}
+
+//-----------------------------------------------------------------------------
+template <typename T, typename Storage, uint8_t SLOTS>
+bool ConfigStore<T, Storage, SLOTS>::validSlot(uint8_t slot, ConfigHeader& header) {
+  int start = address(slot);
+  uint8_t* h = (uint8_t*) &header;
+  for (uint8_t i = 0; i < sizeof(ConfigHeader); i++) {
+    h[i] = _storage.read(start + i);
+  }
+  if (header.magic != CONFIG_STORE_MAGIC || header.version != _version) {
+    return false;
+  }
+  uint16_t crc = 0xFFFF;
+  for (uint8_t i = 0; i < offsetof(ConfigHeader, crc); i++) {
+    crc = configCrc16(crc, h[i]);
+  }
+  for (unsigned int i = 0; i < sizeof(T); i++) {
+    crc = configCrc16(crc, _storage.read(start + sizeof(ConfigHeader) + i));
+  }
+  return crc == header.crc;
+}
+
+//-----------------------------------------------------------------------------
+template <typename T, typename Storage, uint8_t SLOTS>
+bool ConfigStore<T, Storage, SLOTS>::matches(uint8_t slot, const T& record) {
+  int start = address(slot) + sizeof(ConfigHeader);
+  const uint8_t* p = (const uint8_t*) &record;
+  for (unsigned int i = 0; i < sizeof(T); i++) {
+    if (_storage.read(start + i) != p[i]) {
+      return false;
+    }
+  }
+  return true;
+}
+
+//-----------------------------------------------------------------------------
+template <typename T, typename Storage, uint8_t SLOTS>
+void ConfigStore<T, Storage, SLOTS>::update(int address, uint8_t value) {
+  if (_storage.read(address) != value) {
+    _storage.write(address, value);
+  }
+}
+
+#endif
@@ -0,0 +1,68 @@
+/*
+  SimulatedEEPROM.h - RAM-backed EEPROM stand-in with wear accounting.
+  Created by Jon R. Brule, October 19, 2026.
+  Released into the public domain.
+  
+  Mirrors the read()/write() interface of the Arduino EEPROM object and
+  counts every write per cell, so a ConfigStore (or anything else that
+  persists settings) can be exercised on the host and its wear measured.
+  failAfter(n) drops every write after the next n, to mimic a reset in the
+  middle of an update.
+*/
+#ifndef SimulatedEEPROM_h
+#define SimulatedEEPROM_h
+
+#include <stdint.h>
+#include <string.h>
+
+#define EEPROM_ERASED  0xFF
+
+template <int SIZE>
+class SimulatedEEPROM {
+  public:
+    SimulatedEEPROM() {
+      erase();
+    }
+    
+    void erase() {
+      memset(_cells, EEPROM_ERASED, sizeof(_cells));
+      memset(_writes, 0, sizeof(_writes));
+      _failAfter = -1;
+    }
+    
+    uint8_t read(int address) {
+      return (address >= 0 && address < SIZE) ? _cells[address] : EEPROM_ERASED;
+    }
+    
+    void write(int address, uint8_t value) {
+      if (address < 0 || address >= SIZE || _failAfter == 0) return;
+      if (_failAfter > 0) _failAfter--;
+      _cells[address] = value;
+      _writes[address]++;
+    }
+    
+    inline int length() { return SIZE; }
+    inline void failAfter(long writes) { _failAfter = writes; }
+    inline unsigned long writes(int address) { return _writes[address]; }
+    
+    unsigned long totalWrites() {
+      unsigned long total = 0;
+      for (int i = 0; i < SIZE; i++) total += _writes[i];
+      return total;
+    }
+    
+    unsigned long maxWrites() {
+      unsigned long most = 0;
+      for (int i = 0; i < SIZE; i++) {
+        if (_writes[i] > most) most = _writes[i];
+      }
+      return most;
+    }
+    
+  private:
+    uint8_t _cells[SIZE];
+    unsigned long _writes[SIZE];
+    long _failAfter;
+};
+
+#endif
@@ -0,0 +1,75 @@
+/* -----------------------------------------------------------------------------
+   Config Store Wear Report
+  
+   Replays a burst of over-the-air configuration changes against two
+   simulated EEPROMs: one written the old way (every field rewritten in place
+   on each change), and one managed by a ConfigStore. Prints total writes and
+   the worst-case writes to any single cell for each.
+   
+   Both EEPROMs live in RAM, so this runs the same on a mote or on the host:
+   make -C libraries/VirtualAir/host wearReport
+----------------------------------------------------------------------------- */
+#include <ConfigStore.h>
+#include <SimulatedEEPROM.h>
+
+#define BAUD_RATE  57600
+#define COMMANDS   5000
+#define EEPROM_SIZE 96
+
+typedef struct {
+  byte rfNodeId;
+  byte rfNetworkId;
+  byte rfGatewayId;
+  byte rfFrequency;
+  byte loopMultiplier;
+  byte alertMultiplier;
+  byte batteryDeadband;
+  byte tempDeadband;
+  byte lightDeadband;
+  byte heartbeat;
+  byte alertHeartbeat;
+} Settings;
+
+SimulatedEEPROM<EEPROM_SIZE> naive;
+SimulatedEEPROM<EEPROM_SIZE> rotating;
+ConfigStore<Settings, SimulatedEEPROM<EEPROM_SIZE> > store(rotating, 1);
+
+Settings settings = { 9, 99, 1, 91, 10, 2, 2, 1, 16, 30, 1 };
+
+void report(const char* label, unsigned long total, unsigned long most);
+
+void setup() {
+  Serial.begin(BAUD_RATE);
+  Serial.println("\n[config store wear]");
+  
+  randomSeed(42);
+  store.load(settings);
+  for (int n = 0; n < COMMANDS; n++) {
+    // most tuning commands re-send a value the mote already has
+    byte field = random(4, sizeof(Settings));
+    byte* p = (byte*) &settings;
+    if (random(100) < 30) {
+      p[field] = random(1, 60);
+    }
+    for (byte i = 0; i < sizeof(Settings); i++) {
+      naive.write(i, p[i]);
+    }
+    store.store(settings);
+  }
+  
+  report("in place   ", naive.totalWrites(), naive.maxWrites());
+  report("ConfigStore", rotating.totalWrites(), rotating.maxWrites());
+}
+
+void loop() {
+}
+
+void report(const char* label, unsigned long total, unsigned long most) {
+  Serial.print(label);
+  Serial.print(" commands=");
+  Serial.print(COMMANDS);
+  Serial.print(" writes=");
+  Serial.print(total);
+  Serial.print(" worst cell=");
+  Serial.println(most);
+}
@@ -0,0 +1,197 @@
+/*
+  DallasConverter.cpp - Logic for non-blocking DS18x20 temperature conversions.
+  Created by Jon R. Brule, October 19, 2026.
+  Released into the public domain.
+*/
+#include "Arduino.h"
+#include <LowPower.h>
+#include "DallasConverter.h"
+
+#define SCRATCHPAD_SIZE  9
+
+// conversion time by DS18B20 resolution, 9 to 12 bits
+static const unsigned int conversionTimes[] = { 94, 188, 375, 750 };
+
+//-----------------------------------------------------------------------------
+DallasConverter::DallasConverter(OneWire& wire, const DeviceAddress* devices, 
+                                 byte count) : _wire(wire) {
+  _devices = devices;
+  _count = count;
+  _parasite = false;
+  _converting = false;
+  _wait = DALLAS_MAX_WAIT_MS;
+  _started = 0;
+  _awake = 0;
+  _crcErrors = 0;
+}
+
+//-----------------------------------------------------------------------------
+// Finds out whether any device runs on parasite power, and how long the 
+// slowest one needs to convert at its configured resolution. A device that 
+// cannot be read yet is assumed to need the full 750ms.
+//
+void DallasConverter::begin() {
+  _wire.reset();
+  _wire.skip();
+  _wire.write(READPOWERSUPPLY);
+  _parasite = (_wire.read_bit() == 0);
+  _wire.reset();
+  
+  _wait = 0;
+  uint8_t scratchPad[SCRATCHPAD_SIZE];
+  for (byte i = 0; i < _count; i++) {
+    unsigned int wait = DALLAS_MAX_WAIT_MS;
+    if (_devices[i][0] != DS18S20MODEL && readScratchPad(_devices[i], scratchPad)) {
+      wait = conversionTimes[(scratchPad[CONFIGURATION] >> 5) & 0x03];
+    }
+    if (wait > _wait) {
+      _wait = wait;
+    }
+  }
+}
+
+//-----------------------------------------------------------------------------
+// Tells every device on the bus to convert, with a single broadcast. Starts 
+// a new awake time tally, which read() completes.
+//
+void DallasConverter::start() {
+  unsigned long begun = micros();
+  _wire.reset();
+  _wire.skip();
+  _wire.write(STARTCONVO, _parasite);
+  _started = millis();
+  _converting = true;
+  _awake = micros() - begun;
+}
+
+//-----------------------------------------------------------------------------
+// Returns true once the conversion started by start() has had its time. 
+// Externally powered devices also report completion on the bus, which ends 
+// the wait early.
+//
+bool DallasConverter::done() {
+  if (!_converting) {
+    return false;
+  }
+  if (millis() - _started >= _wait) {
+    return true;
+  }
+  return !_parasite && _wire.read_bit() == 1;
+}
+
+//-----------------------------------------------------------------------------
+// Reads every device's scratchpad and stores its temperature, or 
+// TEMP_Q4_INVALID if the device did not answer or failed its CRC. Returns 
+// the number of valid readings.
+//
+byte DallasConverter::read(temp_q4_t* results) {
+  unsigned long begun = micros();
+  if (_parasite) {
+    _wire.depower();
+  }
+  _converting = false;
+  
+  byte valid = 0;
+  uint8_t scratchPad[SCRATCHPAD_SIZE];
+  for (byte i = 0; i < _count; i++) {
+    if (readScratchPad(_devices[i], scratchPad)) {
+      results[i] = calculate(_devices[i], scratchPad);
+      valid++;
+    } else {
+      results[i] = TEMP_Q4_INVALID;
+    }
+  }
+  _awake += micros() - begun;
+  return valid;
+}
+
+//-----------------------------------------------------------------------------
+// Runs a complete cycle: start, power down until the conversion is due, 
+// then read. Timer0 stops in power down, so the time asleep is counted in 
+// watchdog periods rather than by millis(), and awakeMicros() covers only 
+// the time the CPU actually ran.
+//
+byte DallasConverter::convert(temp_q4_t* results) {
+  start();
+  sleep(_wait);
+  
+  // the watchdog runs up to 10% fast; nap until the bus says it is done
+  unsigned long polling = 0;
+  unsigned long begun = micros();
+  for (byte i = 0; !_parasite && i < DALLAS_POLL_LIMIT && _wire.read_bit() == 0; i++) {
+    polling += micros() - begun;
+    sleep(15);
+    begun = micros();
+  }
+  polling += micros() - begun;
+  
+  byte valid = read(results);
+  _awake += polling;
+  return valid;
+}
+
+//-----------------------------------------------------------------------------
+// Converts to hundredths of a degree, the unit the motes report in.
+//
+int DallasConverter::toCentiC(temp_q4_t value) {
+  if (value == TEMP_Q4_INVALID) {
+    return DEVICE_DISCONNECTED_C * 100;
+  }
+  return ((long) value * 25) / 4;
+}
+
+//-----------------------------------------------------------------------------
+bool DallasConverter::readScratchPad(const uint8_t* address, uint8_t* scratchPad) {
+  if (_wire.reset() == 0) {
+    return false;
+  }
+  _wire.select(address);
+  _wire.write(READSCRATCH);
+  _wire.read_bytes(scratchPad, SCRATCHPAD_SIZE);
+  _wire.reset();
+  if (OneWire::crc8(scratchPad, SCRATCHPAD_CRC) != scratchPad[SCRATCHPAD_CRC]) {
+    _crcErrors++;
+    return false;
+  }
+  return true;
+}
+
+//-----------------------------------------------------------------------------
+// DS18B20 style parts report 1/16 degree with the bits below the configured
+// resolution undefined. The DS18S20 reports half degrees, and the count
+// registers extend that:
+//
+//   T = TEMP_READ - 0.25 + (COUNT_PER_C - COUNT_REMAIN) / COUNT_PER_C
+//
+temp_q4_t DallasConverter::calculate(const uint8_t* address, const uint8_t* scratchPad) {
+  int16_t raw = ((int16_t) scratchPad[TEMP_MSB] << 8) | scratchPad[TEMP_LSB];
+  if (address[0] == DS18S20MODEL) {
+    uint8_t perC = scratchPad[COUNT_PER_C];
+    if (perC == 0) {
+      return TEMP_Q4_INVALID;
+    }
+    return ((raw & ~1) << 3) - 4 
+           + (((perC - scratchPad[COUNT_REMAIN]) << 4) / perC);
+  }
+  byte undefined = 3 - ((scratchPad[CONFIGURATION] >> 5) & 0x03);
+  return raw & ~((1 << undefined) - 1);
+}
+
+//-----------------------------------------------------------------------------
+// Powers down for at least ms milliseconds, in the largest watchdog periods
+// that fit.
+//
+void DallasConverter::sleep(unsigned int ms) {
+  static const unsigned int periods[] = { 8000, 4000, 2000, 1000, 500, 250, 120, 60, 30, 15 };
+  static const period_t sleeps[] = { SLEEP_8S, SLEEP_4S, SLEEP_2S, SLEEP_1S, SLEEP_500MS, 
+                                     SLEEP_250MS, SLEEP_120MS, SLEEP_60MS, SLEEP_30MS, 
+                                     SLEEP_15Ms };
+  byte i = 0;
+  while (ms > 0) {
+    while (i < 9 && periods[i] > ms) {
+      i++;
+    }
+    LowPower.powerDown(sleeps[i], ADC_OFF, BOD_OFF);
+    ms = (ms > periods[i]) ? ms - periods[i] : 0;
+  }
+}
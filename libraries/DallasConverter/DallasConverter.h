@@ -0,0 +1,57 @@
+/*
+  DallasConverter.h - Library for non-blocking DS18x20 temperature conversions.
+  Created by Jon R. Brule, October 19, 2026.
+  Released into the public domain.
+  
+  Starts a conversion on every thermometer at once with a single Skip-ROM
+  Convert T broadcast, then reads all scratchpads in one batch, checking
+  each against its CRC. Callers either poll done() between start() and
+  read() and keep working meanwhile, or call convert(), which sleeps in
+  power-down for the conversion time instead of spinning.
+*/
+#ifndef DallasConverter_h
+#define DallasConverter_h
+
+#include "Arduino.h"
+#include <OneWire.h>
+#include <DallasTemperature.h>
+
+// Temperatures are signed fixed point in 1/16 degree C steps, the native 
+// DS18B20 format. TEMP_Q4(-18.5) is -296.
+typedef int16_t temp_q4_t;
+
+#define TEMP_Q4(c)          ((temp_q4_t) ((c) * 16))
+#define TEMP_Q4_INVALID     ((temp_q4_t) 0x8000)  // missing device or bad CRC
+
+#define DALLAS_MAX_WAIT_MS  750   // 12-bit conversion, and every DS18S20
+#define DALLAS_POLL_LIMIT   8     // extra 15ms naps waiting on a slow device
+
+class DallasConverter {
+  public:
+    DallasConverter(OneWire& wire, const DeviceAddress* devices, byte count);
+    void begin();
+    void start();
+    bool done();
+    byte read(temp_q4_t* results);
+    byte convert(temp_q4_t* results);
+    inline unsigned int conversionMillis() { return _wait; }
+    inline unsigned long awakeMicros() { return _awake; }
+    inline unsigned int crcErrors() { return _crcErrors; }
+    static int toCentiC(temp_q4_t value);
+  protected:
+    bool readScratchPad(const uint8_t* address, uint8_t* scratchPad);
+    temp_q4_t calculate(const uint8_t* address, const uint8_t* scratchPad);
+    void sleep(unsigned int ms);
+  private:
+    OneWire& _wire;
+    const DeviceAddress* _devices;
+    byte _count;
+    bool _parasite;
+    bool _converting;
+    unsigned int _wait;
+    unsigned long _started;
+    unsigned long _awake;
+    unsigned int _crcErrors;
+};
+
+#endif
@@ -0,0 +1,51 @@
+/* -----------------------------------------------------------------------------
+   Dallas Converter Sleep Convert
+  
+   Converts every thermometer on the bus with one broadcast, powering down 
+   while the conversion runs, and prints each reading in hundredths of a 
+   degree along with the CPU awake time for the whole cycle. Compare with 
+   DallasTemperature::requestTemperatures(), which stays awake for the full 
+   conversion time.
+  
+   Circuit:
+   * OneWire bus attached to digital pin 3
+----------------------------------------------------------------------------- */
+#include <OneWire.h>
+#include <DallasTemperature.h>
+#include <LowPower.h>
+#include <DallasConverter.h>
+
+#define BAUD_RATE     57600
+#define DPIN_ONEWIRE  3
+
+OneWire oneWire(DPIN_ONEWIRE);
+DeviceAddress thermometers[] = {
+  { 0x28, 0xC3, 0x42, 0x77, 0x03, 0x00, 0x00, 0x78 },
+  { 0x10, 0x74, 0x6C, 0x53, 0x02, 0x08, 0x00, 0xE6 }
+};
+DallasConverter converter(oneWire, thermometers, 2);
+temp_q4_t temperatures[2];
+
+void setup() {
+  Serial.begin(BAUD_RATE);
+  Serial.println("\n[Dallas Converter Sleep Convert]");
+  converter.begin();
+  Serial.print("conversion ms: ");
+  Serial.println(converter.conversionMillis());
+}
+
+void loop() {
+  byte valid = converter.convert(temperatures);
+  for (byte i = 0; i < 2; i++) {
+    Serial.print(DallasConverter::toCentiC(temperatures[i]));
+    Serial.print("cC ");
+  }
+  Serial.print("valid: ");
+  Serial.print(valid);
+  Serial.print(", awake us: ");
+  Serial.print(converter.awakeMicros());
+  Serial.print(", crc errors: ");
+  Serial.println(converter.crcErrors());
+  Serial.flush();
+  LowPower.powerDown(SLEEP_4S, ADC_OFF, BOD_OFF);
+}
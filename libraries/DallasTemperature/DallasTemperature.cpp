@@ -49,11 +49,36 @@ void DallasTemperature::setOneWire(OneWire* _oneWire){
     waitForConversion = true;
     checkForConversion = true;
 
+#if REQUIRESROMTABLE
+    romTable.count = 0;
+    romStale = true;
+#endif
+
 }
 
 // initialise the bus
 void DallasTemperature::begin(void){
 
+#if REQUIRESROMTABLE
+
+    // a table restored with setRomTable() is trusted as long as every
+    // device in it still answers; otherwise the bus is searched
+    if (romStale || romTable.count == 0 || !verifyRomTable()) rediscover();
+
+    // any parasite powered device pulls the bus low, so one broadcast
+    // answers for all of them
+    _wire->reset();
+    _wire->skip();
+    _wire->write(READPOWERSUPPLY);
+    if (_wire->read_bit() == 0) parasite = true;
+    _wire->reset();
+
+    for (uint8_t i = 0; i < romTable.count; i++){
+        bitResolution = max(bitResolution, getResolution(romTable.addresses[i]));
+    }
+
+#else
+
     DeviceAddress deviceAddress;
 
     _wire->reset_search();
@@ -75,6 +100,8 @@ void DallasTemperature::begin(void){
         }
     }
 
+#endif
+
 }
 
 // returns the number of devices found on the bus
@@ -91,6 +118,20 @@ bool DallasTemperature::validAddress(const uint8_t* deviceAddress){
 // returns true if the device was found
 bool DallasTemperature::getAddress(uint8_t* deviceAddress, uint8_t index){
 
+#if REQUIRESROMTABLE
+
+    if (romStale) rediscover();
+
+    if (index < romTable.count){
+        memcpy(deviceAddress, romTable.addresses[index], sizeof(DeviceAddress));
+        return true;
+    }
+
+    // only devices beyond the table's capacity need a search
+    if (devices <= DALLAS_ROM_TABLE_SIZE) return false;
+
+#endif
+
     uint8_t depth = 0;
 
     _wire->reset_search();
@@ -117,7 +158,11 @@ bool DallasTemperature::isConnected(const uint8_t* deviceAddress){
 bool DallasTemperature::isConnected(const uint8_t* deviceAddress, uint8_t* scratchPad)
 {
     bool b = readScratchPad(deviceAddress, scratchPad);
-    return b && (_wire->crc8(scratchPad, 8) == scratchPad[SCRATCHPAD_CRC]);
+    b = b && (_wire->crc8(scratchPad, 8) == scratchPad[SCRATCHPAD_CRC]);
+#if REQUIRESROMTABLE
+    if (!b) romStale = true;
+#endif
+    return b;
 }
 
 bool DallasTemperature::readScratchPad(const uint8_t* deviceAddress, uint8_t* scratchPad){
@@ -568,6 +613,85 @@ float DallasTemperature::rawToFahrenheit(int16_t raw){
 
 }
 
+#if REQUIRESROMTABLE
+
+// returns the cached device addresses, e.g. to save them in EEPROM
+const DallasRomTable& DallasTemperature::getRomTable(void){
+    return romTable;
+}
+
+// restores device addresses saved earlier. returns false, leaving the table
+// to be rediscovered, if the saved table is damaged
+bool DallasTemperature::setRomTable(const DallasRomTable& table){
+
+    if (table.count > DALLAS_ROM_TABLE_SIZE) return false;
+    for (uint8_t i = 0; i < table.count; i++){
+        if (!validAddress(table.addresses[i])) return false;
+    }
+
+    romTable = table;
+    devices = table.count;
+    romStale = false;
+    return true;
+
+}
+
+// returns true if every cached device answers with a valid scratchpad
+bool DallasTemperature::verifyRomTable(void){
+
+    for (uint8_t i = 0; i < romTable.count; i++){
+        if (!isConnected(romTable.addresses[i])) return false;
+    }
+    return true;
+
+}
+
+// searches the bus and rebuilds the table. devices that were already known
+// keep their order at the front, so indexes only shift when a device goes
+// missing, and newly found devices are appended. returns the device count
+uint8_t DallasTemperature::rediscover(void){
+
+    DeviceAddress deviceAddress;
+    DeviceAddress added[DALLAS_ROM_TABLE_SIZE];
+    bool present[DALLAS_ROM_TABLE_SIZE];
+    uint8_t addedCount = 0;
+
+    memset(present, false, sizeof(present));
+    devices = 0;
+
+    _wire->reset_search();
+    while (_wire->search(deviceAddress)){
+
+        if (!validAddress(deviceAddress)) continue;
+        devices++;
+
+        uint8_t i = 0;
+        while (i < romTable.count && memcmp(romTable.addresses[i], deviceAddress, sizeof(DeviceAddress)) != 0) i++;
+
+        if (i < romTable.count) present[i] = true;
+        else if (addedCount < DALLAS_ROM_TABLE_SIZE) memcpy(added[addedCount++], deviceAddress, sizeof(DeviceAddress));
+
+    }
+
+    uint8_t count = 0;
+    for (uint8_t i = 0; i < romTable.count; i++){
+        if (present[i]){
+            if (count != i) memcpy(romTable.addresses[count], romTable.addresses[i], sizeof(DeviceAddress));
+            count++;
+        }
+    }
+    for (uint8_t i = 0; i < addedCount && count < DALLAS_ROM_TABLE_SIZE; i++){
+        memcpy(romTable.addresses[count++], added[i], sizeof(DeviceAddress));
+    }
+
+    romTable.count = count;
+    romStale = false;
+    return devices;
+
+}
+
+#endif
+
 #if REQUIRESALARMS
 
 /*
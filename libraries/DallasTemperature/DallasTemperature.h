@@ -18,6 +18,16 @@
 #define REQUIRESALARMS true
 #endif
 
+// set to true to cache device addresses instead of searching the bus for them
+#ifndef REQUIRESROMTABLE
+#define REQUIRESROMTABLE true
+#endif
+
+// number of device addresses held in the ROM table
+#ifndef DALLAS_ROM_TABLE_SIZE
+#define DALLAS_ROM_TABLE_SIZE 4
+#endif
+
 #include <inttypes.h>
 #include <OneWire.h>
 
@@ -60,6 +70,13 @@
 
 typedef uint8_t DeviceAddress[8];
 
+// device addresses in bus search order, as found by begin(); plain data, so
+// it can be saved to EEPROM and handed back to setRomTable() on the next start
+typedef struct {
+    uint8_t count;
+    DeviceAddress addresses[DALLAS_ROM_TABLE_SIZE];
+} DallasRomTable;
+
 class DallasTemperature
 {
 public:
@@ -149,6 +166,21 @@ public:
 
     bool isConversionAvailable(const uint8_t*);
 
+#if REQUIRESROMTABLE
+
+    // returns the cached device addresses
+    const DallasRomTable& getRomTable(void);
+
+    // restores device addresses saved earlier; begin() then only checks that
+    // each one still answers, instead of searching the bus
+    bool setRomTable(const DallasRomTable&);
+
+    // searches the bus again, keeping devices that are still present at the
+    // same index; done automatically after a presence or CRC failure
+    uint8_t rediscover(void);
+
+#endif
+
 #if REQUIRESALARMS
 
     typedef void AlarmHandler(const uint8_t*);
@@ -253,6 +285,19 @@ private:
 
     void	blockTillConversionComplete(uint8_t, const uint8_t*);
 
+#if REQUIRESROMTABLE
+
+    // device addresses, so index lookups need no bus search
+    DallasRomTable romTable;
+
+    // set when a device failed to answer, to rediscover on the next lookup
+    bool romStale;
+
+    // returns true if every cached device answers with a valid scratchpad
+    bool verifyRomTable(void);
+
+#endif
+
 #if REQUIRESALARMS
 
     // required for alarmSearch
@@ -0,0 +1,93 @@
+// Measures what the ROM table saves on a simulated bus of four thermometers.
+//
+// Prints the 1-Wire bus time and address searches of begin(), of four
+// getTempCByIndex() calls, and of the address search per index those calls
+// used to make; then of begin() with a saved table, and of the rediscovery
+// that follows an unplugged device or a bad CRC. Bus time is counted in
+// standard-speed slots by SimulatedOneWire, not measured on hardware.
+//
+// Host only, on the simulated bus: make -C libraries/VirtualAir/host RomCache
+
+#include <OneWire.h>
+#include <DallasTemperature.h>
+
+OneWire oneWire;
+DallasTemperature sensors(&oneWire);
+DallasTemperature restored(&oneWire);
+
+void printCost(const char* label)
+{
+  Serial.print(label);
+  Serial.print(": bus ");
+  Serial.print(oneWire.busMicros() / 1000.0, 1);
+  Serial.print(" ms, searches ");
+  Serial.println(oneWire.searches());
+  oneWire.resetStats();
+}
+
+void setup(void)
+{
+  Serial.begin(9600);
+  Serial.println("Dallas Temperature ROM table");
+
+  oneWire.attach(0x28, 0x077422C3ul, -296);
+  oneWire.attach(0x10, 0x02536C74ul, 400);
+  oneWire.attach(0x28, 0x01111111ul, 80);
+  oneWire.attach(0x28, 0x02222222ul, 81);
+
+  oneWire.resetStats();
+  sensors.begin();
+  printCost("begin()");
+
+  sensors.setWaitForConversion(false);
+  sensors.requestTemperatures();
+  oneWire.resetStats();
+  for (uint8_t i = 0; i < 4; i++) sensors.getTempCByIndex(i);
+  printCost("4 x getTempCByIndex()");
+
+  // without the table, each index lookup searched the bus up to that index
+  DeviceAddress address;
+  for (uint8_t i = 0; i < 4; i++)
+  {
+    oneWire.reset_search();
+    for (uint8_t d = 0; d <= i; d++) oneWire.search(address);
+  }
+  printCost("4 x lookup by search");
+
+  // a table saved by the last boot only needs verifying
+  DallasRomTable saved = sensors.getRomTable();
+  restored.setRomTable(saved);
+  oneWire.resetStats();
+  restored.begin();
+  printCost("begin() with saved table");
+
+  // unplug the device at index 0: the next lookup rediscovers the rest
+  DeviceAddress third, second;
+  sensors.getAddress(third, 2);
+  for (uint8_t i = 0; i < 4; i++)
+    if (memcmp(oneWire.device(i)->rom, saved.addresses[0], 8) == 0) oneWire.device(i)->present = false;
+  oneWire.resetStats();
+  sensors.getTempCByIndex(0);
+  sensors.getAddress(second, 1);
+  printCost("unplugged index 0");
+  Serial.print("  devices left: ");
+  Serial.print(sensors.getDeviceCount());
+  Serial.print(", index 2 moved to index 1: ");
+  Serial.println(memcmp(third, second, 8) == 0 ? "yes" : "no");
+
+  // a bad CRC marks the table stale as well
+  for (uint8_t i = 0; i < 4; i++) oneWire.device(i)->present = true;
+  oneWire.device(1)->corrupt = true;
+  oneWire.resetStats();
+  for (uint8_t i = 0; i < 3; i++) restored.getTempCByIndex(i);
+  printCost("bad CRC on index 1");
+
+  // and a damaged table is refused
+  saved.addresses[1][3] ^= 1;
+  Serial.print("damaged table accepted: ");
+  Serial.println(restored.setRomTable(saved) ? "yes" : "no");
+}
+
+void loop(void)
+{
+}
@@ -5,6 +5,50 @@
 
 enum { EMB_ANY, EMB_LEN, EMB_INT, EMB_STR };
 
+uint8_t EmBencode::formatCount (uint32_t num, char* buf) {
+  char tmp[10];
+  uint8_t n = 0;
+  while (num > 0xFFFF) {
+    tmp[n++] = '0' + num % 10;
+    num /= 10;
+  }
+  uint16_t small = num;
+  do {
+    tmp[n++] = '0' + small % 10;
+    small /= 10;
+  } while (small != 0);
+  for (uint8_t i = 0; i < n; ++i)
+    buf[i] = tmp[n - 1 - i];
+  return n;
+}
+
+void EmBencodeBuf::push (const void* ptr, uint8_t len) {
+  char buf[10];
+  PushData(buf, EmBencode::formatCount(len, buf));
+  PushChar(':');
+  PushData(ptr, len);
+}
+
+void EmBencodeBuf::push (long val) {
+  char buf[10];
+  PushChar('i');
+  if (val < 0) {
+    PushChar('-');
+    val = -val;
+  }
+  PushData(buf, EmBencode::formatCount(val, buf));
+  PushChar('e');
+}
+
+void EmBencodeBuf::PushData (const void* ptr, uint8_t len) {
+  if (len > bufLen - fill) {
+    overflow = true;
+    len = bufLen - fill;
+  }
+  memcpy(bufPtr + fill, ptr, len);
+  fill += len;
+}
+
 uint8_t EmBdecode::reset () {
   count = next;
   level = next = 0;
@@ -105,3 +149,65 @@ const char* EmBdecode::asString (uint8_t* plen) {
 long EmBdecode::asNumber () {
   return atol(bufPtr + last);
 }
+
+enum { EXT_IDLE, EXT_ITEM, EXT_INT };
+
+void EmBextract::reset () {
+  state = EXT_IDLE;
+}
+
+uint8_t EmBextract::process (char ch) {
+  switch (state) {
+    case EXT_IDLE:
+      if (ch == 'l') {
+        fill = digits = 0;
+        depth = 1;
+        nested = false;
+        state = EXT_ITEM;
+      }
+      return X_MORE;
+    case EXT_ITEM:
+      if (ch == 'i') {
+        if (fill >= destLen || (depth == 1 && fill >= headLen))
+          return Reject(); // too many values, or data outside nested list
+        value = digits = 0;
+        state = EXT_INT;
+        return X_MORE;
+      }
+      if (ch == 'l') {
+        if (depth != 1 || fill != headLen || nested)
+          return Reject(); // only one nested list, right after the head
+        ++depth;
+        nested = true;
+        return X_MORE;
+      }
+      if (ch == 'e') {
+        if (--depth > 0)
+          return X_MORE; // end of nested list
+        if (fill < headLen)
+          return Reject(); // head incomplete
+        memset(destPtr + fill, 0, destLen - fill);
+        state = EXT_IDLE;
+        return X_DONE;
+      }
+      return Reject(); // strings and dicts are not expected
+    case EXT_INT:
+      if (ch == 'e' && digits > 0) {
+        destPtr[fill++] = value;
+        state = EXT_ITEM;
+        return X_MORE;
+      }
+      if (ch < '0' || ch > '9' || (digits > 0 && value == 0))
+        return Reject(); // no sign, no leading zeros
+      value = 10 * value + (ch - '0');
+      if (++digits > 3 || value > 255)
+        return Reject();
+      return X_MORE;
+  }
+  return Reject();
+}
+
+uint8_t EmBextract::Reject () {
+  state = EXT_IDLE;
+  return X_ERROR;
+}
@@ -61,10 +61,18 @@ public:
     PushEnd();
   }
 
+  /// Format an unsigned number as decimal digits, without trailing \0.
+  /// Values up to 65535 use 16-bit division, which is much cheaper than the
+  /// 32-bit division behind ultoa() on an 8-bit AVR.
+  /// @param num The number to format.
+  /// @param buf Receives the digits, must have room for 10 characters.
+  /// @return Returns the number of digits written.
+  static uint8_t formatCount (uint32_t num, char* buf);
+
 protected:
   static void PushCount (uint32_t num) {
-    char buf[11];
-    PushData(ultoa(num, buf, 10), strlen(buf));
+    char buf[10];
+    PushData(buf, formatCount(num, buf));
   }
 
   static void PushEnd () {
@@ -81,6 +89,69 @@ protected:
   static void PushChar (char ch);
 };
 
+/// Buffered encoder: formats into a caller-provided buffer, then hands the
+/// complete message to a sink with a single bulk write. Each instance has its
+/// own buffer, so several can coexist, e.g. one for serial and one for radio.
+class EmBencodeBuf {
+public:
+  /// Initialize an encoder instance with the specified buffer space.
+  /// @param buf Pointer to the buffer which will hold the encoded message.
+  /// @param len Size of the buffer, up to 255.
+  EmBencodeBuf (char* buf, uint8_t len) 
+    : bufPtr (buf), bufLen (len) { reset(); }
+
+  /// Discard the buffered message and start a new one.
+  void reset () { fill = 0; overflow = false; }
+
+  /// Push a string in Bencode format.
+  void push (const char* str) { push(str, strlen(str)); }
+  /// Push arbitrary bytes in Bencode format.
+  void push (const void* ptr, uint8_t len);
+  /// Push a signed integer in Bencode format.
+  void push (long val);
+
+  /// Start a new list, must be matched with a call to endList().
+  void startList () { PushChar('l'); }
+  /// Terminate a list, started earlier with a call to startList().
+  void endList () { PushChar('e'); }
+  /// Start a new dictionary, must be matched with a call to endDict().
+  void startDict () { PushChar('d'); }
+  /// Terminate a dictionary, started earlier with a call to startDict().
+  void endDict () { PushChar('e'); }
+
+  /// @return Returns a pointer to the encoded bytes.
+  const char* data () const { return bufPtr; }
+  /// @return Returns the number of encoded bytes so far.
+  uint8_t length () const { return fill; }
+  /// @return Returns true if the message did not fit in the buffer.
+  bool overflowed () const { return overflow; }
+
+  /// Write the message to a sink in one call and start a new message.
+  /// @param sink Any object with write(const uint8_t*, size_t), such as
+  ///             Serial; a truncated message is dropped, not written.
+  /// @return Returns the number of bytes written.
+  template <typename Sink>
+  size_t flush (Sink& sink) {
+    size_t n = overflow ? 0 : sink.write((const uint8_t*) bufPtr, fill);
+    reset();
+    return n;
+  }
+
+protected:
+  void PushChar (char ch) {
+    if (fill < bufLen)
+      bufPtr[fill++] = ch;
+    else
+      overflow = true;
+  }
+
+  void PushData (const void* ptr, uint8_t len);
+
+  char* bufPtr;
+  uint8_t bufLen, fill;
+  bool overflow;
+};
+
 /// Decoder class, needs an external buffer to collect the incoming data.
 class EmBdecode {
 public:
@@ -117,3 +188,44 @@ protected:
   char level, *bufPtr; 
   uint8_t bufLen, count, next, last, state;
 };
+
+/// Streaming extractor for lists of byte-sized integers, such as the
+/// [type, network, src, dest, [data...]] events exchanged with a gateway.
+/// Each value is stored straight into the destination as its characters
+/// arrive, so there is no decode buffer and no second pass over the data.
+/// The expected shape is checked on the fly: `head` integers, then at most
+/// one nested list with the rest. Every character costs constant time, and
+/// malformed input is rejected at the first character that breaks the shape.
+class EmBextract {
+public:
+  /// Results returned by process().
+  enum { X_MORE = 0, X_DONE, X_ERROR };
+
+  /// Initialize an extractor which fills the specified destination.
+  /// @param dest Pointer to the bytes to fill, e.g. a message's raw array.
+  /// @param len Maximum number of values, i.e. the size of dest.
+  /// @param head Number of values before the nested list, if any.
+  EmBextract (uint8_t* dest, uint8_t len, uint8_t head)
+    : destPtr (dest), destLen (len), headLen (head) { reset(); }
+
+  /// Abandon the current message and wait for the next one.
+  void reset ();
+
+  /// Process a single incoming character. Characters outside a list are
+  /// skipped, so line endings between messages are harmless.
+  /// @return Returns X_DONE when dest holds a complete message (with unused
+  ///         bytes cleared), X_ERROR when the message was rejected, and
+  ///         X_MORE otherwise. The contents of dest are only valid on X_DONE.
+  uint8_t process (char ch);
+
+  /// @return Returns the number of values stored for the last message.
+  uint8_t count () const { return fill; }
+
+protected:
+  uint8_t Reject ();
+
+  uint8_t *destPtr;
+  uint8_t destLen, headLen, fill, depth, digits, state;
+  uint16_t value;
+  bool nested;
+};
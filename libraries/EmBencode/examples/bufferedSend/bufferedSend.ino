@@ -0,0 +1,52 @@
+/// @dir bufferedSend
+/// Demo sketch for the buffered encoder: two independent encoders, each
+/// flushed to its own sink with a single write per message.
+
+#include "EmBencode.h"
+
+/// Any class with write(const uint8_t*, size_t) can be a sink. This one
+/// just counts, standing in for e.g. a radio packet buffer.
+struct CountingSink {
+  size_t bytes, writes;
+  size_t write (const uint8_t* ptr, size_t len) {
+    bytes += len;
+    ++writes;
+    return len;
+  }
+};
+
+char serialBuf[64], otherBuf[64];
+EmBencodeBuf serialEncoder (serialBuf, sizeof serialBuf);
+EmBencodeBuf otherEncoder (otherBuf, sizeof otherBuf);
+CountingSink counter;
+
+static void encodeReading (EmBencodeBuf& encoder, long value) {
+  encoder.startList();
+    encoder.push("temp");
+    encoder.push(value);
+  encoder.endList();
+}
+
+void setup () {
+  Serial.begin(57600);
+  Serial.println("\n[bufferedSend]");
+}
+
+void loop () {
+  unsigned long start = micros();
+  encodeReading(serialEncoder, -18);
+  encodeReading(otherEncoder, 21);
+  unsigned long elapsed = micros() - start;
+
+  serialEncoder.flush(Serial);
+  Serial.println();
+  otherEncoder.flush(counter);
+
+  Serial.print("encode us: ");
+  Serial.print(elapsed);
+  Serial.print(", other sink bytes/writes: ");
+  Serial.print(counter.bytes);
+  Serial.print('/');
+  Serial.println(counter.writes);
+  delay(3000);
+}
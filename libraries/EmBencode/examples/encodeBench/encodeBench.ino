@@ -0,0 +1,158 @@
+/// @dir encodeBench
+/// Times the encoders on the events rf_gateway_mote_v0_2 writes to serial:
+/// [type, network, src, dest, [data...]], 20 byte-sized values each.
+///
+/// - old: one sink call per character, numbers through ultoa() and strlen(),
+///   as EmBencode::PushCount did before EmBencodeBuf
+/// - per-char: the static EmBencode, one sink call per character
+/// - buffered: EmBencodeBuf, one sink call per event
+///
+/// All three must produce the same bytes. The sink only sums what it gets,
+/// so the host numbers leave out the cost of a Serial.write() call, which
+/// is what the buffered encoder saves most of on the AVR.
+///
+/// Host only, for the run lengths and clock():
+///   make -C libraries/VirtualAir/host encodeBench
+
+#include <time.h>
+#include "EmBencode.h"
+
+#define MSG_VALUES  20
+#define MSG_HEAD    4
+#define STREAM_MSGS 20000
+#define REPEATS     100
+
+/// Counts and sums what it is given, standing in for Serial.
+struct SumSink {
+  uint32_t bytes, writes, sum;
+  __attribute__((noinline))
+  size_t write (const uint8_t* ptr, size_t len) {
+    for (size_t i = 0; i < len; ++i)
+      sum = sum * 31 + ptr[i];
+    bytes += len;
+    ++writes;
+    return len;
+  }
+};
+
+uint8_t events [STREAM_MSGS][MSG_VALUES];
+char txbuf [128];
+EmBencodeBuf encoder (txbuf, sizeof txbuf);
+SumSink sink;
+
+void EmBencode::PushChar (char ch) {
+  sink.write((const uint8_t*) &ch, 1);
+}
+
+/// The old number formatting: ultoa() divides in 32 bits for every digit,
+/// then strlen() walks the result again.
+static char* oldUltoa (uint32_t num, char* buf) {
+  char* p = buf;
+  do {
+    *p++ = '0' + num % 10;
+    num /= 10;
+  } while (num != 0);
+  *p = 0;
+  for (char *a = buf, *b = p - 1; a < b; ++a, --b) {
+    char t = *a;
+    *a = *b;
+    *b = t;
+  }
+  return buf;
+}
+
+static void oldChar (char ch) {
+  sink.write((const uint8_t*) &ch, 1);
+}
+
+static void oldPush (long val) {
+  char buf[11];
+  oldChar('i');
+  if (val < 0) {
+    oldChar('-');
+    val = -val;
+  }
+  oldUltoa(val, buf);
+  for (uint8_t i = 0, n = strlen(buf); i < n; ++i)
+    oldChar(buf[i]);
+  oldChar('e');
+}
+
+static void oldEncode (const uint8_t* event) {
+  oldChar('l');
+  for (uint8_t i = 0; i < MSG_VALUES; ++i) {
+    if (i == MSG_HEAD)
+      oldChar('l');
+    oldPush(event[i]);
+  }
+  oldChar('e');
+  oldChar('e');
+}
+
+static void perCharEncode (const uint8_t* event) {
+  EmBencode::startList();
+  for (uint8_t i = 0; i < MSG_VALUES; ++i) {
+    if (i == MSG_HEAD)
+      EmBencode::startList();
+    EmBencode::push((long) event[i]);
+  }
+  EmBencode::endList();
+  EmBencode::endList();
+}
+
+static void bufferedEncode (const uint8_t* event) {
+  encoder.startList();
+  for (uint8_t i = 0; i < MSG_VALUES; ++i) {
+    if (i == MSG_HEAD)
+      encoder.startList();
+    encoder.push((long) event[i]);
+  }
+  encoder.endList();
+  encoder.endList();
+  encoder.flush(sink);
+}
+
+/// Runs one encoder over the stream REPEATS times, printing its MB/s and
+/// sink calls per event; returns the checksum of one more pass.
+static uint32_t bench (const char* label, void (*encode)(const uint8_t*)) {
+  sink.bytes = sink.writes = sink.sum = 0;
+  clock_t start = clock();
+  for (uint8_t k = 0; k < REPEATS; ++k)
+    for (int n = 0; n < STREAM_MSGS; ++n)
+      encode(events[n]);
+  double seconds = (double) (clock() - start) / CLOCKS_PER_SEC;
+  Serial.print(label);
+  Serial.print(sink.bytes / 1e6 / seconds, 1);
+  Serial.print(" MB/s, ");
+  Serial.print((double) sink.writes / REPEATS / STREAM_MSGS, 1);
+  Serial.println(" sink calls per event");
+  sink.bytes = sink.writes = sink.sum = 0;
+  for (int n = 0; n < STREAM_MSGS; ++n)
+    encode(events[n]);
+  return sink.sum;
+}
+
+void setup () {
+  Serial.begin(57600);
+  Serial.println("\n[encodeBench]");
+  randomSeed(32);
+  for (int n = 0; n < STREAM_MSGS; ++n)
+    for (uint8_t i = 0; i < MSG_VALUES; ++i)
+      events[n][i] = random(256);
+
+  for (uint8_t rep = 0; rep < 3; ++rep) {
+    uint32_t oldSum = bench("old:      ", oldEncode);
+    uint32_t charSum = bench("per-char: ", perCharEncode);
+    uint32_t bufSum = bench("buffered: ", bufferedEncode);
+    if (charSum != oldSum || bufSum != oldSum) {
+      Serial.println("encoders disagree");
+      return;
+    }
+  }
+  Serial.print("average event: ");
+  Serial.print(sink.bytes / STREAM_MSGS);
+  Serial.println(" chars");
+}
+
+void loop () {
+}
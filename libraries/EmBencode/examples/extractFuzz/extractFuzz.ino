@@ -0,0 +1,227 @@
+/// @dir extractFuzz
+/// Checks EmBextract against random and damaged input, and times it against
+/// EmBdecode plus the token loop it replaced in rf_gateway_mote_v0_2.
+///
+/// - round trip: random events of 4..20 values must decode exactly
+/// - fuzz: mutated events and random garbage, decoded into a guarded buffer,
+///   must never write outside it, and a valid event must decode right after
+/// - rejects: a few malformed events, each with its error and done counts
+/// - throughput: MB/s of both decoders on the same stream of events
+///
+/// Host only, for the run lengths and clock():
+///   make -C libraries/VirtualAir/host extractFuzz
+
+#include <time.h>
+#include "EmBencode.h"
+
+#define MSG_VALUES  20
+#define MSG_HEAD    4
+#define ROUND_TRIPS 100000L
+#define FUZZ_RUNS   1000000L
+#define STREAM_MSGS 20000
+#define REPEATS     10
+
+const char alphabet[] = "li0123456789e-d:x \n";
+const char* malformed[] = {
+  "li1ei2ei3ei256eee", "li1ei2ei3eli4eee", "li1ei2ei3ei4eli1eeli2eee",
+  "li01ei2ei3ei4ee", "li-1ei2ei3ei4ee", "lie", "l4:abcdi2ei3ei4ee",
+  "li1ei2ei3ei4ei5ee", "li1ei2ei3ei4elllee"
+};
+
+uint8_t raw[MSG_VALUES], out[MSG_VALUES];
+EmBextract extractor (out, MSG_VALUES, MSG_HEAD);
+char embuf [160];
+EmBdecode decoder (embuf, sizeof embuf);
+char stream [STREAM_MSGS * 112];
+
+/// Bencodes the first count values of raw as the gateway's serial events
+/// are: the head values, then a nested list with the rest.
+static size_t encode (char* buf, uint8_t count) {
+  size_t len = 0;
+  buf[len++] = 'l';
+  for (uint8_t i = 0; i < count; ++i) {
+    if (i == MSG_HEAD)
+      buf[len++] = 'l';
+    len += sprintf(buf + len, "i%de", raw[i]);
+  }
+  if (count <= MSG_HEAD)
+    buf[len++] = 'l';
+  len += sprintf(buf + len, "ee\n");
+  return len;
+}
+
+static void randomize (uint8_t count) {
+  for (uint8_t i = 0; i < MSG_VALUES; ++i)
+    raw[i] = i < count ? random(256) : 0;
+}
+
+/// Feeds len characters to an extractor, counting its results.
+static void feed (EmBextract& ex, const char* buf, size_t len,
+                  long& done, long& errors) {
+  for (size_t i = 0; i < len; ++i) {
+    uint8_t r = ex.process(buf[i]);
+    done += r == EmBextract::X_DONE;
+    errors += r == EmBextract::X_ERROR;
+  }
+}
+
+/// The old path: EmBdecode, then a pass over its tokens into raw.
+static long oldDecode (const char* buf, size_t len) {
+  long msgs = 0;
+  for (size_t n = 0; n < len; ++n) {
+    if (decoder.process(buf[n]) > 0) {
+      uint8_t i = 0;
+      while (i < MSG_VALUES) {
+        uint8_t token = decoder.nextToken();
+        if (token == EmBdecode::T_END)
+          break;
+        if (token == EmBdecode::T_NUMBER)
+          raw[i++] = decoder.asNumber();
+      }
+      decoder.reset();
+      while (i < MSG_VALUES)
+        raw[i++] = 0;
+      ++msgs;
+    }
+  }
+  return msgs;
+}
+
+static bool roundTrip () {
+  char buf [128];
+  for (long t = 0; t < ROUND_TRIPS; ++t) {
+    uint8_t count = MSG_HEAD + random(MSG_VALUES - MSG_HEAD + 1);
+    randomize(count);
+    long done = 0, errors = 0;
+    feed(extractor, buf, encode(buf, count), done, errors);
+    if (errors || done != 1 || memcmp(raw, out, MSG_VALUES)) {
+      Serial.print("round trip failed: ");
+      Serial.print(buf);
+      return false;
+    }
+  }
+  Serial.print("round trip ok: ");
+  Serial.print(ROUND_TRIPS);
+  Serial.println(" events");
+  return true;
+}
+
+static bool fuzz () {
+  char buf [128];
+  uint8_t guard [3 * MSG_VALUES];
+  long done = 0, errors = 0;
+  for (long t = 0; t < FUZZ_RUNS; ++t) {
+    memset(guard, 0xAA, sizeof guard);
+    EmBextract fx (guard + MSG_VALUES, MSG_VALUES, MSG_HEAD);
+    size_t len = 0;
+    if (t & 1) {
+      randomize(MSG_VALUES);
+      len = encode(buf, MSG_HEAD + random(MSG_VALUES - MSG_HEAD + 1));
+      for (uint8_t m = random(1, 4); m > 0; --m) {
+        size_t p = random(len);
+        switch (random(3)) {
+          case 0: // replace
+            buf[p] = alphabet[random(sizeof alphabet - 1)];
+            break;
+          case 1: // delete
+            memmove(buf + p, buf + p + 1, --len - p);
+            break;
+          case 2: // insert
+            memmove(buf + p + 1, buf + p, len++ - p);
+            buf[p] = alphabet[random(sizeof alphabet - 1)];
+            break;
+        }
+      }
+    } else {
+      len = random(120);
+      for (size_t i = 0; i < len; ++i)
+        buf[i] = alphabet[random(sizeof alphabet - 1)];
+    }
+    feed(fx, buf, len, done, errors);
+    for (uint8_t i = 0; i < MSG_VALUES; ++i)
+      if (guard[i] != 0xAA || guard[2 * MSG_VALUES + i] != 0xAA) {
+        Serial.println("fuzz failed: wrote outside dest");
+        return false;
+      }
+    // a valid event must decode after whatever came before
+    fx.reset();
+    randomize(MSG_VALUES);
+    long resynced = 0, ignored = 0;
+    feed(fx, buf, encode(buf, MSG_VALUES), resynced, ignored);
+    if (resynced != 1 || memcmp(raw, guard + MSG_VALUES, MSG_VALUES)) {
+      Serial.println("fuzz failed: no resync");
+      return false;
+    }
+  }
+  Serial.print("fuzz ok: ");
+  Serial.print(FUZZ_RUNS);
+  Serial.print(" inputs, ");
+  Serial.print(errors);
+  Serial.print(" rejected, ");
+  Serial.print(done);
+  Serial.println(" accepted");
+  return true;
+}
+
+static void rejects () {
+  for (uint8_t n = 0; n < sizeof malformed / sizeof malformed[0]; ++n) {
+    EmBextract bx (out, MSG_VALUES, MSG_HEAD);
+    long done = 0, errors = 0;
+    feed(bx, malformed[n], strlen(malformed[n]), done, errors);
+    Serial.print("  ");
+    Serial.print(malformed[n]);
+    Serial.print(" errors=");
+    Serial.print(errors);
+    Serial.print(" done=");
+    Serial.println(done);
+  }
+}
+
+static double mbPerSecond (size_t bytes, clock_t start) {
+  return REPEATS * bytes / 1e6 / ((double) (clock() - start) / CLOCKS_PER_SEC);
+}
+
+static void throughput () {
+  size_t len = 0;
+  for (int n = 0; n < STREAM_MSGS; ++n) {
+    randomize(MSG_VALUES);
+    len += encode(stream + len, MSG_VALUES);
+  }
+  for (uint8_t rep = 0; rep < 3; ++rep) {
+    clock_t start = clock();
+    long oldMsgs = 0;
+    for (uint8_t k = 0; k < REPEATS; ++k)
+      oldMsgs += oldDecode(stream, len);
+    double oldRate = mbPerSecond(len, start);
+    start = clock();
+    long newMsgs = 0, errors = 0;
+    for (uint8_t k = 0; k < REPEATS; ++k)
+      feed(extractor, stream, len, newMsgs, errors);
+    double newRate = mbPerSecond(len, start);
+    Serial.print("EmBdecode: ");
+    Serial.print(oldMsgs);
+    Serial.print(" events ");
+    Serial.print(oldRate, 1);
+    Serial.print(" MB/s, EmBextract: ");
+    Serial.print(newMsgs);
+    Serial.print(" events ");
+    Serial.print(newRate, 1);
+    Serial.println(" MB/s");
+  }
+  Serial.print("average event: ");
+  Serial.print(len / STREAM_MSGS);
+  Serial.println(" chars");
+}
+
+void setup () {
+  Serial.begin(57600);
+  Serial.println("\n[extractFuzz]");
+  randomSeed(32);
+  if (roundTrip() && fuzz()) {
+    rejects();
+    throughput();
+  }
+}
+
+void loop () {
+}
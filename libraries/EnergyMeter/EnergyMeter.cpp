@@ -0,0 +1,241 @@
+/*
+  EnergyMeter.cpp - Logic for battery charge accounting.
+  Created by Jon R. Brule, October 19, 2026.
+  Released into the public domain.
+*/
+#include "Arduino.h"
+#include <util/atomic.h>
+#include "EnergyMeter.h"
+
+#define ENERGY_RADIO_ASLEEP  0xFF
+
+static const unsigned long defaultCurrents[ENERGY_STATES] = {
+  ENERGY_ACTIVE_UA, ENERGY_ADC_UA, ENERGY_SLEEP_UA,
+  ENERGY_STANDBY_UA, ENERGY_RX_UA, ENERGY_TX_UA, ENERGY_LISTEN_UA
+};
+
+//-----------------------------------------------------------------------------
+EnergyMeter::EnergyMeter() {
+  _radio = NULL;
+  _radioState = ENERGY_RADIO_ASLEEP;
+  memcpy(_currents, defaultCurrents, sizeof(_currents));
+  begin();
+}
+
+//-----------------------------------------------------------------------------
+// Starts a new accounting period; the radio counters restart with it.
+//
+void EnergyMeter::begin() {
+  ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+    memset(_millis, 0, sizeof(_millis));
+    memset(_micros, 0, sizeof(_micros));
+    _begun = millis();
+    _mcuState = ENERGY_ACTIVE;
+    _mcuSince = micros();
+    _radioSince = micros();
+    if (_radio != NULL) {
+      memset(&_radio->stats, 0, sizeof(_radio->stats));
+    }
+  }
+}
+
+//-----------------------------------------------------------------------------
+void EnergyMeter::attachRadio(RFM69& radio) {
+  _radio = &radio;
+  _radioState = ENERGY_STANDBY;   // RFM69's state after initialize()
+  _radioSince = micros();
+  radio.setModeHook(onRadioMode, this);
+}
+
+//-----------------------------------------------------------------------------
+// Switches the MCU state. Time asleep is taken from millis(), which stops
+// in power down unless it is moved on afterwards (SleepManager does this);
+// the shorter states are timed with micros().
+//
+void EnergyMeter::enter(byte state) {
+  ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+    update();
+    _mcuState = state;
+    _mcuSince = (state == ENERGY_SLEEP) ? millis() : micros();
+  }
+}
+
+//-----------------------------------------------------------------------------
+void EnergyMeter::setCurrent(byte state, unsigned long microamps) {
+  if (state < ENERGY_STATES) {
+    _currents[state] = microamps;
+  }
+}
+
+//-----------------------------------------------------------------------------
+// The states nobody enters explicitly are what is left of the elapsed time:
+// the MCU is ACTIVE unless in ADC or SLEEP, and the radio sleeps unless in
+// STANDBY, RX, TX or LISTEN. Radio sleep is counted as part of ENERGY_SLEEP's
+// current, so it has no state of its own.
+//
+unsigned long EnergyMeter::millisIn(byte state) {
+  unsigned long result;
+  ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+    update();
+    if (state == ENERGY_ACTIVE) {
+      unsigned long elapsed = millis() - _begun;
+      unsigned long other = _millis[ENERGY_ADC] + _millis[ENERGY_SLEEP];
+      result = (elapsed > other) ? elapsed - other : 0;
+    } else {
+      result = _millis[state] + _micros[state] / 1000;
+    }
+  }
+  return result;
+}
+
+//-----------------------------------------------------------------------------
+// Estimated, not measured: the time in each state times its current.
+//
+float EnergyMeter::usedMah() {
+  float microampMillis = 0;
+  for (byte state = 0; state < ENERGY_STATES; state++) {
+    microampMillis += (float) millisIn(state) * _currents[state];
+  }
+  return microampMillis / 3.6e9;
+}
+
+//-----------------------------------------------------------------------------
+unsigned int EnergyMeter::averageMicroamps() {
+  unsigned long elapsed = millis() - _begun;
+  if (elapsed == 0) {
+    return 0;
+  }
+  float average = usedMah() * 3.6e9 / elapsed;
+  return (average > 65535) ? 65535 : (unsigned int) average;
+}
+
+//-----------------------------------------------------------------------------
+void EnergyMeter::summarize(EnergySummary* summary) {
+  float tenths = usedMah() * 10;
+  summary->averageMicroamps = averageMicroamps();
+  summary->usedTenthsMah = (tenths > 65535) ? 65535 : (uint16_t) tenths;
+  summary->frames = 0;
+  summary->retries = 0;
+  summary->failures = 0;
+  if (_radio != NULL) {
+    summary->frames = min(_radio->stats.frames, 65535UL);
+    summary->retries = min(_radio->stats.retries, 255);
+    summary->failures = min(_radio->stats.failures, 255);
+  }
+}
+
+//-----------------------------------------------------------------------------
+void EnergyMeter::printLog(Print& out) {
+  static const char labels[] = "active\0adc\0sleep\0standby\0rx\0tx\0listen";
+  const char* label = labels;
+  out.print("energy");
+  for (byte state = 0; state < ENERGY_STATES; state++) {
+    out.print(state == ENERGY_STANDBY ? ", radio " : " ");
+    out.print(label);
+    out.print(' ');
+    out.print(millisIn(state));
+    out.print("ms");
+    label += strlen(label) + 1;
+  }
+  if (_radio != NULL) {
+    out.print(", frames ");
+    out.print(_radio->stats.frames);
+    out.print(" (");
+    out.print(_radio->stats.bytes);
+    out.print(" bytes, ");
+    out.print(_radio->stats.retries);
+    out.print(" retries, ");
+    out.print(_radio->stats.backoffs);
+    out.print(" backoffs, ");
+    out.print(_radio->stats.failures);
+    out.print(" failed)");
+  }
+  out.print(", est. ");
+  out.print(usedMah(), 3);
+  out.print("mAh, ");
+  out.print(averageMicroamps());
+  out.println("uA avg");
+}
+
+//-----------------------------------------------------------------------------
+// Hours until a battery of the given capacity is drawn down at the average
+// current in the summary; 65535 when that is too far off to tell.
+//
+unsigned int EnergyMeter::hoursLeft(const EnergySummary* summary, unsigned int capacityMah) {
+  unsigned long used = summary->usedTenthsMah / 10;
+  if (summary->averageMicroamps == 0) {
+    return 65535;
+  }
+  if (used >= capacityMah) {
+    return 0;
+  }
+  unsigned long hours = (capacityMah - used) * 1000UL / summary->averageMicroamps;
+  return (hours > 65535) ? 65535 : hours;
+}
+
+//-----------------------------------------------------------------------------
+void EnergyMeter::add(byte state, unsigned long elapsed) {
+  _micros[state] += elapsed;
+  if (_micros[state] >= 1000000UL) {
+    _millis[state] += _micros[state] / 1000;
+    _micros[state] %= 1000;
+  }
+}
+
+//-----------------------------------------------------------------------------
+// Charges the time since the last change to the current MCU and radio
+// states. Called with interrupts off.
+//
+void EnergyMeter::update() {
+  unsigned long now = micros();
+  if (_mcuState == ENERGY_SLEEP) {
+    unsigned long ms = millis();
+    _millis[ENERGY_SLEEP] += ms - _mcuSince;
+    _mcuSince = ms;
+  } else {
+    if (_mcuState != ENERGY_ACTIVE) {
+      add(_mcuState, now - _mcuSince);
+    }
+    _mcuSince = now;
+  }
+  if (_radio != NULL && _radioState == ENERGY_LISTEN) {
+    unsigned long ms = millis();
+    _millis[ENERGY_LISTEN] += ms - _radioSince;
+    _radioSince = ms;
+  } else {
+    if (_radio != NULL && _radioState != ENERGY_RADIO_ASLEEP) {
+      add(_radioState, now - _radioSince);
+    }
+    _radioSince = now;
+  }
+}
+
+//-----------------------------------------------------------------------------
+void EnergyMeter::radioMode(byte mode) {
+  ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+    update();
+    switch (mode) {
+      case RF69_MODE_RX:
+        _radioState = ENERGY_RX;
+        break;
+      case RF69_MODE_TX:
+        _radioState = ENERGY_TX;
+        break;
+      case RF69_MODE_SLEEP:
+        _radioState = ENERGY_RADIO_ASLEEP;
+        break;
+      case RF69_MODE_LISTEN:
+        _radioState = ENERGY_LISTEN;
+        break;
+      default:
+        _radioState = ENERGY_STANDBY;
+        break;
+    }
+    _radioSince = (_radioState == ENERGY_LISTEN) ? millis() : micros();
+  }
+}
+
+//-----------------------------------------------------------------------------
+void EnergyMeter::onRadioMode(void* meter, byte mode) {
+  ((EnergyMeter*) meter)->radioMode(mode);
+}
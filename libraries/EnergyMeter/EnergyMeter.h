@@ -0,0 +1,80 @@
+/*
+  EnergyMeter.h - Library for battery charge accounting.
+  Created by Jon R. Brule, October 19, 2026.
+  Released into the public domain.
+  
+  Tracks the time a mote spends in each power state and turns it into an
+  estimate of the charge drawn, from one current constant per state. The
+  MCU states are entered explicitly with enter(); the radio states follow
+  the RFM69 through its mode hook, along with its frame and retry counts.
+  The estimate is only as good as the constants: measure a board once and
+  pass the figures to setCurrent().
+*/
+#ifndef EnergyMeter_h
+#define EnergyMeter_h
+
+#include "Arduino.h"
+#include <RFM69.h>
+
+// MCU states, set with enter(); time not spent in ADC or SLEEP is ACTIVE
+#define ENERGY_ACTIVE     0
+#define ENERGY_ADC        1   // sampling, e.g. in ADC noise reduction sleep
+#define ENERGY_SLEEP      2   // powered down; needs millis() kept across sleep
+// radio states, followed automatically; the rest of the time it sleeps
+#define ENERGY_STANDBY    3
+#define ENERGY_RX         4
+#define ENERGY_TX         5
+#define ENERGY_LISTEN     6   // listen mode, timed with millis() as it spans MCU sleep
+#define ENERGY_STATES     7
+
+// Typical Moteino (ATmega328P at 16MHz, 3.3V) and RFM69W figures.
+#define ENERGY_ACTIVE_UA    5500
+#define ENERGY_ADC_UA       1000
+#define ENERGY_SLEEP_UA     6       // watchdog and regulator, radio asleep
+#define ENERGY_STANDBY_UA   1250
+#define ENERGY_RX_UA        16000
+#define ENERGY_TX_UA        45000   // +13dBm; an RFM69HW at +20dBm draws 130mA
+#define ENERGY_LISTEN_UA    10      // RF69_LISTEN_RX_US in RX every RF69_LISTEN_IDLE_US, 1.2uA between
+
+// Compact summary for piggybacking on reports (8 bytes, little endian).
+// A gateway can predict the battery life of each node from it, see
+// hoursLeft().
+typedef struct {
+  uint16_t averageMicroamps;  // since begin()
+  uint16_t usedTenthsMah;     // charge drawn since begin(), 0.1mAh units
+  uint16_t frames;            // frames transmitted
+  uint8_t retries;            // sendWithRetry() retries, saturating
+  uint8_t failures;           // sendWithRetry() failures, saturating
+} EnergySummary;
+
+class EnergyMeter {
+  public:
+    EnergyMeter();
+    void begin();
+    void attachRadio(RFM69& radio);
+    void enter(byte state);
+    void setCurrent(byte state, unsigned long microamps);
+    unsigned long millisIn(byte state);
+    float usedMah();
+    unsigned int averageMicroamps();
+    void summarize(EnergySummary* summary);
+    void printLog(Print& out);
+    static unsigned int hoursLeft(const EnergySummary* summary, unsigned int capacityMah);
+  protected:
+    void add(byte state, unsigned long micros);
+    void update();
+    void radioMode(byte mode);
+    static void onRadioMode(void* meter, byte mode);
+  private:
+    RFM69* _radio;
+    unsigned long _currents[ENERGY_STATES];
+    unsigned long _millis[ENERGY_STATES];
+    unsigned long _micros[ENERGY_STATES];   // below a second, moved to _millis
+    unsigned long _begun;
+    byte _mcuState;
+    unsigned long _mcuSince;
+    byte _radioState;
+    unsigned long _radioSince;
+};
+
+#endif
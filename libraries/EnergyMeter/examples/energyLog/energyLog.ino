@@ -0,0 +1,50 @@
+/* -----------------------------------------------------------------------------
+   Energy Meter Log
+  
+   Samples the battery, sends it to the gateway every 8 seconds, and prints
+   where the charge went: time in each MCU and radio state, frames and
+   retries, and the estimated mAh drawn and average current.
+  
+   Circuit:
+   * Moteino w/ RFM69 radio
+   * A0  - Battery voltage divider
+----------------------------------------------------------------------------- */
+#include <EnergyMeter.h>
+#include <LowPower.h>
+#include <RFM69.h>
+#include <SleepManager.h>
+#include <SPI.h>
+
+#define BAUD_RATE    57600
+#define NODE_ID      9
+#define NETWORK_ID   99
+#define GATEWAY_ID   1
+#define BATTERY_PIN  A0
+
+RFM69 radio;
+SleepManager sleeper;
+EnergyMeter meter;
+
+void setup() {
+  Serial.begin(BAUD_RATE);
+  radio.initialize(RF69_915MHZ, NODE_ID, NETWORK_ID);
+  sleeper.setRadio(radio);
+  sleeper.begin();
+  meter.attachRadio(radio);
+  meter.begin();
+}
+
+void loop() {
+  meter.enter(ENERGY_ADC);
+  int battery = analogRead(BATTERY_PIN);
+  meter.enter(ENERGY_ACTIVE);
+  
+  radio.sendWithRetry(GATEWAY_ID, &battery, sizeof(battery));
+  
+  meter.printLog(Serial);
+  Serial.flush();
+  
+  meter.enter(ENERGY_SLEEP);
+  sleeper.sleepFor(8000);
+  meter.enter(ENERGY_ACTIVE);
+}
@@ -0,0 +1,94 @@
+/*
+  JsonArena.h - Library for statically allocated ArduinoJson buffers.
+  Created by Jon R. Brule, October 19, 2026.
+  Released into the public domain.
+  
+  JsonArena is an allocator for ArduinoJson's DynamicJsonBufferBase that 
+  carves blocks out of a pool in static storage instead of the heap. The pool
+  is sized once at compile time, so it shows up in the linker's RAM report
+  rather than as a hidden stack frame, and it rewinds by itself when the last
+  block is handed back, i.e. when the JsonBuffer using it goes out of scope.
+  
+  ArenaJsonBuffer<CAPACITY> wraps it into a ready-to-use JsonBuffer whose 
+  first block spans the whole pool. Every ArenaJsonBuffer with the same 
+  CAPACITY and TAG shares one pool, so handlers that each build a document 
+  in turn cost CAPACITY bytes in total. Only one such document can be alive 
+  at a time; give documents that must coexist different TAGs. When a 
+  document does not fit, allocation fails the same way a StaticJsonBuffer 
+  does, and failures() counts it.
+  
+  highWater() reports the most the pool has held, for tuning CAPACITY.
+*/
+#ifndef JsonArena_h
+#define JsonArena_h
+
+#include <stddef.h>
+#include <stdint.h>
+#include <ArduinoJson.h>
+
+// size of DynamicJsonBufferBase's per-block header (next, capacity, size)
+#define JSON_ARENA_BLOCK_HEADER   (sizeof(void*) + 2 * sizeof(size_t))
+
+template <size_t CAPACITY, uint8_t TAG = 0>
+class JsonArena {
+  public:
+    void* allocate(size_t size) {
+      size_t start = (_used + sizeof(void*) - 1) & ~(sizeof(void*) - 1);
+      if (start > CAPACITY || size > CAPACITY - start) {
+        _failures++;
+        return NULL;
+      }
+      _used = start + size;
+      _blocks++;
+      return (uint8_t*) _pool + start;
+    }
+    
+    void deallocate(void* pointer) {
+      if (pointer != NULL && --_blocks == 0) {
+        _used = 0;
+      }
+    }
+    
+    static inline size_t capacity() { return CAPACITY; }
+    static inline size_t highWater() { return _peak; }
+    static inline unsigned int failures() { return _failures; }
+    static void record(size_t size) { if (size > _peak) _peak = size; }
+    static void resetStats() { _peak = 0; _failures = 0; }
+    
+  private:
+    static void* _pool[(CAPACITY + sizeof(void*) - 1) / sizeof(void*)];
+    static size_t _used;
+    static size_t _peak;
+    static uint8_t _blocks;
+    static unsigned int _failures;
+};
+
+template <size_t CAPACITY, uint8_t TAG>
+void* JsonArena<CAPACITY, TAG>::_pool[(CAPACITY + sizeof(void*) - 1) / sizeof(void*)];
+template <size_t CAPACITY, uint8_t TAG>
+size_t JsonArena<CAPACITY, TAG>::_used = 0;
+template <size_t CAPACITY, uint8_t TAG>
+size_t JsonArena<CAPACITY, TAG>::_peak = 0;
+template <size_t CAPACITY, uint8_t TAG>
+uint8_t JsonArena<CAPACITY, TAG>::_blocks = 0;
+template <size_t CAPACITY, uint8_t TAG>
+unsigned int JsonArena<CAPACITY, TAG>::_failures = 0;
+
+template <size_t CAPACITY, uint8_t TAG = 0>
+class ArenaJsonBuffer 
+    : public DynamicJsonBufferBase<JsonArena<CAPACITY, TAG> > {
+  public:
+    typedef JsonArena<CAPACITY, TAG> Arena;
+    
+    ArenaJsonBuffer() 
+      : DynamicJsonBufferBase<Arena>(CAPACITY - JSON_ARENA_BLOCK_HEADER) {}
+    
+    // record how much of the pool this document used before it is released
+    ~ArenaJsonBuffer() { Arena::record(JSON_ARENA_BLOCK_HEADER + this->size()); }
+    
+    static inline size_t capacity() { return CAPACITY; }
+    static inline size_t highWater() { return Arena::highWater(); }
+    static inline unsigned int failures() { return Arena::failures(); }
+};
+
+#endif
@@ -0,0 +1,56 @@
+/* -----------------------------------------------------------------------------
+   JSON Arena High Water
+  
+   Builds and parses progressively larger documents in one shared arena and
+   prints how much of the pool the largest one needed, so CAPACITY can be
+   trimmed to fit the real traffic. Documents that do not fit are counted as
+   failures instead of overrunning the stack.
+----------------------------------------------------------------------------- */
+#include <ArduinoJson.h>
+#include <JsonArena.h>
+
+#define BAUD_RATE    57600
+#define ARENA_SIZE   200
+
+typedef ArenaJsonBuffer<ARENA_SIZE> JsonBufferArena;
+
+static void build(byte values) {
+  JsonBufferArena jsonBuffer;
+  JsonObject& root = jsonBuffer.createObject();
+  root["type"] = 82;
+  JsonArray& data = root.createNestedArray("data");
+  for (byte i = 0; i < values; i++) {
+    data.add(i);
+  }
+  Serial.print(values);
+  Serial.print(" values -> ");
+  Serial.println(root.success() && data.size() == values ? "ok" : "did not fit");
+}
+
+static void parse() {
+  char json[] = "{\"type\":67,\"src\":1,\"dest\":9,\"comp\":2,\"data\":[4,30]}";
+  JsonBufferArena jsonBuffer;
+  JsonObject& root = jsonBuffer.parseObject(json);
+  Serial.print("parse -> ");
+  Serial.println(root.success() ? "ok" : "failed");
+}
+
+void setup() {
+  Serial.begin(BAUD_RATE);
+  Serial.println("\n[JSON Arena High Water]");
+  
+  parse();
+  for (byte values = 2; values <= 32; values *= 2) {
+    build(values);
+  }
+  
+  Serial.print("high water: ");
+  Serial.print(JsonBufferArena::highWater());
+  Serial.print(" of ");
+  Serial.print(JsonBufferArena::capacity());
+  Serial.print(" bytes, failures: ");
+  Serial.println(JsonBufferArena::failures());
+}
+
+void loop() {
+}
@@ -0,0 +1,164 @@
+/*
+  JsonWriter.cpp - Library for streaming JSON straight to a Print.
+  Created by Jon R. Brule, October 19, 2026.
+  Released into the public domain.
+*/
+#include "Arduino.h"
+#include "JsonWriter.h"
+
+//------------------------------------------------------------------------------
+void JsonWriter::value(long n) {
+  _count += _out.print(n);
+}
+
+//------------------------------------------------------------------------------
+void JsonWriter::value(unsigned long n) {
+  _count += _out.print(n);
+}
+
+//------------------------------------------------------------------------------
+// JSON has no NaN or infinity, so those become null.
+//
+void JsonWriter::value(double n, uint8_t digits) {
+  if (isnan(n) || isinf(n)) {
+    nullValue();
+  } else {
+    _count += _out.print(n, digits);
+  }
+}
+
+//------------------------------------------------------------------------------
+void JsonWriter::value(bool b) {
+  _count += _out.print(b ? F("true") : F("false"));
+}
+
+//------------------------------------------------------------------------------
+// Writes runs of characters that need no escaping with one bulk write.
+//
+void JsonWriter::value(const char* s) {
+  if (s == NULL) {
+    nullValue();
+    return;
+  }
+  raw('"');
+  const char* run = s;
+  for (; *s; s++) {
+    if (*s == '"' || *s == '\\' || (uint8_t) *s < 0x20) {
+      _count += _out.write((const uint8_t*) run, s - run);
+      escaped(*s);
+      run = s + 1;
+    }
+  }
+  _count += _out.write((const uint8_t*) run, s - run);
+  raw('"');
+}
+
+//------------------------------------------------------------------------------
+void JsonWriter::value(const __FlashStringHelper* s) {
+  raw('"');
+  PGM_P p = reinterpret_cast<PGM_P>(s);
+  for (char c = pgm_read_byte(p); c != 0; c = pgm_read_byte(++p)) {
+    escaped(c);
+  }
+  raw('"');
+}
+
+//------------------------------------------------------------------------------
+void JsonWriter::nullValue() {
+  _count += _out.print(F("null"));
+}
+
+//------------------------------------------------------------------------------
+void JsonWriter::raw(char c) {
+  _count += _out.write(c);
+}
+
+//------------------------------------------------------------------------------
+// Writes one string character, escaped if JSON requires it.
+//
+void JsonWriter::escaped(char c) {
+  static const char hex[] = "0123456789abcdef";
+  switch (c) {
+    case '"':  raw('\\'); raw('"'); break;
+    case '\\': raw('\\'); raw('\\'); break;
+    case '\b': raw('\\'); raw('b'); break;
+    case '\f': raw('\\'); raw('f'); break;
+    case '\n': raw('\\'); raw('n'); break;
+    case '\r': raw('\\'); raw('r'); break;
+    case '\t': raw('\\'); raw('t'); break;
+    default:
+      if ((uint8_t) c < 0x20) {
+        _count += _out.print(F("\\u00"));
+        raw(hex[(uint8_t) c >> 4]);
+        raw(hex[c & 0x0F]);
+      } else {
+        raw(c);
+      }
+  }
+}
+
+//------------------------------------------------------------------------------
+JsonScope::JsonScope(JsonWriter& writer, char opening, char closing) 
+  : _writer(writer) {
+  _close = closing;
+  _first = true;
+  _writer.raw(opening);
+}
+
+//------------------------------------------------------------------------------
+// Closes the scope; further calls, including the destructor's, do nothing.
+//
+void JsonScope::close() {
+  if (_close != 0) {
+    _writer.raw(_close);
+    _close = 0;
+  }
+}
+
+//------------------------------------------------------------------------------
+void JsonScope::separator() {
+  if (_first) {
+    _first = false;
+  } else {
+    _writer.raw(',');
+  }
+}
+
+//------------------------------------------------------------------------------
+BufferPrint::BufferPrint(char* buffer, size_t size) {
+  _buffer = buffer;
+  _size = size;
+  _length = 0;
+  _overflow = false;
+  if (_size > 0) {
+    _buffer[0] = '\0';
+  }
+}
+
+//------------------------------------------------------------------------------
+size_t BufferPrint::write(uint8_t c) {
+  if (_size == 0 || _length + 1 >= _size) {
+    _overflow = true;
+    return 0;
+  }
+  _buffer[_length++] = c;
+  _buffer[_length] = '\0';
+  return 1;
+}
+
+//------------------------------------------------------------------------------
+size_t BufferPrint::write(const uint8_t* buffer, size_t size) {
+  if (_size == 0) {
+    _overflow = _overflow || size > 0;
+    return 0;
+  }
+  size_t room = _size - 1 - _length;
+  if (size > room) {
+    _overflow = true;
+    size = room;
+  }
+  memcpy(_buffer + _length, buffer, size);
+  _length += size;
+  _buffer[_length] = '\0';
+  return size;
+}
@@ -0,0 +1,152 @@
+/*
+  JsonWriter.h - Library for streaming JSON straight to a Print.
+  Created by Jon R. Brule, October 19, 2026.
+  Released into the public domain.
+  
+  Writes a document as it is described instead of building it in a 
+  JsonBuffer first, so a report costs a few bytes of stack rather than a 
+  whole DOM. Nesting is checked by the compiler: members with keys can only 
+  be added to a JsonObjectWriter, bare elements only to a JsonArrayWriter, 
+  and every scope closes itself when it goes out of scope if close() was 
+  not called. Strings are escaped, and count() tracks the bytes written so 
+  a length prefix or Content-Length can be computed with a NullPrint pass.
+  
+    JsonWriter json(Serial);
+    JsonObjectWriter root(json);
+    root.add(F("type"), 82);
+    JsonArrayWriter data(root, F("data"));
+    data.add(4);
+    data.close();
+    root.close();
+*/
+#ifndef JsonWriter_h
+#define JsonWriter_h
+
+#include "Arduino.h"
+
+#define JSON_WRITER_DIGITS  2
+
+class JsonWriter {
+  public:
+    JsonWriter(Print& out) : _out(out) { _count = 0; }
+    
+    inline size_t count() { return _count; }
+    inline void resetCount() { _count = 0; }
+    
+    void value(int n) { value((long) n); }
+    void value(unsigned int n) { value((unsigned long) n); }
+    void value(long n);
+    void value(unsigned long n);
+    void value(double n, uint8_t digits = JSON_WRITER_DIGITS);
+    void value(bool b);
+    void value(const char* s);
+    void value(const __FlashStringHelper* s);
+    void nullValue();   // not null(), which RFM69.h defines as a macro
+    
+    void raw(char c);
+    
+  private:
+    void escaped(char c);
+    
+    Print& _out;
+    size_t _count;
+};
+
+class JsonArrayWriter;
+
+class JsonScope {
+  public:
+    void close();
+    
+  protected:
+    JsonScope(JsonWriter& writer, char opening, char closing);
+    ~JsonScope() { close(); }
+    void separator();
+    template <typename K> void member(K key) {
+      separator();
+      _writer.value(key);
+      _writer.raw(':');
+    }
+    
+    JsonWriter& _writer;
+    char _close;
+    bool _first;
+    
+  private:
+    JsonScope(const JsonScope&);
+    JsonScope& operator=(const JsonScope&);
+    
+    friend class JsonObjectWriter;
+    friend class JsonArrayWriter;
+};
+
+class JsonObjectWriter : public JsonScope {
+  public:
+    JsonObjectWriter(JsonWriter& writer) : JsonScope(writer, '{', '}') {}
+    JsonObjectWriter(JsonArrayWriter& parent);
+    template <typename K> JsonObjectWriter(JsonObjectWriter& parent, K key)
+      : JsonScope((parent.member(key), parent._writer), '{', '}') {}
+    
+    template <typename K, typename V> void add(K key, V v) {
+      member(key);
+      _writer.value(v);
+    }
+    template <typename K> void add(K key, double v, uint8_t digits) {
+      member(key);
+      _writer.value(v, digits);
+    }
+    template <typename K> void addNull(K key) {
+      member(key);
+      _writer.nullValue();
+    }
+};
+
+class JsonArrayWriter : public JsonScope {
+  public:
+    JsonArrayWriter(JsonWriter& writer) : JsonScope(writer, '[', ']') {}
+    JsonArrayWriter(JsonArrayWriter& parent)
+      : JsonScope((parent.separator(), parent._writer), '[', ']') {}
+    template <typename K> JsonArrayWriter(JsonObjectWriter& parent, K key)
+      : JsonScope((parent.member(key), parent._writer), '[', ']') {}
+    
+    template <typename V> void add(V v) {
+      separator();
+      _writer.value(v);
+    }
+    void add(double v, uint8_t digits) {
+      separator();
+      _writer.value(v, digits);
+    }
+    void addNull() {
+      separator();
+      _writer.nullValue();
+    }
+};
+
+inline JsonObjectWriter::JsonObjectWriter(JsonArrayWriter& parent)
+  : JsonScope((parent.separator(), parent._writer), '{', '}') {}
+
+// Print that discards everything, for a counting pass through a JsonWriter.
+class NullPrint : public Print {
+  public:
+    size_t write(uint8_t c) { return 1; }
+    size_t write(const uint8_t* buffer, size_t size) { return size; }
+};
+
+// Print into a fixed char buffer, always zero-terminated.
+class BufferPrint : public Print {
+  public:
+    BufferPrint(char* buffer, size_t size);
+    size_t write(uint8_t c);
+    size_t write(const uint8_t* buffer, size_t size);
+    inline size_t length() { return _length; }
+    inline bool overflowed() { return _overflow; }
+    
+  private:
+    char* _buffer;
+    size_t _size;
+    size_t _length;
+    bool _overflow;
+};
+
+#endif
@@ -0,0 +1,54 @@
+/* -----------------------------------------------------------------------------
+   JSON Writer Stream Report
+  
+   Streams a gateway-style report to the serial port without building it in
+   memory first, after a counting pass that works out its length the way a
+   Content-Length header or length prefix would need. Also times both passes.
+----------------------------------------------------------------------------- */
+#include <JsonWriter.h>
+
+#define BAUD_RATE    57600
+#define DATA_LENGTH  14
+
+byte data[DATA_LENGTH] = { 200, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13 };
+
+static size_t report(Print& out) {
+  JsonWriter json(out);
+  JsonObjectWriter root(json);
+  root.add(F("type"), 82);
+  root.add(F("src"), 2);
+  root.add(F("rssi"), -71);
+  root.add(F("note"), "quoted \"text\"\tand tab");
+  JsonArrayWriter values(root, F("data"));
+  for (byte i = 0; i < DATA_LENGTH; i++) {
+    values.add(data[i]);
+  }
+  values.close();
+  root.close();
+  return json.count();
+}
+
+void setup() {
+  Serial.begin(BAUD_RATE);
+  Serial.println("\n[JSON Writer Stream Report]");
+}
+
+void loop() {
+  NullPrint counter;
+  unsigned long start = micros();
+  size_t length = report(counter);
+  unsigned long counted = micros() - start;
+  
+  Serial.print("length: ");
+  Serial.println(length);
+  start = micros();
+  report(Serial);
+  unsigned long sent = micros() - start;
+  Serial.println();
+  
+  Serial.print("count pass us: ");
+  Serial.print(counted);
+  Serial.print(", serial pass us: ");
+  Serial.println(sent);
+  delay(5000);
+}
@@ -0,0 +1,505 @@
+/*
+  MeshRouter.cpp - Logic for multi-hop routing of RFM69 frames.
+  Created by Jon R. Brule, October 19, 2026.
+  Released into the public domain.
+*/
+#include "Arduino.h"
+#include "MeshRouter.h"
+#include <Message.h>
+
+//-----------------------------------------------------------------------------
+MeshRouter::MeshRouter(RFM69& radio) : _radio(radio) {
+  _node = 0;
+  _gateway = 0;
+  _repeater = false;
+  _soliciting = false;
+  _seq = 0;
+  _acked = 0;
+  _length = 0;
+  _ackLength = 0;
+  _random = 1;
+  _beaconAt = 0;
+  _beaconWait = 0;
+  memset(&stats, 0, sizeof(stats));
+  memset(_routes, 0, sizeof(_routes));
+  memset(_seen, 0, sizeof(_seen));
+  _seenNext = 0;
+}
+
+//-----------------------------------------------------------------------------
+// Starts routing for this node; call after the radio is initialized. A
+// repeater relays frames for others, and looks for a route to the gateway
+// at once, as it will be asked for one.
+//
+void MeshRouter::begin(byte node, byte gateway, boolean repeater) {
+  _node = node;
+  _gateway = gateway;
+  _repeater = repeater;
+  _seq = 0;
+  _acked = 0;
+  _random = 0x0100 | node;
+  memset(_routes, 0, sizeof(_routes));
+  _beaconAt = millis();
+  _beaconWait = jitter(MESH_BEACON_MS / 8);
+  if (_repeater) {
+    solicit(_gateway);
+  }
+}
+
+//-----------------------------------------------------------------------------
+// Sends a payload to a node, straight to it if that is the best route and
+// over the next hop otherwise, finding a route first if there is none.
+// A route whose first hop fails is dropped, and the payload sent once more
+// on a new one. With endToEnd, a routed payload only counts as delivered
+// once its destination has acknowledged it, and is sent once more if that
+// ACK does not come. Returns true on delivery, with the ACK's payload in
+// ack().
+//
+boolean MeshRouter::send(byte destination, const void* buffer, byte size, boolean endToEnd) {
+  _ackLength = 0;
+  if (size > MESH_DATA_LENGTH) {
+    return false;
+  }
+  byte seq = ++_seq;
+  for (byte attempt = 0; attempt < 2; attempt++) {
+    byte next = nextHop(destination);
+    if (next == MESH_NO_ROUTE) {
+      solicit(destination);
+      next = nextHop(destination);
+      if (next == MESH_NO_ROUTE) {
+        return false;
+      }
+    }
+    boolean sent;
+    if (next == destination) {
+      sent = _radio.sendWithRetry(destination, buffer, size);
+      if (sent) keepAck();
+    } else {
+      MeshHeader* header = (MeshHeader*) _frame;
+      header->kind = MESH_DATA;
+      header->flags = endToEnd ? MESH_FLAG_ACK : 0;
+      header->origin = _node;
+      header->destination = destination;
+      header->ttl = MESH_TTL;
+      header->hops = 0;
+      header->seq = seq;
+      memcpy(_frame + sizeof(MeshHeader), buffer, size);
+      sent = _radio.sendWithRetry(next, _frame, sizeof(MeshHeader) + size);
+      if (sent) keepAck();
+      if (sent && endToEnd) {
+        _ackLength = 0;
+        if (awaitAck(seq)) {
+          return true;
+        }
+        continue;                     // the first hop took it, so keep the route
+      }
+    }
+    if (sent) {
+      return true;
+    }
+    forget(destination);
+  }
+  return false;
+}
+
+//-----------------------------------------------------------------------------
+// Takes the frame receiveDone() has just returned. Routing frames are
+// handled here: acknowledged at the link, beacons learned from, frames for
+// other nodes relayed by a repeater. Returns MESH_DELIVERED for a payload
+// sent to this node, in data(), MESH_HANDLED for any other mesh frame,
+// and MESH_NONE for a frame that is not one, which is left in the radio's
+// DATA untouched.
+//
+byte MeshRouter::receive() {
+  byte sender = _radio.SENDERID;
+  int rssi = _radio.RSSI;
+  byte length = _radio.DATALEN;
+  byte kind = _radio.DATA[0];
+  if (length < sizeof(MeshHeader) || kind < MESH_DATA || kind > MESH_SOLICIT) {
+    if (find(sender)) {
+      heard(sender, rssi);    // a node routed to, heard straight
+    }
+    return MESH_NONE;
+  }
+  boolean fits = length <= sizeof(_frame);
+  if (fits) {
+    memcpy(_frame, (byte*) _radio.DATA, length);
+    _length = length;
+  }
+  if (_radio.ACK_REQUESTED) {
+    AckRecord ack;
+    ack.pending = 0;
+    ack.rssi = rssi;
+    ack.channel = ACK_NO_CHANNEL;
+    _radio.sendACK(&ack, sizeof(ack));
+  }
+  if (!fits) {
+    return MESH_HANDLED;
+  }
+  heard(sender, rssi);
+
+  MeshHeader* header = (MeshHeader*) _frame;
+  switch (kind) {
+    case MESH_BEACON: {
+      if (length < sizeof(MeshHeader) + sizeof(MeshBeacon) || header->destination == _node) {
+        break;
+      }
+      MeshBeacon* beacon = (MeshBeacon*) (_frame + sizeof(MeshHeader));
+      Route* route = find(header->destination);
+      if (beacon->via == _node) {
+        if (route && route->next == sender) {
+          forget(header->destination);
+        }
+        break;
+      }
+      if (header->hops >= MESH_TTL) {
+        break;
+      }
+      Route* link = find(sender);
+      int total = beacon->cost + linkCost(link ? link->rssi : rssi);
+      if (total > 255) {
+        total = 255;
+      }
+      if (!route || route->next == sender || total < route->cost) {
+        learn(header->destination, sender, total, header->hops + 1);
+      }
+      break;
+    }
+
+    case MESH_SOLICIT:
+      if ((_repeater || _node == _gateway) && header->origin != header->destination
+          && (header->destination == _node || find(header->destination))) {
+        delay(jitter(MESH_REPLY_SLOTS) * MESH_REPLY_SLOT_MS);
+        beacon(header->origin, header->destination);
+      }
+      break;
+
+    case MESH_DATA:
+    case MESH_ACK:
+      if (header->destination == _node) {
+        if (kind == MESH_ACK) {
+          _acked = header->seq;
+          break;
+        }
+        if (header->origin != sender) {
+          Route* back = find(header->origin);
+          if (!back || back->next != header->origin) {
+            learn(header->origin, sender, header->hops + 1, header->hops + 1);
+          }
+        }
+        boolean duplicate = seen(header->origin, header->seq);
+        if (header->flags & MESH_FLAG_ACK) {
+          acknowledge(header->origin, header->seq);   // again, if the first was lost
+        }
+        if (duplicate) {
+          stats.duplicates++;
+          break;
+        }
+        return MESH_DELIVERED;
+      }
+      if (!_repeater) {
+        break;
+      }
+      if (kind == MESH_DATA) {
+        // an end-to-end frame seen before is the origin trying again, and
+        // its destination answers duplicates
+        if (seen(header->origin, header->seq) && !(header->flags & MESH_FLAG_ACK)) {
+          stats.duplicates++;
+          break;
+        }
+        if (header->origin != sender) {
+          Route* back = find(header->origin);
+          if (!back || back->next != header->origin) {
+            learn(header->origin, sender, header->hops + 1, header->hops + 1);
+          }
+        }
+      }
+      if (--header->ttl == 0) {
+        stats.expired++;
+        break;
+      }
+      header->hops++;
+      relay(sender);
+      break;
+  }
+  return MESH_HANDLED;
+}
+
+//-----------------------------------------------------------------------------
+// Sends the frame in _frame on to its next hop. Without a route to the
+// gateway, or if the next hop on it does not take the frame, a new one is
+// sought and the frame tried once on it. A route back to a mote is not
+// sought, as the mote does not answer.
+//
+void MeshRouter::relay(byte sender) {
+  byte destination = ((MeshHeader*) _frame)->destination;
+  byte next = nextHop(destination);
+  if (next != MESH_NO_ROUTE && next != sender) {
+    if (_radio.sendWithRetry(next, _frame, _length)) {
+      stats.forwarded++;
+      return;
+    }
+    stats.failed++;
+  }
+  if (destination != _gateway) {
+    forget(destination);
+    stats.noRoute += (next == MESH_NO_ROUTE || next == sender);
+    return;
+  }
+  byte frame[sizeof(_frame)];
+  byte length = _length;
+  memcpy(frame, _frame, length);      // solicit() receives into _frame
+  forget(destination);
+  solicit(destination);
+  next = nextHop(destination);
+  if (next == MESH_NO_ROUTE || next == sender) {
+    stats.noRoute++;
+  } else if (_radio.sendWithRetry(next, frame, length)) {
+    stats.forwarded++;
+  } else {
+    stats.failed++;
+  }
+}
+
+//-----------------------------------------------------------------------------
+// Beacons every MESH_BEACON_MS or so, and ages the routes; call from the
+// loop of a gateway or repeater, which keeps its receiver on. A repeater
+// without a route to the gateway looks for one instead.
+//
+void MeshRouter::poll() {
+  if (!_repeater && _node != _gateway) {
+    return;
+  }
+  if (millis() - _beaconAt < _beaconWait) {
+    return;
+  }
+  _beaconAt = millis();
+  _beaconWait = MESH_BEACON_MS - MESH_BEACON_MS / 8 + jitter(MESH_BEACON_MS / 4);
+  for (byte i = 0; i < MESH_ROUTES; i++) {
+    if (_routes[i].next != MESH_NO_ROUTE && ++_routes[i].age > MESH_ROUTE_AGE) {
+      _routes[i].next = MESH_NO_ROUTE;
+    }
+  }
+  if (_node == _gateway || find(_gateway)) {
+    beacon(RF69_BROADCAST_ADDR, _gateway);
+  } else {
+    solicit(_gateway);
+  }
+}
+
+//-----------------------------------------------------------------------------
+// The neighbour to send a frame for a node to, or MESH_NO_ROUTE.
+//
+byte MeshRouter::nextHop(byte destination) {
+  Route* route = find(destination);
+  return route ? route->next : MESH_NO_ROUTE;
+}
+
+//-----------------------------------------------------------------------------
+// The cost of the route to a node, 255 if there is none.
+//
+byte MeshRouter::cost(byte destination) {
+  Route* route = find(destination);
+  return route ? route->cost : 255;
+}
+
+//-----------------------------------------------------------------------------
+// Cost of a link heard at an RSSI: 1 while it is strong, more the nearer
+// it gets to the sensitivity, where retries and losses mount.
+//
+byte MeshRouter::linkCost(int rssi) {
+  if (rssi >= MESH_GOOD_RSSI) {
+    return 1;
+  }
+  return 1 + (MESH_GOOD_RSSI - rssi + MESH_RSSI_STEP - 1) / MESH_RSSI_STEP;
+}
+
+//-----------------------------------------------------------------------------
+MeshRouter::Route* MeshRouter::find(byte destination) {
+  for (byte i = 0; i < MESH_ROUTES; i++) {
+    if (_routes[i].next != MESH_NO_ROUTE && _routes[i].destination == destination) {
+      return &_routes[i];
+    }
+  }
+  return NULL;
+}
+
+//-----------------------------------------------------------------------------
+// Sets the route to a node. The table is kept in order of use, most recent
+// first; a new route takes a free entry, or else the least recently used
+// one other than the route to the gateway.
+//
+MeshRouter::Route* MeshRouter::learn(byte destination, byte next, byte cost, byte hops) {
+  Route* route = find(destination);
+  for (byte i = MESH_ROUTES; !route && i-- > 0; ) {
+    if (_routes[i].next == MESH_NO_ROUTE) {
+      route = &_routes[i];
+    }
+  }
+  for (byte i = MESH_ROUTES; !route && i-- > 0; ) {
+    if (_routes[i].destination != _gateway) {
+      route = &_routes[i];
+    }
+  }
+  Route entry = *route;
+  if (entry.destination != destination || entry.next != next) {
+    Route* link = find(next);
+    entry.rssi = link ? link->rssi : 0;
+  }
+  entry.destination = destination;
+  entry.next = next;
+  entry.cost = cost;
+  entry.hops = hops;
+  entry.age = 0;
+  memmove(&_routes[1], &_routes[0], (route - _routes) * sizeof(Route));
+  _routes[0] = entry;
+  return &_routes[0];
+}
+
+//-----------------------------------------------------------------------------
+void MeshRouter::forget(byte destination) {
+  Route* route = find(destination);
+  if (route) {
+    route->next = MESH_NO_ROUTE;
+  }
+}
+
+//-----------------------------------------------------------------------------
+// Notes a frame from a neighbour: the node itself is one hop away, over a
+// link whose RSSI is smoothed over the frames heard.
+//
+void MeshRouter::heard(byte neighbour, int rssi) {
+  Route* route = find(neighbour);
+  if (route && route->next == neighbour) {
+    rssi = (3 * route->rssi + rssi) / 4;
+  } else if (route && linkCost(rssi) >= route->cost) {
+    return;                           // better reached over another hop
+  }
+  route = learn(neighbour, neighbour, linkCost(rssi), 1);
+  route->rssi = rssi;
+}
+
+//-----------------------------------------------------------------------------
+// Whether a frame was heard before; remembers it if not.
+//
+boolean MeshRouter::seen(byte origin, byte seq) {
+  for (byte i = 0; i < MESH_SEEN; i++) {
+    if (_seen[i][0] == origin && _seen[i][1] == seq) {
+      return true;
+    }
+  }
+  _seen[_seenNext][0] = origin;
+  _seen[_seenNext][1] = seq;
+  _seenNext = (_seenNext + 1) % MESH_SEEN;
+  return false;
+}
+
+//-----------------------------------------------------------------------------
+// Sends the end-to-end ACK for a payload back to its origin.
+//
+void MeshRouter::acknowledge(byte origin, byte seq) {
+  byte next = nextHop(origin);
+  if (next == MESH_NO_ROUTE) {
+    stats.noRoute++;
+    return;
+  }
+  MeshHeader ack;
+  ack.kind = MESH_ACK;
+  ack.flags = 0;
+  ack.origin = _node;
+  ack.destination = origin;
+  ack.ttl = MESH_TTL;
+  ack.hops = 0;
+  ack.seq = seq;
+  _radio.sendWithRetry(next, &ack, sizeof(ack));
+}
+
+//-----------------------------------------------------------------------------
+// Advertises this node's route to a node, to one neighbour or to all.
+//
+void MeshRouter::beacon(byte to, byte destination) {
+  byte frame[sizeof(MeshHeader) + sizeof(MeshBeacon)];
+  MeshHeader* header = (MeshHeader*) frame;
+  MeshBeacon* beacon = (MeshBeacon*) (frame + sizeof(MeshHeader));
+  header->kind = MESH_BEACON;
+  header->flags = 0;
+  header->origin = _node;
+  header->destination = destination;
+  header->ttl = 1;
+  header->seq = 0;
+  if (destination == _node) {
+    header->hops = 0;
+    beacon->cost = 0;
+    beacon->via = _node;
+  } else {
+    Route* route = find(destination);
+    if (!route) {
+      return;
+    }
+    header->hops = route->hops;
+    beacon->cost = route->cost;
+    beacon->via = route->next;
+  }
+  _radio.send(to, frame, sizeof(frame));
+}
+
+//-----------------------------------------------------------------------------
+// Asks the neighbours for their routes to a node, and learns from the
+// beacons that answer.
+//
+void MeshRouter::solicit(byte destination) {
+  if (_soliciting) {
+    return;                           // relaying for another while soliciting
+  }
+  _soliciting = true;
+  MeshHeader header;
+  header.kind = MESH_SOLICIT;
+  header.flags = 0;
+  header.origin = _node;
+  header.destination = destination;
+  header.ttl = 1;
+  header.hops = 0;
+  header.seq = 0;
+  stats.solicits++;
+  _radio.send(RF69_BROADCAST_ADDR, &header, sizeof(header));
+  unsigned long start = millis();
+  while (millis() - start < MESH_SOLICIT_MS) {
+    if (_radio.receiveDone()) {
+      receive();
+    }
+  }
+  _soliciting = false;
+}
+
+//-----------------------------------------------------------------------------
+// Waits for the end-to-end ACK of a routed payload.
+//
+boolean MeshRouter::awaitAck(byte seq) {
+  _acked = seq + 1;
+  unsigned long start = millis();
+  while (millis() - start < MESH_ACK_MS) {
+    if (_radio.receiveDone()) {
+      receive();
+      if (_acked == seq) {
+        return true;
+      }
+    }
+  }
+  return false;
+}
+
+//-----------------------------------------------------------------------------
+void MeshRouter::keepAck() {
+  _ackLength = _radio.DATALEN < MESH_ACK_LENGTH ? _radio.DATALEN : MESH_ACK_LENGTH;
+  memcpy(_ack, (byte*) _radio.DATA, _ackLength);
+}
+
+//-----------------------------------------------------------------------------
+// A pseudo-random number below range, to spread beacons and replies.
+//
+word MeshRouter::jitter(word range) {
+  _random ^= _random << 7;
+  _random ^= _random >> 9;
+  _random ^= _random << 8;
+  return _random % range;
+}
@@ -0,0 +1,148 @@
+/*
+  MeshRouter.h - Library for multi-hop routing of RFM69 frames.
+  Created by Jon R. Brule, October 19, 2026.
+  Released into the public domain.
+
+  Carries frames to the gateway over mains-powered repeaters when a mote
+  cannot reach it well on its own. A routed frame is a MeshHeader, with
+  its origin, final destination, TTL and hop count, followed by the
+  payload (e.g. a Message); each hop is an ordinary sendWithRetry() to the
+  next hop, acknowledged at the link, and the destination can acknowledge
+  end to end as well (MESH_FLAG_ACK). A frame sent straight to its
+  destination goes out as the bare payload, so a gateway without
+  MeshRouter still hears motes in range, and ACK payloads such as
+  AckRecord still reach them.
+
+  Routes are distance vectors. The gateway and every repeater with a route
+  broadcast a beacon every MESH_BEACON_MS with their cost to the gateway;
+  a node adds the cost of the link the beacon came in on, from its RSSI
+  (1 down to MESH_GOOD_RSSI, one more per MESH_RSSI_STEP dB below), and
+  keeps the cheapest next hop. A beacon names its own next hop, so a node
+  never routes through a neighbour that routes through it. Battery motes
+  keep their radio asleep and miss beacons: they broadcast a solicitation
+  when they have no route, or the one they had failed, and take the best
+  of the beacons that answer it within MESH_SOLICIT_MS. Nodes on the way
+  learn the route back to a frame's origin from the frame itself.
+*/
+#ifndef MeshRouter_h
+#define MeshRouter_h
+
+#include "Arduino.h"
+#include <RFM69.h>
+
+#define MESH_ROUTES          12       // route table entries
+#define MESH_SEEN            8        // frames remembered to drop duplicates
+#define MESH_DATA_LENGTH     32       // longest payload
+#define MESH_ACK_LENGTH      4        // ACK payload bytes kept, see ack()
+#define MESH_TTL             4        // hops a frame may take
+#define MESH_GOOD_RSSI       -85      // dBm down to which a link costs 1...
+#define MESH_RSSI_STEP       3        // ...and one more per this many dB below
+#define MESH_BEACON_MS       60000    // beacon interval of gateways and repeaters
+#define MESH_ROUTE_AGE       3        // beacon intervals a route lasts without news
+#define MESH_SOLICIT_MS      60       // how long a mote listens for answers to a solicitation
+#define MESH_REPLY_SLOTS     8        // answers to a solicitation are spread over this many...
+#define MESH_REPLY_SLOT_MS   5        // ...slots, to keep them off each other
+#define MESH_ACK_MS          250      // how long to wait for an end-to-end ACK
+
+#define MESH_DATA            0xA1     // MeshHeader.kind: a payload on its way
+#define MESH_ACK             0xA2     // its destination acknowledging it
+#define MESH_BEACON          0xA3     // a route to the gateway, MeshBeacon follows
+#define MESH_SOLICIT         0xA4     // a mote asking for beacons
+
+#define MESH_FLAG_ACK        0x01     // the destination acknowledges end to end
+
+#define MESH_NO_ROUTE        0        // nextHop() when there is none
+
+// what receive() made of a frame
+enum { MESH_NONE, MESH_HANDLED, MESH_DELIVERED };
+
+typedef struct {
+  byte kind;
+  byte flags;
+  byte origin;
+  byte destination;
+  byte ttl;         // hops left
+  byte hops;        // hops taken; for a beacon, its sender's hops to the gateway
+  byte seq;         // per origin, to drop duplicates and match end-to-end ACKs
+} MeshHeader;
+
+typedef struct {
+  byte cost;        // sender's cost to the gateway
+  byte via;         // sender's next hop, so that it is not routed back through
+} MeshBeacon;
+
+typedef struct {
+  unsigned int forwarded;   // frames relayed on to their next hop
+  unsigned int failed;      // relays the next hop did not acknowledge
+  unsigned int expired;     // frames dropped when their TTL ran out
+  unsigned int noRoute;     // frames dropped for want of a route
+  unsigned int duplicates;  // frames heard twice, after a lost link ACK
+  unsigned int solicits;    // solicitations sent
+} MeshStats;
+
+class MeshRouter {
+  public:
+    MeshRouter(RFM69& radio);
+    void begin(byte node, byte gateway, boolean repeater = false);
+    boolean send(byte destination, const void* buffer, byte size, boolean endToEnd = false);
+    byte receive();
+    void poll();
+    byte nextHop(byte destination);
+    byte cost(byte destination);
+    static byte linkCost(int rssi);
+
+    // the payload receive() delivered
+    inline const byte* data() { return _frame + sizeof(MeshHeader); }
+    inline byte dataLength() { return _length - sizeof(MeshHeader); }
+    inline byte origin() { return ((MeshHeader*) _frame)->origin; }
+    inline byte hops() { return ((MeshHeader*) _frame)->hops; }
+
+    // the payload of the ACK the last send() got: the first hop's, or
+    // none for an end-to-end ACK
+    inline const byte* ack() { return _ack; }
+    inline byte ackLength() { return _ackLength; }
+
+    MeshStats stats;
+  protected:
+    typedef struct {
+      byte destination;
+      byte next;
+      byte cost;
+      byte hops;
+      int8_t rssi;            // of the link to next, smoothed
+      byte age;               // beacon intervals since last confirmed
+    } Route;
+
+    Route* find(byte destination);
+    Route* learn(byte destination, byte next, byte cost, byte hops);
+    void forget(byte destination);
+    void heard(byte neighbour, int rssi);
+    void relay(byte sender);
+    boolean seen(byte origin, byte seq);
+    void acknowledge(byte origin, byte seq);
+    void beacon(byte to, byte destination);
+    void solicit(byte destination);
+    boolean awaitAck(byte seq);
+    void keepAck();
+    word jitter(word range);
+  private:
+    RFM69& _radio;
+    byte _node;
+    byte _gateway;
+    boolean _repeater;
+    boolean _soliciting;
+    byte _seq;
+    byte _acked;                    // seq of the last end-to-end ACK for us
+    Route _routes[MESH_ROUTES];
+    byte _seen[MESH_SEEN][2];       // origin, seq
+    byte _seenNext;
+    byte _frame[sizeof(MeshHeader) + MESH_DATA_LENGTH];
+    byte _length;
+    byte _ack[MESH_ACK_LENGTH];
+    byte _ackLength;
+    word _random;
+    unsigned long _beaconAt;
+    unsigned long _beaconWait;
+};
+
+#endif
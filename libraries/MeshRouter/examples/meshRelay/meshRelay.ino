@@ -0,0 +1,258 @@
+/* -----------------------------------------------------------------------------
+   MeshRouter Relay
+
+   Runs a gateway, a few mains-powered repeaters and a fleet of battery
+   motes scattered over a house on the simulated medium, and prints the
+   reports delivered and the retries they took, with every mote sending
+   straight to the gateway and then over MeshRouter, hop by hop and with
+   end-to-end ACKs. The gateway sits in one corner; the link RSSI between
+   any two nodes follows a log-distance path loss and is jittered per frame
+   to stand in for fading, so the motes in the far corner are at the edge
+   of its range. Motes whose own link to the gateway is weaker than
+   EDGE_RSSI are counted apart.
+
+   Retries are sendWithRetry() attempts after the first: the motes' own,
+   and those of the repeaters and the gateway relaying frames and ACKs.
+
+   Host only, on the simulated radios: make -C libraries/VirtualAir/host meshRelay
+----------------------------------------------------------------------------- */
+#include <Message.h>
+#include <MeshRouter.h>
+#include <RFM69.h>
+#include <VirtualAir.h>
+
+#define BAUD_RATE     57600
+#define GATEWAY_ID    1
+#define NETWORK_ID    99
+#define FREQUENCY     RF69_915MHZ
+#define REPEATERS     3
+#define MOTES         30
+#define FIRST_MOTE    10       // node ID of the first mote
+#define PERIOD_MS     10000    // report interval of each mote
+#define RUN_MS        900000UL
+#define FADING_DB     4        // link RSSI jitter, either way
+#define SIDE_M        80       // the house is this many metres square
+#define RSSI_1M       -40      // link RSSI at 1m, RFM69W at full power
+#define PATH_LOSS     3.5      // path loss exponent, indoors through walls
+#define HW_GAIN_DB    7        // RFM69HW at full power over the RFM69W
+#define EDGE_RSSI     -88      // motes heard weaker than this are at the edge
+
+enum { DIRECT, MESH_HOP, MESH_E2E, MODE_END };
+const char* modeNames[] = { "direct", "mesh", "mesh e2e" };
+
+// repeaters on the landing, in the garage and in the basement
+const float repeaterAt[REPEATERS][2] = { { 40, 15 }, { 15, 45 }, { 55, 55 } };
+
+VirtualAir& air = VirtualAir::medium();
+RFM69 gatewayRadio;
+MeshRouter* gatewayMesh;
+RFM69 repeaterRadios[REPEATERS];
+MeshRouter* repeaterMeshes[REPEATERS];
+RFM69 moteRadios[MOTES];
+MeshRouter* moteMeshes[MOTES];
+float moteAt[MOTES][2];
+
+byte mode;
+unsigned long offered[MOTES];
+unsigned long delivered[MOTES];
+uint32_t lastSeq[MOTES];
+
+//------------------------------------------------------------------------------
+// The gateway: count each report once; ACK the ones sent straight to it.
+//
+static void count(const byte* data, byte length) {
+  if (length != sizeof(Message)) {
+    return;
+  }
+  Message msg;
+  uint32_t seq;
+  memcpy(&msg, data, sizeof(msg));
+  memcpy(&seq, msg.msg.data, sizeof(seq));
+  byte i = msg.msg.source - FIRST_MOTE;
+  if (i < MOTES && seq != lastSeq[i]) {
+    lastSeq[i] = seq;
+    delivered[i]++;
+  }
+}
+
+static void gateway(void* arg) {
+  gatewayRadio.initialize(FREQUENCY, GATEWAY_ID, NETWORK_ID);
+  gatewayRadio.setHighPower();
+  gatewayMesh->begin(GATEWAY_ID, GATEWAY_ID);
+  while (true) {
+    if (mode != DIRECT) {
+      gatewayMesh->poll();
+    }
+    if (!gatewayRadio.receiveDone()) {
+      continue;
+    }
+    byte frame = (mode != DIRECT) ? gatewayMesh->receive() : MESH_NONE;
+    if (frame == MESH_DELIVERED) {
+      count(gatewayMesh->data(), gatewayMesh->dataLength());
+    } else if (frame == MESH_NONE) {
+      count((byte*) gatewayRadio.DATA, gatewayRadio.DATALEN);
+      if (gatewayRadio.ACK_REQUESTED) {
+        AckRecord ack;
+        ack.pending = 0;
+        ack.rssi = gatewayRadio.RSSI;
+        ack.channel = ACK_NO_CHANNEL;
+        gatewayRadio.sendACK(&ack, sizeof(ack));
+      }
+    }
+  }
+}
+
+//------------------------------------------------------------------------------
+// A repeater: beacon, and relay whatever comes its way.
+//
+static void repeater(void* arg) {
+  byte r = (RFM69*) arg - repeaterRadios;
+  repeaterRadios[r].initialize(FREQUENCY, GATEWAY_ID + 1 + r, NETWORK_ID);
+  repeaterRadios[r].setHighPower();
+  repeaterMeshes[r]->begin(GATEWAY_ID + 1 + r, GATEWAY_ID, true);
+  while (true) {
+    repeaterMeshes[r]->poll();
+    if (repeaterRadios[r].receiveDone()) {
+      repeaterMeshes[r]->receive();
+    }
+  }
+}
+
+//------------------------------------------------------------------------------
+// A mote: report, straight to the gateway or over the mesh.
+//
+static void mote(void* arg) {
+  byte i = (RFM69*) arg - moteRadios;
+  RFM69& radio = moteRadios[i];
+  radio.initialize(FREQUENCY, FIRST_MOTE + i, NETWORK_ID);
+  radio.setHighPower();
+  moteMeshes[i]->begin(FIRST_MOTE + i, GATEWAY_ID);
+  Message msg;
+  uint32_t seq = 0;
+  while (true) {
+    radio.sleep();
+    air.wait((PERIOD_MS * (90 + air.random(21)) / 100) * 1000ULL);
+    memset(&msg, 0, sizeof(msg));
+    msg.msg.type = MSG_READING;
+    msg.msg.source = FIRST_MOTE + i;
+    msg.msg.destination = GATEWAY_ID;
+    seq++;
+    memcpy(msg.msg.data, &seq, sizeof(seq));
+    offered[i]++;
+    if (mode == DIRECT) {
+      radio.sendWithRetry(GATEWAY_ID, msg.raw, MSG_LENGTH);
+    } else {
+      moteMeshes[i]->send(GATEWAY_ID, msg.raw, MSG_LENGTH, mode == MESH_E2E);
+    }
+  }
+}
+
+static void run() {
+  air.reset();
+  air.seed(42);
+  memset(offered, 0, sizeof(offered));
+  memset(delivered, 0, sizeof(delivered));
+  memset(lastSeq, 0, sizeof(lastSeq));
+  memset(&gatewayRadio.stats, 0, sizeof(gatewayRadio.stats));
+  delete gatewayMesh;
+  gatewayMesh = new MeshRouter(gatewayRadio);
+  uint64_t start = air.now();
+  air.spawn(gateway, NULL);
+  if (mode != DIRECT) {
+    for (byte r = 0; r < REPEATERS; r++) {
+      memset(&repeaterRadios[r].stats, 0, sizeof(repeaterRadios[r].stats));
+      delete repeaterMeshes[r];
+      repeaterMeshes[r] = new MeshRouter(repeaterRadios[r]);
+      air.spawn(repeater, &repeaterRadios[r], air.random(1000) * 1000ULL);
+    }
+  }
+  for (byte i = 0; i < MOTES; i++) {
+    memset(&moteRadios[i].stats, 0, sizeof(moteRadios[i].stats));
+    delete moteMeshes[i];
+    moteMeshes[i] = new MeshRouter(moteRadios[i]);
+    air.spawn(mote, &moteRadios[i], (1000 + air.random(PERIOD_MS)) * 1000ULL);
+  }
+  air.run(start + RUN_MS * 1000ULL);
+}
+
+//------------------------------------------------------------------------------
+// Prints one row for the motes at the edge, or for the rest.
+//
+static void report(bool edge) {
+  const float gatewayAt[2] = { 0, 0 };
+  unsigned long sent = 0, got = 0, retries = 0, solicits = 0;
+  byte motes = 0;
+  for (byte i = 0; i < MOTES; i++) {
+    if ((VirtualAir::pathLossRssi(moteAt[i], gatewayAt, RSSI_1M, PATH_LOSS) + HW_GAIN_DB < EDGE_RSSI) != edge) {
+      continue;
+    }
+    motes++;
+    sent += offered[i];
+    got += delivered[i];
+    retries += moteRadios[i].stats.retries;
+    if (mode != DIRECT) solicits += moteMeshes[i]->stats.solicits;
+  }
+  Serial.print(modeNames[mode]);
+  Serial.print(edge ? ", edge, " : ", in range, ");
+  Serial.print(motes);
+  Serial.print(", ");
+  Serial.print(sent ? 100.0 * got / sent : 0.0, 2);
+  Serial.print(", ");
+  Serial.print(sent ? (float) retries / sent : 0.0, 3);
+  Serial.print(", ");
+  Serial.println(solicits);
+}
+
+void setup() {
+  Serial.begin(BAUD_RATE);
+  air.seed(7);
+  air.setJitter(FADING_DB);
+  air.setDefaultLink(0, -127);
+
+  // every pair of nodes, both ways
+  const byte nodes = 1 + REPEATERS + MOTES;
+  byte ids[nodes];
+  float at[nodes][2];
+  ids[0] = GATEWAY_ID;
+  at[0][0] = at[0][1] = 0;
+  for (byte r = 0; r < REPEATERS; r++) {
+    ids[1 + r] = GATEWAY_ID + 1 + r;
+    at[1 + r][0] = repeaterAt[r][0];
+    at[1 + r][1] = repeaterAt[r][1];
+  }
+  for (byte i = 0; i < MOTES; i++) {
+    moteAt[i][0] = air.random(SIDE_M * 10) / 10.0;
+    moteAt[i][1] = air.random(SIDE_M * 10) / 10.0;
+    ids[1 + REPEATERS + i] = FIRST_MOTE + i;
+    at[1 + REPEATERS + i][0] = moteAt[i][0];
+    at[1 + REPEATERS + i][1] = moteAt[i][1];
+  }
+  for (byte a = 0; a < nodes; a++) {
+    for (byte b = 0; b < nodes; b++) {
+      if (a != b) air.setLink(ids[a], ids[b], 0, VirtualAir::pathLossRssi(at[a], at[b], RSSI_1M, PATH_LOSS));
+    }
+  }
+
+  Serial.println("mode, motes, count, delivered %, mote retries/report, mote solicitations");
+  for (mode = DIRECT; mode < MODE_END; mode++) {
+    run();
+    unsigned long relayRetries = gatewayRadio.stats.retries;
+    if (mode != DIRECT) {
+      for (byte r = 0; r < REPEATERS; r++) relayRetries += repeaterRadios[r].stats.retries;
+    }
+    unsigned long sent = 0;
+    for (byte i = 0; i < MOTES; i++) sent += offered[i];
+    report(false);
+    report(true);
+    Serial.print(modeNames[mode]);
+    Serial.print(", relays, ");
+    Serial.print(relayRetries);
+    Serial.print(" retries, ");
+    Serial.print(sent ? (float) relayRetries / sent : 0.0, 3);
+    Serial.println(" per report");
+  }
+}
+
+void loop() {
+  air.wait(1000000);
+}
@@ -0,0 +1,90 @@
+/*
+  CommandQueue.h - Library for holding commands until a mote checks in.
+  Created by Jon R. Brule, October 19, 2026.
+  Released into the public domain.
+*/
+#ifndef CommandQueue_h
+#define CommandQueue_h
+
+#include "Arduino.h"
+#include "Message.h"
+
+#define COMMAND_QUEUE_SIZE  8
+
+class CommandQueue {
+  public:
+    CommandQueue() {
+      _next = 0;
+      for (byte i = 0; i < COMMAND_QUEUE_SIZE; i++) {
+        _order[i] = 0;
+      }
+    }
+    
+    //-------------------------------------------------------------------------
+    // Queues a config op (MSG_CONFIG) for its destination. A pending op for
+    // the same node, operation and key is replaced, so only the latest value
+    // of a setting is delivered. Returns false when the queue is full.
+    //
+    bool push(const Message& command) {
+      byte slot = COMMAND_QUEUE_SIZE;
+      for (byte i = 0; i < COMMAND_QUEUE_SIZE; i++) {
+        if (_order[i] == 0) {
+          if (slot == COMMAND_QUEUE_SIZE) slot = i;
+        } else if (_commands[i].msg.destination == command.msg.destination
+                   && _commands[i].msg.component == command.msg.component
+                   && _commands[i].msg.data[0] == command.msg.data[0]) {
+          memcpy(&_commands[i], &command, sizeof(Message));
+          return true;
+        }
+      }
+      if (slot == COMMAND_QUEUE_SIZE) {
+        return false;
+      }
+      memcpy(&_commands[slot], &command, sizeof(Message));
+      if (++_next == 0) _next = 1;
+      _order[slot] = _next;
+      return true;
+    }
+    
+    //-------------------------------------------------------------------------
+    // Removes the oldest command queued for a node.
+    //
+    bool pop(byte node, Message& command) {
+      byte slot = find(node);
+      if (slot == COMMAND_QUEUE_SIZE) {
+        return false;
+      }
+      memcpy(&command, &_commands[slot], sizeof(Message));
+      _order[slot] = 0;
+      return true;
+    }
+    
+    //-------------------------------------------------------------------------
+    byte pending(byte node) {
+      byte count = 0;
+      for (byte i = 0; i < COMMAND_QUEUE_SIZE; i++) {
+        if (_order[i] != 0 && _commands[i].msg.destination == node) count++;
+      }
+      return count;
+    }
+    
+  protected:
+    byte find(byte node) {
+      byte slot = COMMAND_QUEUE_SIZE;
+      for (byte i = 0; i < COMMAND_QUEUE_SIZE; i++) {
+        if (_order[i] == 0 || _commands[i].msg.destination != node) continue;
+        if (slot == COMMAND_QUEUE_SIZE 
+            || (int8_t) (_order[i] - _order[slot]) < 0) {
+          slot = i;
+        }
+      }
+      return slot;
+    }
+    
+  private:
+    Message _commands[COMMAND_QUEUE_SIZE];
+    byte _order[COMMAND_QUEUE_SIZE];   // 0 = free, else arrival sequence
+    byte _next;
+};
+
+#endif
@@ -18,15 +18,27 @@
 #define MSG_BOOTSTRAP  0x01
 #define MSG_COMMAND    0x43
 #define MSG_INFO       0x49
+#define MSG_CONFIG     0x4B
 #define MSG_READING    0x52
 #define MSG_WARNING    0x62
 
+// MSG_CONFIG operations, carried in the component field; data[0] holds the
+// config key and data[1] its value. Motes answer with a MSG_CONFIG carrying
+// the same component. MSG_COMMAND keeps the component for the node's own
+// actuators, so the two never collide.
+#define CMD_GET        0x01   // read a config key
+#define CMD_SET        0x02   // write a config key
+#define CMD_STATS      0x03   // read mote statistics
+#define CMD_REPORT     0x04   // report immediately
+
+#define CMD_ERROR      0x80   // or'ed into the reply component on failure
+
 typedef struct {
     byte type;
     byte source;
     byte destination;
     byte component;
-    int rssi;
+    int16_t rssi;   // fixed width, so the layout is the same on a host build
     byte data[MSG_DATA_LENGTH];
 } MessageRecord;
 
@@ -37,4 +49,13 @@ typedef struct {
     };
 } Message;
 
+// payload of the ACK a gateway returns for a mote report
+typedef struct {
+    byte pending;   // commands queued for the mote; listen if non-zero
+    int8_t rssi;    // dBm at which the gateway heard the report, for ATPC
+    byte channel;   // ChannelPlan channel the mote is to use, or ACK_NO_CHANNEL
+} AckRecord;
+
+#define ACK_NO_CHANNEL 0xFF   // AckRecord.channel from a gateway without a channel plan
+
 #endif
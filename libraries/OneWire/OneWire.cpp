@@ -141,12 +141,18 @@ sample code bearing this copyright.
 
 #include "OneWire.h"
 
+#ifndef ONEWIRE_SIMULATED
+
+#if !ONEWIRE_UART
 
 OneWire::OneWire(uint8_t pin)
 {
 	pinMode(pin, INPUT);
 	bitmask = PIN_TO_BITMASK(pin);
 	baseReg = PIN_TO_BASEREG(pin);
+#if ONEWIRE_OVERDRIVE
+	overdrive = 0;
+#endif
 #if ONEWIRE_SEARCH
 	reset_search();
 #endif
@@ -175,6 +181,22 @@ uint8_t OneWire::reset(void)
 		delayMicroseconds(2);
 	} while ( !DIRECT_READ(reg, mask));
 
+#if ONEWIRE_OVERDRIVE
+	if (overdrive) {
+		// an overdrive reset must stay under 80uS, so no interrupts
+		noInterrupts();
+		DIRECT_WRITE_LOW(reg, mask);
+		DIRECT_MODE_OUTPUT(reg, mask);	// drive output low
+		delayMicroseconds(70);
+		DIRECT_MODE_INPUT(reg, mask);	// allow it to float
+		delayMicroseconds(9);
+		r = !DIRECT_READ(reg, mask);
+		interrupts();
+		delayMicroseconds(40);
+		return r;
+	}
+#endif
+
 	noInterrupts();
 	DIRECT_WRITE_LOW(reg, mask);
 	DIRECT_MODE_OUTPUT(reg, mask);	// drive output low
@@ -198,6 +220,26 @@ void OneWire::write_bit(uint8_t v)
 	IO_REG_TYPE mask=bitmask;
 	volatile IO_REG_TYPE *reg IO_REG_ASM = baseReg;
 
+#if ONEWIRE_OVERDRIVE
+	if (overdrive) {
+		noInterrupts();
+		DIRECT_WRITE_LOW(reg, mask);
+		DIRECT_MODE_OUTPUT(reg, mask);	// drive output low
+		if (v & 1) {
+			delayMicroseconds(1);
+			DIRECT_WRITE_HIGH(reg, mask);	// drive output high
+			interrupts();
+			delayMicroseconds(8);
+		} else {
+			delayMicroseconds(8);
+			DIRECT_WRITE_HIGH(reg, mask);	// drive output high
+			interrupts();
+			delayMicroseconds(3);
+		}
+		return;
+	}
+#endif
+
 	if (v & 1) {
 		noInterrupts();
 		DIRECT_WRITE_LOW(reg, mask);
@@ -227,6 +269,21 @@ uint8_t OneWire::read_bit(void)
 	volatile IO_REG_TYPE *reg IO_REG_ASM = baseReg;
 	uint8_t r;
 
+#if ONEWIRE_OVERDRIVE
+	if (overdrive) {
+		noInterrupts();
+		DIRECT_MODE_OUTPUT(reg, mask);
+		DIRECT_WRITE_LOW(reg, mask);
+		delayMicroseconds(1);
+		DIRECT_MODE_INPUT(reg, mask);	// let pin float, pull up will raise
+		delayMicroseconds(1);
+		r = DIRECT_READ(reg, mask);
+		interrupts();
+		delayMicroseconds(7);
+		return r;
+	}
+#endif
+
 	noInterrupts();
 	DIRECT_MODE_OUTPUT(reg, mask);
 	DIRECT_WRITE_LOW(reg, mask);
@@ -289,6 +346,170 @@ void OneWire::read_bytes(uint8_t *buf, uint16_t count) {
     buf[i] = read();
 }
 
+void OneWire::depower()
+{
+	noInterrupts();
+	DIRECT_MODE_INPUT(baseReg, bitmask);
+	interrupts();
+}
+
+#else // ONEWIRE_UART
+
+// The reset pulse is a 0xF0 at 9600 baud: the start bit and four zero
+// bits hold the bus low for 520uS.  A presence pulse then pulls some of
+// the high bits low, so anything other than 0xF0 comes back.
+#define ONEWIRE_UART_RESET_BAUD 9600
+
+// At 115200 baud each byte is one time slot.  0xFF pulls the bus low
+// for just the start bit (write 1, or read), 0x00 for nine bit times
+// (write 0).  A device answering a read with 0 stretches the low pulse,
+// so the byte read back is 0xFF only for a 1.
+#define ONEWIRE_UART_SLOT_BAUD 115200
+
+// Slots in flight at once; keeps the echoes well inside the receive
+// buffer even when transfer_done() is polled slowly.
+#define ONEWIRE_UART_WINDOW 16
+
+// Give up on a transfer when no echo arrives for this long, e.g.
+// because RX is not connected to the bus.
+#define ONEWIRE_UART_TIMEOUT 2000
+
+OneWire::OneWire(HardwareSerial &serial)
+{
+	// the port is opened by reset(), as Serial1 may not be
+	// constructed yet when this runs
+	port = &serial;
+	xferSlots = sentSlots = recvSlots = 0;
+#if ONEWIRE_SEARCH
+	reset_search();
+#endif
+}
+
+uint8_t OneWire::reset(void)
+{
+	unsigned long start;
+	uint8_t r;
+
+	port->flush();		// let the last slots go out at their own speed
+	port->begin(ONEWIRE_UART_RESET_BAUD);
+	while (port->available()) port->read();
+	xferSlots = sentSlots = recvSlots = 0;
+
+	port->write(0xF0);
+	start = micros();
+	while (!port->available()) {
+		if (micros() - start > ONEWIRE_UART_TIMEOUT) {
+			port->begin(ONEWIRE_UART_SLOT_BAUD);
+			return 0;
+		}
+	}
+	r = port->read();
+	port->begin(ONEWIRE_UART_SLOT_BAUD);
+
+	// a bus held low reads back without the last bit
+	return r != 0xF0 && (r & 0x80);
+}
+
+void OneWire::start_slots(uint8_t *buf, uint16_t slots)
+{
+	xferBuf = buf;
+	xferSlots = slots;
+	sentSlots = recvSlots = 0;
+}
+
+void OneWire::transfer_start(uint8_t *buf, uint16_t count)
+{
+	start_slots(buf, count * 8);
+}
+
+uint8_t OneWire::transfer_done(void)
+{
+	while (sentSlots < xferSlots && sentSlots - recvSlots < ONEWIRE_UART_WINDOW
+	       && port->availableForWrite() > 0) {
+		uint8_t bit = xferBuf[sentSlots >> 3] & (1 << (sentSlots & 7));
+		port->write(bit ? 0xFF : 0x00);
+		sentSlots++;
+	}
+	while (recvSlots < sentSlots && port->available()) {
+		uint8_t mask = 1 << (recvSlots & 7);
+		if (port->read() == 0xFF)
+			xferBuf[recvSlots >> 3] |= mask;
+		else
+			xferBuf[recvSlots >> 3] &= ~mask;
+		recvSlots++;
+	}
+	return recvSlots == xferSlots;
+}
+
+void OneWire::wait_slots(void)
+{
+	unsigned long start = micros();
+	uint16_t recv = recvSlots;
+
+	while (!transfer_done()) {
+		if (recvSlots != recv) {
+			recv = recvSlots;
+			start = micros();
+		} else if (micros() - start > ONEWIRE_UART_TIMEOUT) {
+			xferSlots = sentSlots = recvSlots;	// the next reset clears the port
+			return;
+		}
+	}
+}
+
+void OneWire::write_bit(uint8_t v)
+{
+	uint8_t b = v & 1;
+	start_slots(&b, 1);
+	wait_slots();
+}
+
+uint8_t OneWire::read_bit(void)
+{
+	uint8_t b = 1;
+	start_slots(&b, 1);
+	wait_slots();
+	return b & 1;
+}
+
+void OneWire::write(uint8_t v, uint8_t power /* = 0 */) {
+	start_slots(&v, 8);
+	wait_slots();
+}
+
+void OneWire::write_bytes(const uint8_t *buf, uint16_t count, bool power /* = 0 */) {
+	uint8_t chunk[ONEWIRE_UART_WINDOW / 8];
+
+	while (count > 0) {
+		uint8_t n = count < sizeof(chunk) ? count : sizeof(chunk);
+		memcpy(chunk, buf, n);
+		start_slots(chunk, n * 8);
+		wait_slots();
+		buf += n;
+		count -= n;
+	}
+}
+
+uint8_t OneWire::read() {
+	uint8_t r = 0xFF;
+	start_slots(&r, 8);
+	wait_slots();
+	return r;
+}
+
+void OneWire::read_bytes(uint8_t *buf, uint16_t count) {
+	memset(buf, 0xFF, count);
+	start_slots(buf, count * 8);
+	wait_slots();
+}
+
+void OneWire::depower()
+{
+	// TX idles high through the pullup; there is no strong drive to remove
+}
+
+#endif // ONEWIRE_UART
+
 //
 // Do a ROM select
 //
@@ -309,13 +530,32 @@ void OneWire::skip()
     write(0xCC);           // Skip ROM
 }
 
-void OneWire::depower()
+#if ONEWIRE_OVERDRIVE
+
+//
+// Do an overdrive ROM skip
+//
+void OneWire::overdrive_skip()
 {
-	noInterrupts();
-	DIRECT_MODE_INPUT(baseReg, bitmask);
-	interrupts();
+    write(0x3C);           // Overdrive Skip ROM
+    overdrive = 1;
+}
+
+//
+// Do an overdrive ROM select
+//
+void OneWire::overdrive_select(const uint8_t rom[8])
+{
+    uint8_t i;
+
+    write(0x69);           // Overdrive Match ROM
+    overdrive = 1;
+
+    for (i = 0; i < 8; i++) write(rom[i]);
 }
 
+#endif
+
 #if ONEWIRE_SEARCH
 
 //
@@ -531,6 +771,29 @@ uint8_t OneWire::crc8(const uint8_t *addr, uint8_t len)
 	}
 	return crc;
 }
+#elif ONEWIRE_CRC8_TABLE == 2
+// The CRC is linear, so the full table entry for a byte is the entry for
+// its low nibble xor the entry for its high nibble.  These are rows and
+// columns 0 of the table above.
+static const uint8_t PROGMEM dscrc_lo_table[] = {
+      0, 94,188,226, 97, 63,221,131,194,156,126, 32,163,253, 31, 65};
+static const uint8_t PROGMEM dscrc_hi_table[] = {
+      0,157, 35,190, 70,219,101,248,140, 17,175, 50,202, 87,233,116};
+
+//
+// Compute a Dallas Semiconductor 8 bit CRC with two 16-entry tables.
+//
+uint8_t OneWire::crc8(const uint8_t *addr, uint8_t len)
+{
+	uint8_t crc = 0;
+
+	while (len--) {
+		crc ^= *addr++;
+		crc = pgm_read_byte(dscrc_lo_table + (crc & 0x0F)) ^
+		      pgm_read_byte(dscrc_hi_table + (crc >> 4));
+	}
+	return crc;
+}
 #else
 //
 // Compute a Dallas Semiconductor 8 bit CRC directly.
@@ -595,3 +858,5 @@ uint16_t OneWire::crc16(const uint8_t* input, uint16_t len, uint16_t crc)
 #endif
 
 #endif
+
+#endif // ONEWIRE_SIMULATED
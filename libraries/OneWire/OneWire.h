@@ -1,6 +1,12 @@
 #ifndef OneWire_h
 #define OneWire_h
 
+// Host builds can define ONEWIRE_SIMULATED to replace the bit-banged driver
+// with an in-memory bus of thermometers, see SimulatedOneWire.h.
+#ifdef ONEWIRE_SIMULATED
+#include "SimulatedOneWire.h"
+#else
+
 #include <inttypes.h>
 
 #if defined(__AVR__)
@@ -38,7 +44,8 @@
 // by setting this to 1.  The lookup table enlarges code size by
 // about 250 bytes.  It does NOT consume RAM (but did in very
 // old versions of OneWire).  If you disable this, a slower
-// but very compact algorithm is used.
+// but very compact algorithm is used.  Setting this to 2 picks
+// a middle ground: two 16-entry tables, one lookup per nibble.
 #ifndef ONEWIRE_CRC8_TABLE
 #define ONEWIRE_CRC8_TABLE 1
 #endif
@@ -49,6 +56,27 @@
 #define ONEWIRE_CRC16 1
 #endif
 
+// Drive the bus from a hardware UART instead of a pin by setting
+// this to 1.  TX and RX both connect to the bus (TX through an
+// open-drain buffer or a Schottky diode), each UART byte forms one
+// time slot, and interrupts stay enabled for the whole transfer.
+// Standard speed only, and there is no strong pullup for parasite
+// power, so the 'power' arguments are ignored.
+#ifndef ONEWIRE_UART
+#define ONEWIRE_UART 0
+#endif
+
+// You can exclude overdrive support by defining this to 0.  Overdrive
+// runs time slots about seven times faster, but only devices made for
+// it follow (e.g. DS2431, DS28EA00; the DS18B20 and DS18S20 do not).
+#ifndef ONEWIRE_OVERDRIVE
+#define ONEWIRE_OVERDRIVE !ONEWIRE_UART
+#endif
+
+#if ONEWIRE_UART && ONEWIRE_OVERDRIVE
+#error "OneWire: overdrive timing needs the bit-banged driver"
+#endif
+
 #ifndef FALSE
 #define FALSE 0
 #endif
@@ -259,8 +287,23 @@ void directWriteHigh(volatile IO_REG_TYPE *base, IO_REG_TYPE pin)
 class OneWire
 {
   private:
+#if ONEWIRE_UART
+    HardwareSerial *port;
+
+    // slot transfer in progress, see transfer_start()
+    uint8_t *xferBuf;
+    uint16_t xferSlots, sentSlots, recvSlots;
+
+    void start_slots(uint8_t *buf, uint16_t slots);
+    void wait_slots(void);
+#else
     IO_REG_TYPE bitmask;
     volatile IO_REG_TYPE *baseReg;
+#endif
+
+#if ONEWIRE_OVERDRIVE
+    uint8_t overdrive;
+#endif
 
 #if ONEWIRE_SEARCH
     // global search state
@@ -271,7 +314,12 @@ class OneWire
 #endif
 
   public:
+#if ONEWIRE_UART
+    // Drive the bus from a hardware serial port, e.g. Serial1.
+    OneWire( HardwareSerial &serial);
+#else
     OneWire( uint8_t pin);
+#endif
 
     // Perform a 1-Wire reset cycle. Returns 1 if a device responds
     // with a presence pulse.  Returns 0 if there is no device or the
@@ -311,6 +359,33 @@ class OneWire
     // someone shorts your bus.
     void depower(void);
 
+#if ONEWIRE_OVERDRIVE
+    // Issue a 1-Wire overdrive skip command, after a reset at standard
+    // speed.  Every device that supports overdrive switches to it, and
+    // so does this driver.
+    void overdrive_skip(void);
+
+    // Issue a 1-Wire overdrive match command, after a reset at standard
+    // speed.  The rom goes out at overdrive speed, and only that device
+    // switches to overdrive.
+    void overdrive_select(const uint8_t rom[8]);
+
+    // Select the time slots used by this driver.  A reset at standard
+    // speed returns every device to standard speed.
+    void set_overdrive(uint8_t on) { overdrive = on; }
+    uint8_t get_overdrive(void) { return overdrive; }
+#endif
+
+#if ONEWIRE_UART
+    // Start shifting count bytes without waiting.  Each byte of buf is
+    // sent and replaced by the byte read back, so fill it with 0xFF to
+    // read.  The UART times every slot, and transfer_done() only moves
+    // bytes in and out of its buffers: call it until it returns 1 and
+    // do other work in between.
+    void transfer_start(uint8_t *buf, uint16_t count);
+    uint8_t transfer_done(void);
+#endif
+
 #if ONEWIRE_SEARCH
     // Clear the search state so that if will start from the beginning again.
     void reset_search();
@@ -373,4 +448,6 @@ class OneWire
 #endif
 };
 
+#endif // ONEWIRE_SIMULATED
+
 #endif
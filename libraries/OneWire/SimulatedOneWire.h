@@ -0,0 +1,293 @@
+/*
+  SimulatedOneWire.h - In-memory 1-Wire bus of DS18x20 thermometers.
+  Created by Jon R. Brule, October 19, 2026.
+  Released into the public domain.
+  
+  A drop-in for the OneWire class in host builds, selected by defining 
+  ONEWIRE_SIMULATED, so DallasTemperature, DallasConverter and sketches can 
+  be exercised without hardware. Devices answer reset, Match/Skip ROM, 
+  Search ROM, Convert T, Read/Write Scratchpad and Read Power Supply. Tests 
+  can unplug devices, corrupt their scratchpads and count the bus time a 
+  real master would have spent, at standard speed.
+*/
+#ifndef SimulatedOneWire_h
+#define SimulatedOneWire_h
+
+#include <stdint.h>
+#include <string.h>
+
+#define ONEWIRE_SIM_DEVICES    8
+#define ONEWIRE_SIM_RESET_US   960   // reset pulse plus presence window
+#define ONEWIRE_SIM_SLOT_US    70    // one read or write time slot
+
+typedef struct {
+  uint8_t rom[8];
+  uint8_t scratchPad[9];
+  int16_t temperature;   // 1/16 degree C latched by the next Convert T
+  bool parasite;
+  bool present;
+  bool corrupt;          // flip a bit in every scratchpad read
+} SimulatedDevice;
+
+class OneWire {
+  public:
+    OneWire(uint8_t pin = 0) {
+      _count = 0;
+      resetStats();
+      reset_search();
+      _state = IDLE;
+    }
+    
+    //--------------------------------------------------------------------------
+    // bus model
+    
+    SimulatedDevice* attach(uint8_t family, uint32_t serial, int16_t temperature = 0,
+                            bool parasite = false) {
+      if (_count >= ONEWIRE_SIM_DEVICES) {
+        return NULL;
+      }
+      SimulatedDevice& device = _devices[_count++];
+      memset(&device, 0, sizeof(device));
+      device.rom[0] = family;
+      for (uint8_t i = 1; i < 7; i++, serial >>= 8) {
+        device.rom[i] = serial & 0xFF;
+      }
+      device.rom[7] = crc8(device.rom, 7);
+      static const uint8_t powerOn[8] = { 0x50, 0x05, 0x4B, 0x46, 0x7F, 0xFF, 0x0C, 0x10 };
+      memcpy(device.scratchPad, powerOn, 8);
+      device.scratchPad[8] = crc8(device.scratchPad, 8);
+      device.temperature = temperature;
+      device.parasite = parasite;
+      device.present = true;
+      return &device;
+    }
+    
+    inline SimulatedDevice* device(uint8_t index) { return &_devices[index]; }
+    inline unsigned long busMicros() { return _busMicros; }
+    inline unsigned int resets() { return _resets; }
+    inline unsigned int searches() { return _searches; }
+    void resetStats() { _busMicros = 0; _resets = 0; _searches = 0; }
+    
+    //--------------------------------------------------------------------------
+    // OneWire interface
+    
+    uint8_t reset(void) {
+      _busMicros += ONEWIRE_SIM_RESET_US;
+      _resets++;
+      _state = ROM;
+      _selected = -1;
+      _broadcast = false;
+      _readLength = 0;
+      return anyPresent();
+    }
+    
+    void select(const uint8_t rom[8]) {
+      slots(8 + 64);
+      _selected = -1;
+      for (uint8_t i = 0; i < _count; i++) {
+        if (_devices[i].present && memcmp(_devices[i].rom, rom, 8) == 0) {
+          _selected = i;
+        }
+      }
+      _state = FUNCTION;
+    }
+    
+    void skip(void) {
+      slots(8);
+      _broadcast = true;
+      _state = FUNCTION;
+    }
+    
+    void write(uint8_t v, uint8_t power = 0) {
+      slots(8);
+      if (_state == FUNCTION) {
+        command(v);
+      } else if (_state == WRITING && _writeIndex < 5) {
+        for (uint8_t i = 0; i < _count; i++) {
+          if (addressed(i)) {
+            _devices[i].scratchPad[_writeIndex] = v;
+            _devices[i].scratchPad[8] = crc8(_devices[i].scratchPad, 8);
+          }
+        }
+        _writeIndex++;
+      }
+    }
+    
+    void write_bytes(const uint8_t *buf, uint16_t count, bool power = 0) {
+      for (uint16_t i = 0; i < count; i++) {
+        write(buf[i], power);
+      }
+    }
+    
+    uint8_t read(void) {
+      slots(8);
+      return (_readIndex < _readLength) ? _readBuffer[_readIndex++] : 0xFF;
+    }
+    
+    void read_bytes(uint8_t *buf, uint16_t count) {
+      for (uint16_t i = 0; i < count; i++) {
+        buf[i] = read();
+      }
+    }
+    
+    void write_bit(uint8_t v) { slots(1); }
+    
+    uint8_t read_bit(void) {
+      slots(1);
+      return _bit;
+    }
+    
+    void depower(void) {}
+    
+    void reset_search() {
+      _searchIndex = 0;
+      _searchFamily = -1;
+    }
+    
+    void target_search(uint8_t family_code) {
+      _searchIndex = 0;
+      _searchFamily = family_code;
+    }
+    
+    // Returns devices in the order the real search algorithm finds them:
+    // ascending by ROM bits taken least significant first.
+    uint8_t search(uint8_t *newAddr, bool search_mode = true) {
+      if (!reset()) {
+        return 0;
+      }
+      _searches++;
+      uint8_t order[ONEWIRE_SIM_DEVICES];
+      uint8_t n = searchOrder(order);
+      while (_searchIndex < n && _searchFamily >= 0 
+             && _devices[order[_searchIndex]].rom[0] != _searchFamily) {
+        _searchIndex++;
+      }
+      _searchFamily = -1;
+      if (_searchIndex >= n) {
+        return 0;
+      }
+      slots(8 + 64 * 3);
+      memcpy(newAddr, _devices[order[_searchIndex++]].rom, 8);
+      return 1;
+    }
+    
+    static uint8_t crc8(const uint8_t *addr, uint8_t len) {
+      uint8_t crc = 0;
+      while (len--) {
+        uint8_t inbyte = *addr++;
+        for (uint8_t i = 8; i; i--) {
+          uint8_t mix = (crc ^ inbyte) & 0x01;
+          crc >>= 1;
+          if (mix) crc ^= 0x8C;
+          inbyte >>= 1;
+        }
+      }
+      return crc;
+    }
+    
+  private:
+    enum { IDLE, ROM, FUNCTION, WRITING, READING };
+    
+    inline void slots(unsigned int count) { _busMicros += count * ONEWIRE_SIM_SLOT_US; }
+    
+    inline bool addressed(uint8_t i) {
+      return _devices[i].present && (_broadcast || _selected == i);
+    }
+    
+    bool anyPresent() {
+      for (uint8_t i = 0; i < _count; i++) {
+        if (_devices[i].present) return true;
+      }
+      return false;
+    }
+    
+    void command(uint8_t v) {
+      _bit = 1;
+      switch (v) {
+        case 0x44:  // Convert T, completes at once
+          for (uint8_t i = 0; i < _count; i++) {
+            if (addressed(i)) latch(_devices[i]);
+          }
+          break;
+        case 0xBE:  // Read Scratchpad, wired-AND of everything addressed
+          memset(_readBuffer, 0xFF, sizeof(_readBuffer));
+          for (uint8_t i = 0; i < _count; i++) {
+            if (addressed(i)) {
+              for (uint8_t j = 0; j < 9; j++) _readBuffer[j] &= _devices[i].scratchPad[j];
+              if (_devices[i].corrupt) _readBuffer[0] ^= 0x01;
+            }
+          }
+          _readLength = 9;
+          _readIndex = 0;
+          _state = READING;
+          break;
+        case 0xB4:  // Read Power Supply, parasite devices pull low
+          for (uint8_t i = 0; i < _count; i++) {
+            if (addressed(i) && _devices[i].parasite) _bit = 0;
+          }
+          break;
+        case 0x4E:  // Write Scratchpad: TH, TL and configuration follow
+          _writeIndex = 2;
+          _state = WRITING;
+          break;
+      }
+    }
+    
+    // stores the device temperature the way the part would report it
+    void latch(SimulatedDevice& device) {
+      int16_t raw = device.temperature;
+      if (device.rom[0] == 0x10) {
+        // DS18S20: rounded half degrees, with COUNT_REMAIN (out of 16) 
+        // holding the rest relative to the whole degree minus a quarter
+        int16_t whole = ((raw + 4) >> 4) << 4;
+        device.scratchPad[6] = 12 - (raw - whole);
+        device.scratchPad[7] = 0x10;
+        raw = (raw + 4) >> 3;
+      } else {
+        raw &= ~((1 << (3 - ((device.scratchPad[4] >> 5) & 0x03))) - 1);
+      }
+      device.scratchPad[0] = raw & 0xFF;
+      device.scratchPad[1] = (raw >> 8) & 0xFF;
+      device.scratchPad[8] = crc8(device.scratchPad, 8);
+    }
+    
+    static bool before(const uint8_t* a, const uint8_t* b) {
+      for (uint8_t i = 0; i < 64; i++) {
+        uint8_t x = (a[i >> 3] >> (i & 7)) & 1, y = (b[i >> 3] >> (i & 7)) & 1;
+        if (x != y) return x < y;
+      }
+      return false;
+    }
+    
+    uint8_t searchOrder(uint8_t* order) {
+      uint8_t n = 0;
+      for (uint8_t i = 0; i < _count; i++) {
+        if (!_devices[i].present) continue;
+        uint8_t j = n++;
+        while (j > 0 && before(_devices[i].rom, _devices[order[j - 1]].rom)) {
+          order[j] = order[j - 1];
+          j--;
+        }
+        order[j] = i;
+      }
+      return n;
+    }
+    
+    SimulatedDevice _devices[ONEWIRE_SIM_DEVICES];
+    uint8_t _count;
+    uint8_t _state;
+    int8_t _selected;
+    bool _broadcast;
+    uint8_t _bit;
+    uint8_t _readBuffer[9];
+    uint8_t _readLength;
+    uint8_t _readIndex;
+    uint8_t _writeIndex;
+    uint8_t _searchIndex;
+    int16_t _searchFamily;
+    unsigned long _busMicros;
+    unsigned int _resets;
+    unsigned int _searches;
+};
+
+#endif
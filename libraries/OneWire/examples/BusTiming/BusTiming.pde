@@ -0,0 +1,61 @@
+#include <OneWire.h>
+
+// OneWire bus timing example
+//
+// Times one scratchpad-sized transaction (reset, select, command and
+// nine bytes read) on the first device found, at standard speed and,
+// if the device answers an overdrive match, at overdrive speed too.
+// Build the library with ONEWIRE_UART=1 to time the UART driver.
+
+#if ONEWIRE_UART
+OneWire  ds(Serial1);  // TX and RX tied to the bus, see OneWire.h
+#else
+OneWire  ds(10);  // on pin 10 (a 4.7K resistor is necessary)
+#endif
+
+byte addr[8];
+
+unsigned long timeRead(void) {
+  byte data[9];
+  unsigned long start = micros();
+
+  ds.reset();
+  ds.select(addr);
+  ds.write(0xBE);         // Read Scratchpad
+  ds.read_bytes(data, 9);
+  return micros() - start;
+}
+
+void setup(void) {
+  Serial.begin(9600);
+}
+
+void loop(void) {
+  if ( !ds.search(addr)) {
+    Serial.println("No devices.");
+    ds.reset_search();
+    delay(1000);
+    return;
+  }
+  ds.reset_search();
+
+  Serial.print("standard:  ");
+  Serial.print(timeRead());
+  Serial.println(" us");
+
+#if ONEWIRE_OVERDRIVE
+  ds.reset();
+  ds.overdrive_select(addr);
+  if (ds.reset()) {
+    Serial.print("overdrive: ");
+    Serial.print(timeRead());
+    Serial.println(" us");
+  } else {
+    Serial.println("overdrive: not supported by this device");
+  }
+  ds.set_overdrive(0);
+  ds.reset();             // a standard reset returns it to standard speed
+#endif
+
+  delay(5000);
+}
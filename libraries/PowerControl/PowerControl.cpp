@@ -0,0 +1,100 @@
+/*
+  PowerControl.cpp - Logic for automatic RFM69 transmit power control.
+  Created by Jon R. Brule, October 19, 2026.
+  Released into the public domain.
+*/
+#include "Arduino.h"
+#include "PowerControl.h"
+
+// TX supply current against output power, from the RFM69W/HW datasheets;
+// the HW's PA1+PA2 and boost take over above +13dBm
+static const int8_t txDbm[] = { -18, 0, 10, 13, 17, 20 };
+static const uint8_t txMilliamps[] = { 14, 20, 33, 45, 95, 130 };
+
+//-----------------------------------------------------------------------------
+PowerControl::PowerControl(RFM69& radio, bool isRFM69HW) : _radio(radio) {
+  _isRFM69HW = isRFM69HW;
+  _target = ATPC_TARGET_RSSI;
+  _level = ATPC_MAX_LEVEL;
+  _misses = 0;
+  _retries = 0;
+}
+
+//-----------------------------------------------------------------------------
+// Starts on full power; call after the radio is initialized.
+//
+void PowerControl::begin() {
+  _misses = 0;
+  _retries = _radio.stats.retries;
+  setLevel(ATPC_MAX_LEVEL);
+}
+
+//-----------------------------------------------------------------------------
+// A report was acknowledged, and the gateway heard it at rssi dBm.
+//
+void PowerControl::acked(int rssi) {
+  int level = _level;
+  _misses = 0;
+  if (retried()) {
+    level += ATPC_RETRY_STEP;
+  } else if (rssi > _target + ATPC_HYSTERESIS) {
+    level -= min(rssi - _target, ATPC_STEP_DOWN);
+  } else if (rssi < _target - ATPC_HYSTERESIS) {
+    level += _target - rssi;
+  }
+  _retries = _radio.stats.retries;
+  setLevel(level);
+}
+
+//-----------------------------------------------------------------------------
+// A report went unacknowledged after all its retries.
+//
+void PowerControl::missed() {
+  _retries = _radio.stats.retries;
+  if (++_misses >= ATPC_MISSES) {
+    setLevel(ATPC_MAX_LEVEL);
+  } else {
+    setLevel(_level + ATPC_RETRY_STEP);
+  }
+}
+
+//-----------------------------------------------------------------------------
+// Output power at the current level: -18 to +13dBm on the RFM69W, +5 to
+// +20dBm on the RFM69HW with its high power registers set.
+//
+int PowerControl::dBm() {
+  return (_isRFM69HW ? -11 : -18) + _level;
+}
+
+//-----------------------------------------------------------------------------
+// Estimated supply current while transmitting at the current level,
+// interpolated between datasheet points.
+//
+unsigned long PowerControl::txMicroamps() {
+  int dbm = dBm();
+  byte i = 1;
+  while (i < sizeof(txDbm) - 1 && dbm > txDbm[i]) {
+    i++;
+  }
+  long span = txDbm[i] - txDbm[i - 1];
+  long rise = (long) (txMilliamps[i] - txMilliamps[i - 1]) * 1000;
+  long ua = txMilliamps[i - 1] * 1000L + rise * (dbm - txDbm[i - 1]) / span;
+  return ua < txMilliamps[0] * 1000L ? txMilliamps[0] * 1000L : ua;
+}
+
+//-----------------------------------------------------------------------------
+// Whether the report took retries. radio.stats may have been zeroed since
+// the last one (EnergyMeter::begin() does); a counter below the snapshot
+// has restarted, and only counts new retries.
+//
+bool PowerControl::retried() {
+  unsigned int now = _radio.stats.retries;
+  return now < _retries ? now != 0 : now != _retries;
+}
+
+//-----------------------------------------------------------------------------
+void PowerControl::setLevel(int level) {
+  int lowest = _isRFM69HW ? ATPC_MIN_LEVEL_HW : 0;
+  _level = (level < lowest) ? lowest : ((level > ATPC_MAX_LEVEL) ? ATPC_MAX_LEVEL : level);
+  _radio.setPowerLevel(_level);
+}
@@ -0,0 +1,55 @@
+/*
+  PowerControl.h - Library for automatic RFM69 transmit power control.
+  Created by Jon R. Brule, October 19, 2026.
+  Released into the public domain.
+
+  Closed-loop ATPC for a mote: the gateway echoes the RSSI at which it
+  heard each report in the ACK (AckRecord.rssi), and the mote steps its
+  power level to hold that RSSI near a target, i.e. a fixed margin above
+  the receiver's sensitivity. Power comes down a few dB per report and
+  goes back up at once, by the whole shortfall; an ACK that took a retry
+  adds ATPC_RETRY_STEP, and ATPC_MISSES reports in a row without an ACK
+  put the radio back on full power.
+
+  One level is one dB, down to level 0 on the RFM69W and to
+  ATPC_MIN_LEVEL_HW on the RFM69HW. dBm() and txMicroamps() estimate the
+  output power and the TX supply current at the current level, from
+  datasheet figures.
+*/
+#ifndef PowerControl_h
+#define PowerControl_h
+
+#include "Arduino.h"
+#include <RFM69.h>
+
+#define ATPC_TARGET_RSSI  -75   // dBm wanted at the gateway, ~20dB above sensitivity
+#define ATPC_HYSTERESIS   3     // dB either side of the target left alone
+#define ATPC_STEP_DOWN    3     // most dB taken off per ACK
+#define ATPC_RETRY_STEP   3     // dB added when an ACK needed a retry, or a report none
+#define ATPC_MISSES       2     // reports without an ACK before going to full power
+#define ATPC_MAX_LEVEL    31
+#define ATPC_MIN_LEVEL_HW 16    // lowest level PA1+PA2 is specified for on the RFM69HW
+
+class PowerControl {
+  public:
+    PowerControl(RFM69& radio, bool isRFM69HW = true);
+    void begin();
+    void acked(int rssi);
+    void missed();
+    inline void setTarget(int rssi) { _target = rssi; }
+    inline byte level() { return _level; }
+    int dBm();
+    unsigned long txMicroamps();
+  protected:
+    bool retried();
+    void setLevel(int level);
+  private:
+    RFM69& _radio;
+    bool _isRFM69HW;
+    int _target;
+    byte _level;
+    byte _misses;
+    unsigned int _retries;        // radio.stats.retries at the last report
+};
+
+#endif
@@ -0,0 +1,172 @@
+/* -----------------------------------------------------------------------------
+   PowerControl ATPC Sweep
+
+   Runs a gateway and a row of RFM69HW motes at increasing distance on the
+   simulated medium, first on full power and then with PowerControl, and
+   prints for each mote the reports delivered and the estimated charge
+   spent transmitting. The gateway echoes the report RSSI in its ACK as
+   oha_gateway_rf_v0_2 does; the link RSSI is jittered per frame to stand
+   in for fading, and frames below VIRTUAL_AIR_SENSITIVITY are lost.
+
+   TX charge is the airtime of every frame a mote sent, retries included,
+   times PowerControl::txMicroamps() at the level it was sent with, so it
+   is only as good as that current model.
+
+   Host only, on the simulated radios: make -C libraries/VirtualAir/host atpcSweep
+----------------------------------------------------------------------------- */
+#include <Message.h>
+#include <PowerControl.h>
+#include <RFM69.h>
+#include <VirtualAir.h>
+
+#define BAUD_RATE     57600
+#define GATEWAY_ID    1
+#define NETWORK_ID    99
+#define FREQUENCY     RF69_915MHZ
+#define MOTES         12
+#define PERIOD_MS     10000    // report interval of each mote
+#define RUN_MS        3600000UL
+#define FADING_DB     4        // link RSSI jitter, either way
+#define NEAREST_RSSI  -40      // link RSSI of the first mote at full RFM69W power
+#define RSSI_STEP     5        // dB further away for each mote after it
+
+VirtualAir& air = VirtualAir::medium();
+RFM69 gatewayRadio;
+RFM69 moteRadios[MOTES];
+PowerControl* controls[MOTES];
+
+bool adaptive;
+unsigned long offered[MOTES];
+unsigned long delivered[MOTES];
+uint32_t lastSeq[MOTES];
+float txCharge[MOTES];          // uAs
+
+//------------------------------------------------------------------------------
+// The gateway: count each report once, ACK with the RSSI it came in at.
+//
+static void gateway(void* arg) {
+  gatewayRadio.initialize(FREQUENCY, GATEWAY_ID, NETWORK_ID);
+  gatewayRadio.setHighPower();
+  while (true) {
+    if (gatewayRadio.receiveDone()) {
+      if (gatewayRadio.DATALEN == sizeof(Message)) {
+        Message msg;
+        uint32_t seq;
+        memcpy(&msg, (byte*) gatewayRadio.DATA, sizeof(msg));
+        memcpy(&seq, msg.msg.data, sizeof(seq));
+        byte i = msg.msg.source - GATEWAY_ID - 1;
+        if (i < MOTES && seq != lastSeq[i]) {
+          lastSeq[i] = seq;
+          delivered[i]++;
+        }
+      }
+      if (gatewayRadio.ACK_REQUESTED) {
+        AckRecord ack;
+        ack.pending = 0;
+        ack.rssi = gatewayRadio.RSSI;
+        ack.channel = ACK_NO_CHANNEL;
+        gatewayRadio.sendACK(&ack, sizeof(ack));
+      }
+    }
+  }
+}
+
+//------------------------------------------------------------------------------
+// A mote: report, charge the frames it took, adjust the power.
+//
+static void mote(void* arg) {
+  byte i = (RFM69*) arg - moteRadios;
+  RFM69& radio = moteRadios[i];
+  PowerControl& power = *controls[i];
+  radio.initialize(FREQUENCY, GATEWAY_ID + 1 + i, NETWORK_ID);
+  radio.setHighPower();
+  power.begin();
+  Message msg;
+  uint32_t seq = 0;
+  while (true) {
+    radio.sleep();
+    air.wait((PERIOD_MS * (90 + air.random(21)) / 100) * 1000ULL);
+    memset(&msg, 0, sizeof(msg));
+    msg.msg.type = MSG_READING;
+    msg.msg.source = GATEWAY_ID + 1 + i;
+    seq++;
+    memcpy(msg.msg.data, &seq, sizeof(seq));
+    offered[i]++;
+
+    unsigned long frames = radio.stats.frames, bytes = radio.stats.bytes;
+    bool acked = radio.sendWithRetry(GATEWAY_ID, msg.raw, MSG_LENGTH);
+    unsigned long onAir = (radio.stats.bytes - bytes) + (radio.stats.frames - frames) * RF69_SIM_OVERHEAD;
+    txCharge[i] += onAir * 8.0 / RF69_SIM_BITRATE * power.txMicroamps();
+
+    if (!adaptive) {
+      continue;
+    }
+    if (!acked) {
+      power.missed();
+    } else if (radio.DATALEN >= sizeof(AckRecord)) {
+      power.acked((int8_t) radio.DATA[offsetof(AckRecord, rssi)]);
+    }
+  }
+}
+
+static void run(bool atpc) {
+  air.reset();
+  air.seed(42);
+  adaptive = atpc;
+  memset(offered, 0, sizeof(offered));
+  memset(delivered, 0, sizeof(delivered));
+  memset(lastSeq, 0, sizeof(lastSeq));
+  memset(txCharge, 0, sizeof(txCharge));
+  air.spawn(gateway, NULL);
+  for (byte i = 0; i < MOTES; i++) {
+    air.spawn(mote, &moteRadios[i], air.random(PERIOD_MS) * 1000ULL);
+  }
+  air.run(air.now() + RUN_MS * 1000ULL);
+}
+
+void setup() {
+  Serial.begin(BAUD_RATE);
+  air.setJitter(FADING_DB);
+  for (byte i = 0; i < MOTES; i++) {
+    controls[i] = new PowerControl(moteRadios[i]);
+    int8_t rssi = NEAREST_RSSI - RSSI_STEP * i;
+    air.setLink(GATEWAY_ID + 1 + i, GATEWAY_ID, 0, rssi);
+    air.setLink(GATEWAY_ID, GATEWAY_ID + 1 + i, 0, rssi);
+  }
+
+  float fullCharge[MOTES];
+  float fullDelivered[MOTES];
+  run(false);
+  for (byte i = 0; i < MOTES; i++) {
+    fullCharge[i] = txCharge[i];
+    fullDelivered[i] = offered[i] ? 100.0 * delivered[i] / offered[i] : 0;
+  }
+  run(true);
+
+  Serial.println("link dBm, full: delivered %, TX uAh, atpc: delivered %, TX dBm, TX uAh, saved %");
+  float fullTotal = 0, atpcTotal = 0;
+  for (byte i = 0; i < MOTES; i++) {
+    fullTotal += fullCharge[i];
+    atpcTotal += txCharge[i];
+    Serial.print(NEAREST_RSSI - RSSI_STEP * i);
+    Serial.print(", ");
+    Serial.print(fullDelivered[i], 2);
+    Serial.print(", ");
+    Serial.print(fullCharge[i] / 3600, 2);
+    Serial.print(", ");
+    Serial.print(offered[i] ? 100.0 * delivered[i] / offered[i] : 0, 2);
+    Serial.print(", ");
+    Serial.print(controls[i]->dBm());
+    Serial.print(", ");
+    Serial.print(txCharge[i] / 3600, 2);
+    Serial.print(", ");
+    Serial.println(fullCharge[i] ? 100.0 * (fullCharge[i] - txCharge[i]) / fullCharge[i] : 0, 1);
+  }
+  Serial.print("TX charge saved over the fleet: ");
+  Serial.print(fullTotal ? 100.0 * (fullTotal - atpcTotal) / fullTotal : 0, 1);
+  Serial.println("%");
+}
+
+void loop() {
+  air.wait(1000000);
+}
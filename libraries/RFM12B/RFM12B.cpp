@@ -5,6 +5,8 @@
 
 #include "RFM12B.h"
 
+#ifndef RFM12B_SIMULATED
+
 uint8_t RFM12B::cs_pin;                // CS pin for SPI
 uint8_t RFM12B::nodeID;                // address of this node
 uint8_t RFM12B::networkID;             // network group ID
@@ -444,3 +446,5 @@ void RFM12B::Encrypt(const uint8_t* key, uint8_t keyLen) {
     crypter = CryptFunction;
   } else crypter = 0;
 }
+
+#endif // RFM12B_SIMULATED
@@ -6,6 +6,12 @@
 #ifndef RFM12B_h
 #define RFM12B_h
 
+// Host builds can define RFM12B_SIMULATED to run on a simulated medium
+// instead of the radio, see SimulatedRFM12B.h.
+#ifdef RFM12B_SIMULATED
+#include "SimulatedRFM12B.h"
+#else
+
 #include <inttypes.h>
 #include <avr/io.h>
 #include <util/crc16.h>
@@ -218,4 +224,6 @@ class RFM12B
     bool CRCPass() { return rf12_crc == 0; }
 };
 
+#endif // RFM12B_SIMULATED
+
 #endif
@@ -0,0 +1,198 @@
+// Simulated RFM12B for host builds, on the VirtualAir medium
+// http://opensource.org/licenses/mit-license.php
+//
+// A drop-in for the RFM12B class, selected by defining RFM12B_SIMULATED, so
+// gateway and mote code can run against a fleet of other simulated radios
+// on the host. ReceiveComplete(), CanSend(), Send() and the ACK helpers
+// behave as in RFM12B.cpp: a completed frame idles the receiver until it
+// is read, and carrier sense uses the RSSI threshold set by Initialize().
+// The frame buffer belongs to each instance rather than to the global
+// rf12_buf, since a simulation holds many radios, so the rf12_* buffer
+// macros are not defined; use Data, DataLen and the accessors.
+//
+// Encryption is not modelled; Encrypt() is accepted and ignored.
+
+#ifndef SimulatedRFM12B_h
+#define SimulatedRFM12B_h
+
+#include <inttypes.h>
+#include <Arduino.h>
+#include <VirtualAir.h>
+
+#define RF12_MAXDATA    128
+#define RF_MAX          (RF12_MAXDATA + 6)
+
+#define RF12_315MHZ     0
+#define RF12_433MHZ     1
+#define RF12_868MHZ     2
+#define RF12_915MHZ     3
+
+#define RF12_2v25       0
+#define RF12_2v55       3
+#define RF12_2v65       4
+#define RF12_2v75       5
+#define RF12_3v05       8
+#define RF12_3v15       9
+#define RF12_3v25       10
+
+#define RF12_HDR_IDMASK      0x7F
+#define RF12_HDR_ACKCTLMASK  0x80
+
+#define RF12_SLEEP   0
+#define RF12_WAKEUP -1
+
+#define RF12_SIM_OVERHEAD   8     // preamble (3), sync (2), CRC (2) and tail (1) bytes
+#define RF12_SIM_THRESHOLD  -91   // RSSI detector threshold set by Initialize()
+#define RF12_SIM_REFERENCE  -6    // full power relative to the RFM69W reference, dB
+
+#ifndef SLEEP_MODE_IDLE
+#define SLEEP_MODE_IDLE     0
+#endif
+#ifndef SLEEP_MODE_STANDBY
+#define SLEEP_MODE_STANDBY  0
+#endif
+
+class RFM12B : public VirtualRadio
+{
+  enum { TXIDLE, TXRECV, TXSEND };
+
+  volatile uint8_t buf[RF_MAX];   // group, hdr1, hdr2, len, data
+  volatile uint8_t rxfill;
+  volatile int8_t rxstate;
+
+  inline uint8_t hdr1() { return buf[1]; }
+  inline uint8_t hdr2() { return buf[2]; }
+
+  void setState(int8_t state) {
+    rxstate = state;
+    VirtualAir::medium().listen(this, state == TXRECV);
+  }
+
+  public:
+    RFM12B():Data(buf + 4),DataLen(&buf[3]) {
+      airFormat = VIRTUAL_AIR_RFM12B;
+      airListening = false;
+      rxstate = TXIDLE;
+      rxfill = 0;
+      memset((void*) buf, 0, sizeof(buf));
+    }
+    uint8_t networkID;
+    uint8_t nodeID;
+    static const byte DATAMAXLEN = RF12_MAXDATA;
+    volatile uint8_t* Data;
+    volatile uint8_t* DataLen;
+
+    // airKbps as for the real part: 10000 / 29 / (1 + value) kbps,
+    // divided by 8 more when bit 7 is set
+    void Initialize(uint8_t nodeid, uint8_t freqBand, uint8_t groupid=0xAA, uint8_t txPower=0, uint8_t airKbps=0x08, uint8_t lowVoltageThreshold=RF12_2v75) {
+      static const uint16_t bands[] = { 315, 433, 868, 915 };
+      nodeID = nodeid;
+      networkID = groupid;
+      airAddress = nodeid;
+      airNetwork = groupid;
+      airFrequency = bands[freqBand & 0x03] * 1000000UL;
+      airBitrate = 344828UL / (1 + (airKbps & 0x7F)) / ((airKbps & 0x80) ? 8 : 1);
+      airPower = RF12_SIM_REFERENCE - (txPower > 7 ? 7 : txPower) * 5 / 2;
+      VirtualAir::medium().attach(this);
+      setState(TXIDLE);
+    }
+
+    void SetCS(uint8_t pin) {}
+
+    void ReceiveStart() {
+      rxfill = buf[3] = 0;
+      setState(TXRECV);
+    }
+
+    // each poll costs VIRTUAL_AIR_POLL_US, which lets the other nodes run
+    bool ReceiveComplete() {
+      VirtualAir::medium().wait(VIRTUAL_AIR_POLL_US);
+      if (rxstate == TXRECV && rxfill > 0) {
+        setState(TXIDLE);
+        uint8_t dest = hdr1() & RF12_HDR_IDMASK;
+        if (dest == 0 || dest == nodeID) {
+          return true;
+        }
+      }
+      if (rxstate == TXIDLE)
+        ReceiveStart();
+      return false;
+    }
+
+    bool CanSend() {
+      if (rxstate == TXRECV && rxfill == 0 && VirtualAir::medium().rssiAt(this) < RF12_SIM_THRESHOLD) {
+        setState(TXIDLE);
+        return true;
+      }
+      return false;
+    }
+
+    uint16_t Control(uint16_t cmd) { return 0; }
+
+    void SendStart(uint8_t toNodeId, bool requestACK=false, bool sendACK=false) {
+      buf[1] = toNodeId | (sendACK ? RF12_HDR_ACKCTLMASK : 0);
+      buf[2] = nodeID | (requestACK ? RF12_HDR_ACKCTLMASK : 0);
+      setState(TXSEND);
+      VirtualAir::medium().transmit(this, toNodeId, toNodeId == 0, (const uint8_t*) buf + 1,
+                                    3 + buf[3], RF12_SIM_OVERHEAD);
+      setState(TXIDLE);
+    }
+
+    void SendStart(uint8_t toNodeId, const void* sendBuf, uint8_t sendLen, bool requestACK=false, bool sendACK=false, uint8_t waitMode=SLEEP_MODE_STANDBY) {
+      buf[3] = sendLen;
+      memcpy((void*) (buf + 4), sendBuf, sendLen);
+      SendStart(toNodeId, requestACK, sendACK);
+    }
+
+    void SendACK(const void* sendBuf = "", uint8_t sendLen=0, uint8_t waitMode=SLEEP_MODE_IDLE) {
+      while (!CanSend()) ReceiveComplete();
+      SendStart(GetSender(), sendBuf, sendLen, false, true, waitMode);
+    }
+
+    void Send(uint8_t toNodeId, const void* sendBuf, uint8_t sendLen, bool requestACK = false, uint8_t waitMode=SLEEP_MODE_STANDBY) {
+      while (!CanSend()) ReceiveComplete();
+      SendStart(toNodeId, sendBuf, sendLen, requestACK, false, waitMode);
+    }
+
+    // SendStart() returns once the frame is out, so there is nothing to wait for
+    void SendWait(uint8_t waitMode=0) {}
+    void OnOff(uint8_t value) { setState(TXIDLE); }
+    void Sleep(char n) { setState(TXIDLE); }
+    void Sleep() { Sleep(0); }
+    void Wakeup() { Sleep(-1); }
+
+    volatile uint8_t * GetData() { return Data; }
+    uint8_t GetDataLen() { return *DataLen; }
+    uint8_t GetSender() { return hdr2() & RF12_HDR_IDMASK; }
+    bool LowBattery() { return false; }
+
+    bool ACKRequested() {
+      return (hdr2() & RF12_HDR_ACKCTLMASK) && !(hdr1() & RF12_HDR_ACKCTLMASK);
+    }
+
+    bool ACKReceived(uint8_t fromNodeID=0) {
+      if (ReceiveComplete())
+        return (hdr1() & RF12_HDR_IDMASK) == nodeID &&
+               (GetSender() == fromNodeID || fromNodeID == 0) &&
+               (hdr1() & RF12_HDR_ACKCTLMASK) &&
+               !(hdr2() & RF12_HDR_ACKCTLMASK);
+      return false;
+    }
+
+    static void CryptFunction(bool sending) {}
+    void Encrypt(const uint8_t* key, uint8_t keyLen = 16) {}
+    bool CRCPass() { return true; }
+
+    // VirtualAir: a whole frame heard; the receiver then idles until read
+    void receive(const VirtualFrame& frame, int rssi) {
+      if (rxstate != TXRECV || rxfill > 0 || frame.length < 3) {
+        return;
+      }
+      buf[0] = networkID;
+      memcpy((void*) (buf + 1), frame.data, frame.length);
+      rxfill = frame.length + 1;
+      VirtualAir::medium().listen(this, false);
+    }
+};
+
+#endif
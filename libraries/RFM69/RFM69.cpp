@@ -10,16 +10,19 @@
 #include <RFM69registers.h>
 #include <SPI.h>
 
-volatile byte RFM69::DATA[MAX_DATA_LEN];
-volatile byte RFM69::_mode;       // current transceiver state
-volatile byte RFM69::DATALEN;
-volatile byte RFM69::SENDERID;
-volatile byte RFM69::TARGETID; //should match _address
-volatile byte RFM69::PAYLOADLEN;
-volatile byte RFM69::ACK_REQUESTED;
-volatile byte RFM69::ACK_RECEIVED; /// Should be polled immediately after sending a packet with ACK request
-volatile int RFM69::RSSI; //most accurate RSSI during reception (closest to the reception)
-RFM69* RFM69::selfPointer;
+#ifndef RFM69_SIMULATED
+
+// REG_OPMODE besides the mode bits, as initialize() sets it; setMode()
+// writes the register whole instead of reading it back first
+#define RF69_OPMODE_BASE (RF_OPMODE_SEQUENCER_ON | RF_OPMODE_LISTEN_OFF)
+
+// cores before Arduino 1.6 lack the mapping; D2 is INT0 and D3 INT1 on both
+// the Atmega328 and the Mega
+#ifndef digitalPinToInterrupt
+#define digitalPinToInterrupt(p) ((p) == 2 ? 0 : ((p) == 3 ? 1 : -1))
+#endif
+
+RFM69* RFM69::_irqRadios[RF69_IRQ_SLOTS];
 
 bool RFM69::initialize(byte freqBand, byte nodeID, byte networkID)
 {
@@ -63,6 +66,10 @@ bool RFM69::initialize(byte freqBand, byte nodeID, byte networkID)
     {255, 0}
   };
 
+  int irq = digitalPinToInterrupt(_interruptPin);
+  if (irq < 0 || irq >= RF69_IRQ_SLOTS) return false;
+
+  unselect();
   pinMode(_slaveSelectPin, OUTPUT);
   SPI.setDataMode(SPI_MODE0);
   SPI.setBitOrder(MSBFIRST);
@@ -72,8 +79,17 @@ bool RFM69::initialize(byte freqBand, byte nodeID, byte networkID)
   do writeReg(REG_SYNCVALUE1, 0xaa); while (readReg(REG_SYNCVALUE1) != 0xaa);
 	do writeReg(REG_SYNCVALUE1, 0x55); while (readReg(REG_SYNCVALUE1) != 0x55);
   
+  // a run of consecutive registers goes out in one burst, as the radio
+  // moves on to the next address after each byte
   for (byte i = 0; CONFIG[i][0] != 255; i++)
-    writeReg(CONFIG[i][0], CONFIG[i][1]);
+  {
+    select();
+    SPI.transfer(CONFIG[i][0] | 0x80);
+    SPI.transfer(CONFIG[i][1]);
+    while (CONFIG[i + 1][0] == CONFIG[i][0] + 1)
+      SPI.transfer(CONFIG[++i][1]);
+    unselect();
+  }
 
   // Encryption is persistent between resets and can trip you up during debugging.
   // Disable it during initialization so we always start from a known state.
@@ -82,10 +98,11 @@ bool RFM69::initialize(byte freqBand, byte nodeID, byte networkID)
   setHighPower(_isRFM69HW); //called regardless if it's a RFM69W or RFM69HW
   setMode(RF69_MODE_STANDBY);
 	while ((readReg(REG_IRQFLAGS1) & RF_IRQFLAGS1_MODEREADY) == 0x00); // Wait for ModeReady
-  attachInterrupt(0, RFM69::isr0, RISING);
+  _irqRadios[irq] = this;
+  attachInterrupt(irq, irq == 0 ? RFM69::isr0 : RFM69::isr1, RISING);
   
-  selfPointer = this;
   _address = nodeID;
+  _backoffSeed = ((word) nodeID << 8) | (byte) micros() | 1; // differs per node, never 0
   return true;
 }
 
@@ -100,23 +117,39 @@ void RFM69::setMode(byte newMode)
 {
 	if (newMode == _mode) return; //TODO: can remove this?
 
+  // listen mode is left for standby with ListenAbort set, in one write, and
+  // only then for the new mode
+  if (_mode == RF69_MODE_LISTEN)
+  {
+    writeReg(REG_OPMODE, RF69_OPMODE_BASE | RF_OPMODE_LISTENABORT | RF_OPMODE_STANDBY);
+    writeReg(REG_OPMODE, RF69_OPMODE_BASE | RF_OPMODE_STANDBY);
+    writeReg(REG_RXTIMEOUT2, RF_RXTIMEOUT2_RSSITHRESH_VALUE);
+    writeReg(REG_PACKETCONFIG1, (readReg(REG_PACKETCONFIG1) & 0xF9) | RF_PACKET1_ADRSFILTERING_OFF);
+    while ((readReg(REG_IRQFLAGS1) & RF_IRQFLAGS1_MODEREADY) == 0x00); // Wait for ModeReady
+  }
+
 	switch (newMode) {
 		case RF69_MODE_TX:
-			writeReg(REG_OPMODE, (readReg(REG_OPMODE) & 0xE3) | RF_OPMODE_TRANSMITTER);
+			writeReg(REG_OPMODE, RF69_OPMODE_BASE | RF_OPMODE_TRANSMITTER);
       if (_isRFM69HW) setHighPowerRegs(true);
 			break;
 		case RF69_MODE_RX:
-			writeReg(REG_OPMODE, (readReg(REG_OPMODE) & 0xE3) | RF_OPMODE_RECEIVER);
+			writeReg(REG_OPMODE, RF69_OPMODE_BASE | RF_OPMODE_RECEIVER);
       if (_isRFM69HW) setHighPowerRegs(false);
 			break;
 		case RF69_MODE_SYNTH:
-			writeReg(REG_OPMODE, (readReg(REG_OPMODE) & 0xE3) | RF_OPMODE_SYNTHESIZER);
+			writeReg(REG_OPMODE, RF69_OPMODE_BASE | RF_OPMODE_SYNTHESIZER);
 			break;
 		case RF69_MODE_STANDBY:
-			writeReg(REG_OPMODE, (readReg(REG_OPMODE) & 0xE3) | RF_OPMODE_STANDBY);
+			writeReg(REG_OPMODE, RF69_OPMODE_BASE | RF_OPMODE_STANDBY);
 			break;
 		case RF69_MODE_SLEEP:
-			writeReg(REG_OPMODE, (readReg(REG_OPMODE) & 0xE3) | RF_OPMODE_SLEEP);
+			writeReg(REG_OPMODE, RF69_OPMODE_BASE | RF_OPMODE_SLEEP);
+			break;
+		case RF69_MODE_LISTEN:
+			writeReg(REG_OPMODE, RF69_OPMODE_BASE | RF_OPMODE_STANDBY);
+			writeReg(REG_OPMODE, RF_OPMODE_SEQUENCER_ON | RF_OPMODE_LISTEN_ON | RF_OPMODE_STANDBY);
+      if (_isRFM69HW) setHighPowerRegs(false); // the radio switches to RX by itself
 			break;
 		default: return;
 	}
@@ -126,6 +159,7 @@ void RFM69::setMode(byte newMode)
 	while (_mode == RF69_MODE_SLEEP && (readReg(REG_IRQFLAGS1) & RF_IRQFLAGS1_MODEREADY) == 0x00); // Wait for ModeReady
 
 	_mode = newMode;
+  if (_modeHook) _modeHook(_modeContext, newMode);
 }
 
 void RFM69::sleep() {
@@ -156,11 +190,45 @@ bool RFM69::canSend()
   return false;
 }
 
-void RFM69::send(byte toAddress, const void* buffer, byte bufferSize, bool requestACK)
+// returns false, without sending, if the channel stayed busy (see waitForChannel)
+bool RFM69::send(byte toAddress, const void* buffer, byte bufferSize, bool requestACK)
 {
   writeReg(REG_PACKETCONFIG2, (readReg(REG_PACKETCONFIG2) & 0xFB) | RF_PACKET2_RXRESTART); // avoid RX deadlocks
-  while (!canSend()) receiveDone();
+  if (!waitForChannel()) return false;
   sendFrame(toAddress, buffer, bufferSize, requestACK, false);
+  return true;
+}
+
+// Listen before talk. Waits a random number of backoff slots out of a window
+// of 2^CSMA_MIN_BE, listening, then senses the carrier; each time the channel
+// is busy the window doubles, up to 2^CSMA_MAX_BE slots. Nodes woken by the
+// same event, or queued behind the same frame, so spread out rather than all
+// transmitting the moment the channel clears. Gives up after
+// CSMA_MAX_BACKOFFS busy checks.
+bool RFM69::waitForChannel()
+{
+  byte exponent = CSMA_MIN_BE;
+  for (byte busy = 0; busy <= CSMA_MAX_BACKOFFS; busy++)
+  {
+    receivePoll(); // carrier sense needs RX mode
+    unsigned long wait = (backoffRandom() & ((1 << exponent) - 1)) * (unsigned long) CSMA_SLOT_US;
+    unsigned long start = micros();
+    while (micros() - start < wait) receivePoll();
+    if (canSend()) return true;
+    stats.backoffs++;
+    if (exponent < CSMA_MAX_BE) exponent++;
+  }
+  stats.busy++;
+  return false;
+}
+
+// xorshift16, seeded per node so that motes woken together draw different slots
+word RFM69::backoffRandom()
+{
+  _backoffSeed ^= _backoffSeed << 7;
+  _backoffSeed ^= _backoffSeed >> 9;
+  _backoffSeed ^= _backoffSeed << 8;
+  return _backoffSeed;
 }
 
 // to increase the chance of getting a packet across, call this function instead of send
@@ -173,7 +241,8 @@ bool RFM69::sendWithRetry(byte toAddress, const void* buffer, byte bufferSize, b
   long sentTime;
   for (byte i=0; i<=retries; i++)
   {
-    send(toAddress, buffer, bufferSize, true);
+    if (i > 0) stats.retries++;
+    if (!send(toAddress, buffer, bufferSize, true)) continue; // channel busy, no ACK to wait for
     sentTime = millis();
     while (millis()-sentTime<retryWaitTime)
     {
@@ -185,31 +254,37 @@ bool RFM69::sendWithRetry(byte toAddress, const void* buffer, byte bufferSize, b
     }
     //Serial.print(" RETRY#");Serial.println(i+1);
   }
+  stats.failures++;
   return false;
 }
 
 /// Should be polled immediately after sending a packet with ACK request
 bool RFM69::ACKReceived(byte fromNodeID) {
-  if (receiveDone())
+  if (receivePoll())
     return (SENDERID == fromNodeID || fromNodeID == RF69_BROADCAST_ADDR) && ACK_RECEIVED;
   return false;
 }
 
 /// Should be called immediately after reception in case sender wants ACK
-void RFM69::sendACK(const void* buffer, byte bufferSize) {
+/// Goes out after the TX turnaround only, without carrier sense or backoff:
+/// the sender is listening for it, and its other neighbours heard the frame
+/// being ACKed and are still waiting out their own backoff. A random backoff
+/// here would spend most of the sender's retryWaitTime. Always returns true.
+bool RFM69::sendACK(const void* buffer, byte bufferSize) {
   byte sender = SENDERID;
-  while (!canSend()) receiveDone();
   sendFrame(sender, buffer, bufferSize, false, true);
+  return true;
 }
 
-void RFM69::sendFrame(byte toAddress, const void* buffer, byte bufferSize, bool requestACK, bool sendACK)
+void RFM69::sendFrame(byte toAddress, const void* buffer, byte bufferSize, bool requestACK, bool sendACK, byte ctlFlags)
 {
   setMode(RF69_MODE_STANDBY); //turn off receiver to prevent reception while filling fifo
 	while ((readReg(REG_IRQFLAGS1) & RF_IRQFLAGS1_MODEREADY) == 0x00); // Wait for ModeReady
   writeReg(REG_DIOMAPPING1, RF_DIOMAPPING1_DIO0_00); // DIO0 is "Packet Sent"
   if (bufferSize > MAX_DATA_LEN) bufferSize = MAX_DATA_LEN;
 
-	//write to FIFO
+	//write to FIFO, a chunk per transaction so that interrupts are not masked
+	//for the whole frame; the FIFO keeps filling across transactions
 	select();
 	SPI.transfer(REG_FIFO | 0x80);
 	SPI.transfer(bufferSize + 3);
@@ -218,14 +293,24 @@ void RFM69::sendFrame(byte toAddress, const void* buffer, byte bufferSize, bool
   
   //control byte
   if (sendACK)
-    SPI.transfer(0x80);
+    SPI.transfer(0x80 | ctlFlags);
   else if (requestACK)
-    SPI.transfer(0x40);
-  else SPI.transfer(0x00);
+    SPI.transfer(0x40 | ctlFlags);
+  else SPI.transfer(ctlFlags);
   
 	for (byte i = 0; i < bufferSize; i++)
+  {
+    if (i > 0 && i % RF69_FIFO_CHUNK == 0)
+    {
+      unselect();
+      select();
+      SPI.transfer(REG_FIFO | 0x80);
+    }
     SPI.transfer(((byte*)buffer)[i]);
+  }
 	unselect();
+  stats.frames++;
+  stats.bytes += bufferSize + 4;
 
 	/* no need to wait for transmit mode to be ready since its handled by the radio */
 	setMode(RF69_MODE_TX);
@@ -237,9 +322,10 @@ void RFM69::sendFrame(byte toAddress, const void* buffer, byte bufferSize, bool
 void RFM69::interruptHandler() {
   //pinMode(4, OUTPUT);
   //digitalWrite(4, 1);
-  if (_mode == RF69_MODE_RX && (readReg(REG_IRQFLAGS2) & RF_IRQFLAGS2_PAYLOADREADY))
+  bool listening = _mode == RF69_MODE_LISTEN; // the radio goes back to listening by itself
+  if ((_mode == RF69_MODE_RX || listening) && (readReg(REG_IRQFLAGS2) & RF_IRQFLAGS2_PAYLOADREADY))
   {
-    setMode(RF69_MODE_STANDBY);
+    if (!listening) setMode(RF69_MODE_STANDBY);
     select();
     SPI.transfer(REG_FIFO & 0x7f);
     PAYLOADLEN = SPI.transfer(0);
@@ -258,19 +344,22 @@ void RFM69::interruptHandler() {
     
     ACK_RECEIVED = CTLbyte & 0x80; //extract ACK-requested flag
     ACK_REQUESTED = CTLbyte & 0x40; //extract ACK-received flag
+    _burstEnd = millis() + ((CTLbyte & RF69_CTL_BURST) ? (CTLbyte & 0x1F) * (unsigned long) RF69_BURST_UNIT_MS : 0);
     
     for (byte i= 0; i < DATALEN; i++)
     {
       DATA[i] = SPI.transfer(0);
     }
     unselect();
-    setMode(RF69_MODE_RX);
+    if (!listening) setMode(RF69_MODE_RX);
   }
   RSSI = readRSSI();
   //digitalWrite(4, 0);
 }
 
-void RFM69::isr0() { selfPointer->interruptHandler(); }
+// one trampoline per entry of _irqRadios; raising RF69_IRQ_SLOTS needs more
+void RFM69::isr0() { _irqRadios[0]->interruptHandler(); }
+void RFM69::isr1() { _irqRadios[1]->interruptHandler(); }
 
 void RFM69::receiveBegin() {
   DATALEN = 0;
@@ -287,6 +376,18 @@ void RFM69::receiveBegin() {
 }
 
 bool RFM69::receiveDone() {
+  if (!receivePoll()) return false;
+  if (burstCopy())
+  {
+    receiveBegin();
+    return false;
+  }
+  return true;
+}
+
+// receiveDone() without dropping burst copies, for the driver's own polling,
+// which throws away whatever it receives
+bool RFM69::receivePoll() {
 // ATOMIC_BLOCK(ATOMIC_FORCEON)
 // {
   noInterrupts(); //re-enabled in unselect() via setMode() or via receiveBegin()
@@ -305,6 +406,104 @@ bool RFM69::receiveDone() {
 //}
 }
 
+// Splits a listen duration into a REG_LISTEN1 resolution (1: 64us, 2: 4.1ms,
+// 3: 262ms) and an 8 bit coefficient, at the finest resolution that fits.
+// Idle rounds down and RX up, so a cycle is never longer than a burst.
+static byte listenCoefficient(unsigned long us, bool roundUp, byte* resolution)
+{
+  static const unsigned long resolutions[] = { 64, 4100, 262000 };
+  byte i = 0;
+  while (i < 2 && us > 255 * resolutions[i]) i++;
+  unsigned long coefficient = (us + (roundUp ? resolutions[i] - 1 : 0)) / resolutions[i];
+  *resolution = i + 1;
+  return coefficient < 1 ? 1 : (coefficient > 255 ? 255 : coefficient);
+}
+
+// Hands RX over to the radio's own timer, so the MCU can power down: every
+// idle period (see setListenCycle) the radio receives for a short window
+// and, if it hears a carrier, stays in RX until a frame for this node or
+// RF69_LISTEN_TIMEOUT, then goes back to idle. The radio filters addresses
+// itself here, so only frames for this node (or broadcasts) raise DIO0,
+// which can wake the MCU. Call listenModeEnd() once awake.
+void RFM69::listenModeStart()
+{
+  byte idleResolution, rxResolution;
+  byte idle = listenCoefficient(_listenIdleUs, false, &idleResolution);
+  byte rx = listenCoefficient(_listenRxUs, true, &rxResolution);
+
+  setMode(RF69_MODE_STANDBY);
+  DATALEN = 0;
+  SENDERID = 0;
+  TARGETID = 0;
+  PAYLOADLEN = 0;
+  ACK_REQUESTED = 0;
+  ACK_RECEIVED = 0;
+  RSSI = 0;
+  writeReg(REG_DIOMAPPING1, RF_DIOMAPPING1_DIO0_01); //set DIO0 to "PAYLOADREADY" in receive mode
+  writeReg(REG_LISTEN1, (idleResolution << 6) | (rxResolution << 4) | RF_LISTEN1_CRITERIA_RSSI | RF_LISTEN1_END_10);
+  writeReg(REG_LISTEN2, idle);
+  writeReg(REG_LISTEN3, rx);
+  writeReg(REG_RXTIMEOUT2, RF69_LISTEN_TIMEOUT);
+  writeReg(REG_NODEADRS, _address);
+  if (!_promiscuousMode)
+    writeReg(REG_PACKETCONFIG1, (readReg(REG_PACKETCONFIG1) & 0xF9) | RF_PACKET1_ADRSFILTERING_NODEBROADCAST);
+  setMode(RF69_MODE_LISTEN);
+}
+
+// Leaves listen mode for standby. Returns true if a frame for this node came
+// in, which is then in DATA as after receiveDone(): read by the interrupt,
+// or here if the MCU woke on a pin change and the interrupt never ran.
+bool RFM69::listenModeEnd()
+{
+  if (_mode != RF69_MODE_LISTEN) return false;
+  if (PAYLOADLEN == 0) interruptHandler();
+  setMode(RF69_MODE_STANDBY);
+  return PAYLOADLEN > 0 && !burstCopy();
+}
+
+// Wakes a node in listen mode: sends the frame back to back for a whole
+// listen cycle, and an eighth more for the drift of the node's RC timer, so
+// one of its receive windows falls on a copy. Each copy carries the time
+// the burst has left, see burstRemaining(); receiveDone() hands over only
+// the first copy it gets. The node must listen with the same cycle as set here. No ACK is requested; returns false if the channel
+// stayed busy. Mind the 1% duty cycle of an RFM69HW at +20dBm.
+bool RFM69::sendBurst(byte toAddress, const void* buffer, byte bufferSize)
+{
+  writeReg(REG_PACKETCONFIG2, (readReg(REG_PACKETCONFIG2) & 0xFB) | RF_PACKET2_RXRESTART); // avoid RX deadlocks
+  if (!waitForChannel()) return false;
+  unsigned long length = (_listenIdleUs + _listenRxUs) / 1000;
+  length += length / 8;
+  unsigned long start = millis(), elapsed;
+  while ((elapsed = millis() - start) < length)
+  {
+    unsigned long left = (length - elapsed + RF69_BURST_UNIT_MS - 1) / RF69_BURST_UNIT_MS;
+    sendFrame(toAddress, buffer, bufferSize, false, false, RF69_CTL_BURST | (left > 0x1F ? 0x1F : left));
+  }
+  return true;
+}
+
+// Milliseconds left of the wake-up burst the last frame came from, during
+// which its sender is not listening; 0 after an ordinary frame.
+unsigned long RFM69::burstRemaining()
+{
+  long left = _burstEnd - millis();
+  return left > 0 ? left : 0;
+}
+
+// Whether the frame just received repeats a wake-up burst already handed
+// over, i.e. one from the same sender that has not ended yet. A node that
+// is awake for the whole burst would otherwise act on every copy. Records
+// the burst when it is new.
+bool RFM69::burstCopy()
+{
+  unsigned long now = millis();
+  if ((long) (_burstEnd - now) <= 0) return false; // not part of a burst
+  if (SENDERID == _burstSender && (long) (_burstSenderEnd - now) > 0) return true;
+  _burstSender = SENDERID;
+  _burstSenderEnd = _burstEnd;
+  return false;
+}
+
 // To enable encryption: radio.encrypt("ABCDEFGHIJKLMNOP");
 // To disable encryption: radio.encrypt(null) or radio.encrypt(0)
 // KEY HAS TO BE 16 bytes !!!
@@ -352,14 +551,26 @@ void RFM69::writeReg(byte addr, byte value)
 }
 
 /// Select the transceiver
+/// Interrupts stay masked until unselect(), so that the radio interrupt
+/// cannot start a transaction inside this one. Outside the interrupt
+/// handler no transaction is longer than RF69_FIFO_CHUNK + 5 bytes; build
+/// with RF69_MEASURE_MASKED to keep the longest in stats.maskedUs. The pin
+/// is driven through its port register, digitalWrite() takes a few us.
 void RFM69::select() {
   noInterrupts();
-  digitalWrite(_slaveSelectPin, LOW);
+  *_csPort &= ~_csMask;
+#ifdef RF69_MEASURE_MASKED
+  _selectedAt = micros();
+#endif
 }
 
 /// UNselect the transceiver chip
 void RFM69::unselect() {
-  digitalWrite(_slaveSelectPin, HIGH);
+  *_csPort |= _csMask;
+#ifdef RF69_MEASURE_MASKED
+  unsigned long masked = micros() - _selectedAt;
+  if (masked > stats.maskedUs) stats.maskedUs = masked;
+#endif
   interrupts();
 }
 
@@ -386,6 +597,8 @@ void RFM69::setHighPowerRegs(bool onOff) {
 
 void RFM69::setCS(byte newSPISlaveSelect) {
   _slaveSelectPin = newSPISlaveSelect;
+  _csPort = portOutputRegister(digitalPinToPort(_slaveSelectPin));
+  _csMask = digitalPinToBitMask(_slaveSelectPin);
   pinMode(_slaveSelectPin, OUTPUT);
 }
 
@@ -422,4 +635,6 @@ void RFM69::rcCalibration()
 {
   writeReg(REG_OSC1, RF_OSC1_RCCAL_START);
   while ((readReg(REG_OSC1) & RF_OSC1_RCCAL_DONE) == 0x00);
-}
\ No newline at end of file
+}
+
+#endif // RFM69_SIMULATED
\ No newline at end of file
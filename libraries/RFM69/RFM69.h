@@ -13,12 +13,24 @@
 #define MAX_DATA_LEN         61 // to take advantage of the built in AES/CRC we want to limit the frame size to the internal FIFO size (66 bytes - 3 bytes overhead)
 #define SPI_CS               SS // SS is the SPI slave select pin, for instance D10 on atmega328
 #define RF69_IRQ_PIN          2 // INT0 on AVRs should be connected to DIO0 (ex on Atmega328 it's D2)
+#define RF69_IRQ_SLOTS        2 // external interrupts radios can use, one radio each: INT0 (D2) and INT1 (D3) on the Atmega328
 #define CSMA_LIMIT          -90 // upper RX signal sensitivity threshold in dBm for carrier sense access
+#define CSMA_SLOT_US        300 // backoff slot, longer than the carrier sense to TX turnaround
+#define CSMA_MIN_BE           4 // first backoff window is 2^CSMA_MIN_BE slots...
+#define CSMA_MAX_BE           6 // ...doubling on each busy check up to 2^CSMA_MAX_BE slots
+#define CSMA_MAX_BACKOFFS     8 // busy checks before send() gives up on the channel
+#define RF69_FIFO_CHUNK      16 // payload bytes per SPI transaction when filling the FIFO, see sendFrame()
 #define RF69_MODE_SLEEP       0 // XTAL OFF
 #define	RF69_MODE_STANDBY     1 // XTAL ON
 #define RF69_MODE_SYNTH	      2 // PLL ON
 #define RF69_MODE_RX          3 // RX MODE
 #define RF69_MODE_TX		      4 // TX MODE
+#define RF69_MODE_LISTEN      5 // RX duty cycled by the radio's own timer, see listenModeStart()
+#define RF69_LISTEN_IDLE_US 500000 // default listen cycle: idle on the RC oscillator this long...
+#define RF69_LISTEN_RX_US     256 // ...then receive this long
+#define RF69_LISTEN_TIMEOUT    80 // REG_RXTIMEOUT2: 16 bit periods in RX after a carrier without a frame (23ms)
+#define RF69_CTL_BURST      0x20 // CTL byte flag of a wake-up burst frame, see sendBurst()...
+#define RF69_BURST_UNIT_MS     32 // ...whose low 5 bits hold the burst time left, in these units
 
 //available frequency bands
 #define RF69_315MHZ     31  // non trivial values to avoid misconfiguration
@@ -30,35 +42,70 @@
 #define COURSE_TEMP_COEF    -90 // puts the temperature reading in the ballpark, user can fine tune the returned value
 #define RF69_BROADCAST_ADDR 255
 
+// traffic counters, e.g. for energy accounting; clear with memset to restart
+typedef struct {
+  unsigned long frames;   // frames transmitted, ACKs included
+  unsigned long bytes;    // bytes loaded into the FIFO: length, header and payload
+  unsigned int retries;   // sendWithRetry() attempts after the first
+  unsigned int failures;  // sendWithRetry() calls that got no ACK
+  unsigned int backoffs;  // carrier sense found the channel busy
+  unsigned int busy;      // send() / sendBurst() calls that gave up on a busy channel
+  unsigned int maskedUs;  // longest SPI transaction, interrupts masked; RF69_MEASURE_MASKED builds only
+} RFM69Stats;
+
+// called after every mode change, also from the radio interrupt
+typedef void (*RFM69ModeHook)(void* context, byte mode);
+
+// Host builds can define RFM69_SIMULATED to run on a simulated medium
+// instead of the radio, see SimulatedRFM69.h.
+#ifdef RFM69_SIMULATED
+#include "SimulatedRFM69.h"
+#else
+
+// All state is per instance, so a sketch can run several radios: each on
+// its own chip select and its own DIO0 interrupt (see RF69_IRQ_SLOTS),
+// sharing the SPI bus. Every CS pin must be high before the first radio
+// is initialized, as any radio left selected talks over the others.
 class RFM69 {
   public:
-    static volatile byte DATA[MAX_DATA_LEN];          // recv/xmit buf, including hdr & crc bytes
-    static volatile byte DATALEN;
-    static volatile byte SENDERID;
-    static volatile byte TARGETID; //should match _address
-    static volatile byte PAYLOADLEN;
-    static volatile byte ACK_REQUESTED;
-    static volatile byte ACK_RECEIVED; /// Should be polled immediately after sending a packet with ACK request
-    static volatile int RSSI; //most accurate RSSI during reception (closest to the reception)
-    static volatile byte _mode; //should be protected?
+    volatile byte DATA[MAX_DATA_LEN];          // recv/xmit buf, including hdr & crc bytes
+    volatile byte DATALEN;
+    volatile byte SENDERID;
+    volatile byte TARGETID; //should match _address
+    volatile byte PAYLOADLEN;
+    volatile byte ACK_REQUESTED;
+    volatile byte ACK_RECEIVED; /// Should be polled immediately after sending a packet with ACK request
+    volatile int RSSI; //most accurate RSSI during reception (closest to the reception)
+    volatile byte _mode; //should be protected?
     
     RFM69(byte slaveSelectPin=SPI_CS, byte interruptPin=RF69_IRQ_PIN, bool isRFM69HW=false) {
       _slaveSelectPin = slaveSelectPin;
+      _csPort = portOutputRegister(digitalPinToPort(slaveSelectPin));
+      _csMask = digitalPinToBitMask(slaveSelectPin);
       _interruptPin = interruptPin;
       _mode = RF69_MODE_STANDBY;
       _promiscuousMode = false;
       _powerLevel = 31;
       _isRFM69HW = isRFM69HW;
+      _modeHook = null;
+      _backoffSeed = 1;
+      _listenIdleUs = RF69_LISTEN_IDLE_US;
+      _listenRxUs = RF69_LISTEN_RX_US;
+      _burstEnd = 0;
+      _burstSender = 0;
+      _burstSenderEnd = 0;
+      PAYLOADLEN = 0;
+      memset(&stats, 0, sizeof(stats));
     }
 
     bool initialize(byte freqBand, byte ID, byte networkID=1);
     void setAddress(byte addr);
     bool canSend();
-    void send(byte toAddress, const void* buffer, byte bufferSize, bool requestACK=false);
+    bool send(byte toAddress, const void* buffer, byte bufferSize, bool requestACK=false);
     bool sendWithRetry(byte toAddress, const void* buffer, byte bufferSize, byte retries=2, byte retryWaitTime=30);
     bool receiveDone();
     bool ACKReceived(byte fromNodeID);
-    void sendACK(const void* buffer = "", uint8_t bufferSize=0);
+    bool sendACK(const void* buffer = "", uint8_t bufferSize=0);
     void setFrequency(uint32_t FRF);
     void encrypt(const char* key);
     void setCS(byte newSPISlaveSelect);
@@ -69,24 +116,50 @@ class RFM69 {
     void sleep();
     byte readTemperature(byte calFactor=0); //get CMOS temperature (8bit)
     void rcCalibration(); //calibrate the internal RC oscillator for use in wide temperature variations - see datasheet section [4.3.5. RC Timer Accuracy]
+    void setListenCycle(unsigned long idleUs, unsigned long rxUs) { _listenIdleUs = idleUs; _listenRxUs = rxUs; }
+    void listenModeStart();
+    bool listenModeEnd();
+    bool sendBurst(byte toAddress, const void* buffer, byte bufferSize);
+    unsigned long burstRemaining();
 
     // allow hacking registers by making these public
     byte readReg(byte addr);
     void writeReg(byte addr, byte val);
     void readAllRegs();
 
+    void setModeHook(RFM69ModeHook hook, void* context=null) { _modeHook = hook; _modeContext = context; }
+    RFM69Stats stats;
+
   protected:
     static void isr0();
+    static void isr1();
     void virtual interruptHandler();
-    void sendFrame(byte toAddress, const void* buffer, byte size, bool requestACK=false, bool sendACK=false);
+    void sendFrame(byte toAddress, const void* buffer, byte size, bool requestACK=false, bool sendACK=false, byte ctlFlags=0);
+    bool waitForChannel();
+    word backoffRandom();
+    bool receivePoll();
+    bool burstCopy();
 
-    static RFM69* selfPointer;
+    static RFM69* _irqRadios[RF69_IRQ_SLOTS]; // the radio on each external interrupt
     byte _slaveSelectPin;
+    volatile uint8_t* _csPort;  // chip select, driven through the port register
+    uint8_t _csMask;
+#ifdef RF69_MEASURE_MASKED
+    unsigned long _selectedAt;
+#endif
     byte _interruptPin;
     byte _address;
     bool _promiscuousMode;
     byte _powerLevel;
     bool _isRFM69HW;
+    RFM69ModeHook _modeHook;
+    void* _modeContext;
+    word _backoffSeed;
+    unsigned long _listenIdleUs;
+    unsigned long _listenRxUs;
+    volatile unsigned long _burstEnd; // millis() at which the last burst received ends
+    byte _burstSender;                // sender of the last burst handed over...
+    unsigned long _burstSenderEnd;    // ...and when it ends; later copies are dropped
 
     void receiveBegin();
     void setMode(byte mode);
@@ -95,4 +168,6 @@ class RFM69 {
     void unselect();
 };
 
+#endif // RFM69_SIMULATED
+
 #endif
\ No newline at end of file
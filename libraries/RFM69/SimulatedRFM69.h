@@ -0,0 +1,372 @@
+// **********************************************************************************
+// Simulated RFM69 for host builds, on the VirtualAir medium
+// **********************************************************************************
+// A drop-in for the RFM69 class, selected by defining RFM69_SIMULATED, so
+// gateway and mote code can run against a fleet of other simulated radios
+// on the host. The public interface and its quirks follow RFM69.cpp: one
+// frame buffer that the next frame overwrites if it is not read in time,
+// address filtering that clears PAYLOADLEN, and carrier sense against
+// CSMA_LIMIT. As in the real driver, DATA and the other received fields
+// belong to each instance.
+//
+// Listen mode runs the radio's RX duty cycle as a node of its own on the
+// medium, and a frame for this radio wakes the node that started it, as
+// DIO0 would wake the MCU (see VirtualAir::wake()). The carrier is sensed
+// at the start and the end of each receive window.
+//
+// Encryption is not modelled; encrypt() is accepted and ignored.
+// **********************************************************************************
+#ifndef SimulatedRFM69_h
+#define SimulatedRFM69_h
+#include <Arduino.h>
+#include <VirtualAir.h>
+
+#define RF69_SIM_BITRATE    55555 // REG_BITRATE as set by initialize()
+#define RF69_SIM_OVERHEAD   7     // preamble (3), sync (2) and CRC (2) bytes
+#define RF69_SIM_REFERENCE  13    // dBm output at which link RSSI is given (RFM69W, full power)
+#define RF69_SIM_TURNAROUND 200   // us from carrier sense to the first bit: FIFO fill, PLL lock, PA ramp
+
+class RFM69 : public VirtualRadio {
+  public:
+    volatile byte DATA[MAX_DATA_LEN];
+    volatile byte DATALEN;
+    volatile byte SENDERID;
+    volatile byte TARGETID;
+    volatile byte PAYLOADLEN;
+    volatile byte ACK_REQUESTED;
+    volatile byte ACK_RECEIVED;
+    volatile int RSSI;
+    volatile byte _mode;
+
+    RFM69(byte slaveSelectPin=SPI_CS, byte interruptPin=RF69_IRQ_PIN, bool isRFM69HW=false) {
+      _slaveSelectPin = slaveSelectPin;
+      _interruptPin = interruptPin;
+      _mode = RF69_MODE_STANDBY;
+      _promiscuousMode = false;
+      _powerLevel = 31;
+      _isRFM69HW = isRFM69HW;
+      _modeHook = null;
+      _backoffSeed = 1;
+      _listenIdleUs = RF69_LISTEN_IDLE_US;
+      _listenRxUs = RF69_LISTEN_RX_US;
+      _listenNode = -1;
+      _listenCycling = false;
+      _burstEnd = 0;
+      _burstSender = 0;
+      _burstSenderEnd = 0;
+      memset(&stats, 0, sizeof(stats));
+      memset(_regs, 0, sizeof(_regs));
+      airFormat = VIRTUAL_AIR_RFM69;
+      airBitrate = RF69_SIM_BITRATE;
+      airListening = false;
+      PAYLOADLEN = 0;
+    }
+
+    bool initialize(byte freqBand, byte ID, byte networkID=1) {
+      VirtualAir& air = VirtualAir::medium();
+      airFrequency = (freqBand==RF69_315MHZ ? 315 : (freqBand==RF69_433MHZ ? 433 : (freqBand==RF69_868MHZ ? 868 : 915))) * 1000000UL;
+      airNetwork = networkID;
+      _address = ID;
+      airAddress = ID;
+      _backoffSeed = ((word) ID << 8) | (byte) air.micros() | 1;
+      _listenCycling = false;   // a reset of the medium dropped the cycle's node
+      air.attach(this);
+      setHighPower(_isRFM69HW);
+      setMode(RF69_MODE_STANDBY);
+      return true;
+    }
+
+    void setAddress(byte addr) {
+      _address = addr;
+      airAddress = addr;
+    }
+
+    bool canSend() {
+      if (_mode == RF69_MODE_RX && PAYLOADLEN == 0 && readRSSI() < CSMA_LIMIT) {
+        setMode(RF69_MODE_STANDBY);
+        return true;
+      }
+      return false;
+    }
+
+    bool send(byte toAddress, const void* buffer, byte bufferSize, bool requestACK=false) {
+      if (!waitForChannel()) return false;
+      sendFrame(toAddress, buffer, bufferSize, requestACK, false);
+      return true;
+    }
+
+    bool sendWithRetry(byte toAddress, const void* buffer, byte bufferSize, byte retries=2, byte retryWaitTime=30) {
+      VirtualAir& air = VirtualAir::medium();
+      unsigned long sentTime;
+      for (byte i = 0; i <= retries; i++) {
+        if (i > 0) stats.retries++;
+        if (!send(toAddress, buffer, bufferSize, true)) continue;
+        sentTime = air.millis();
+        while (air.millis() - sentTime < retryWaitTime) {
+          if (ACKReceived(toAddress)) {
+            return true;
+          }
+        }
+      }
+      stats.failures++;
+      return false;
+    }
+
+    // each poll costs VIRTUAL_AIR_POLL_US, which lets the other nodes run
+    bool receiveDone() {
+      if (!receivePoll()) return false;
+      if (burstCopy()) {
+        receiveBegin();
+        return false;
+      }
+      return true;
+    }
+
+    bool ACKReceived(byte fromNodeID) {
+      if (receivePoll())
+        return (SENDERID == fromNodeID || fromNodeID == RF69_BROADCAST_ADDR) && ACK_RECEIVED;
+      return false;
+    }
+
+    // as RFM69::sendACK(): no carrier sense or backoff, only the turnaround
+    bool sendACK(const void* buffer = "", uint8_t bufferSize=0) {
+      byte sender = SENDERID;
+      sendFrame(sender, buffer, bufferSize, false, true);
+      return true;
+    }
+
+    void setFrequency(uint32_t FRF) { airFrequency = (uint32_t) (FRF * 61.03515625); }
+    void encrypt(const char* key) { setMode(RF69_MODE_STANDBY); }
+    void setCS(byte newSPISlaveSelect) { _slaveSelectPin = newSPISlaveSelect; }
+    int readRSSI(bool forceTrigger=false) { return VirtualAir::medium().rssiAt(this); }
+    void promiscuous(bool onOff=true) { _promiscuousMode = onOff; }
+
+    void setHighPower(bool onOFF=true) {
+      _isRFM69HW = onOFF;
+      setPowerLevel(_powerLevel);
+    }
+
+    // Pout = -18 + level on the RFM69W, -11 + level with the HW's boost
+    void setPowerLevel(byte level) {
+      _powerLevel = level > 31 ? 31 : level;
+      airPower = (_isRFM69HW ? -11 : -18) + _powerLevel - RF69_SIM_REFERENCE;
+    }
+
+    void sleep() { setMode(RF69_MODE_SLEEP); }
+
+    void setListenCycle(unsigned long idleUs, unsigned long rxUs) { _listenIdleUs = idleUs; _listenRxUs = rxUs; }
+
+    void listenModeStart() {
+      VirtualAir& air = VirtualAir::medium();
+      setMode(RF69_MODE_STANDBY);
+      DATALEN = 0;
+      SENDERID = 0;
+      TARGETID = 0;
+      PAYLOADLEN = 0;
+      ACK_REQUESTED = 0;
+      ACK_RECEIVED = 0;
+      RSSI = 0;
+      _listenNode = air.currentNode();
+      setMode(RF69_MODE_LISTEN);
+      if (!_listenCycling) {
+        _listenCycling = air.spawn(listenCycle, this) >= 0;
+      }
+    }
+
+    bool listenModeEnd() {
+      if (_mode != RF69_MODE_LISTEN) return false;
+      setMode(RF69_MODE_STANDBY);
+      return PAYLOADLEN > 0 && !burstCopy();
+    }
+
+    // as RFM69::sendBurst()
+    bool sendBurst(byte toAddress, const void* buffer, byte bufferSize) {
+      VirtualAir& air = VirtualAir::medium();
+      if (!waitForChannel()) return false;
+      unsigned long length = (_listenIdleUs + _listenRxUs) / 1000;
+      length += length / 8;
+      unsigned long start = air.millis(), elapsed;
+      while ((elapsed = air.millis() - start) < length) {
+        unsigned long left = (length - elapsed + RF69_BURST_UNIT_MS - 1) / RF69_BURST_UNIT_MS;
+        sendFrame(toAddress, buffer, bufferSize, false, false, RF69_CTL_BURST | (left > 0x1F ? 0x1F : left));
+      }
+      return true;
+    }
+
+    unsigned long burstRemaining() {
+      long left = _burstEnd - VirtualAir::medium().millis();
+      return left > 0 ? left : 0;
+    }
+    byte readTemperature(byte calFactor=0) { return 25 + calFactor; }
+    void rcCalibration() {}
+
+    byte readReg(byte addr) { return _regs[addr & 0x7F]; }
+    void writeReg(byte addr, byte val) { _regs[addr & 0x7F] = val; }
+    void readAllRegs() {}
+
+    void setModeHook(RFM69ModeHook hook, void* context=null) { _modeHook = hook; _modeContext = context; }
+    RFM69Stats stats;
+
+    // VirtualAir: the end of a frame, standing in for the DIO0 interrupt
+    void receive(const VirtualFrame& frame, int rssi) {
+      if ((_mode != RF69_MODE_RX && _mode != RF69_MODE_LISTEN) || frame.length < 4) {
+        return;
+      }
+      if (PAYLOADLEN > 0) {
+        airStats.overwritten++;
+      }
+      interruptHandler(frame.data, frame.length);
+      RSSI = rssi;
+    }
+
+  protected:
+    // as RFM69::receivePoll()
+    bool receivePoll() {
+      VirtualAir::medium().wait(VIRTUAL_AIR_POLL_US);
+      if (_mode == RF69_MODE_RX && PAYLOADLEN > 0) {
+        setMode(RF69_MODE_STANDBY);
+        return true;
+      } else if (_mode == RF69_MODE_RX) {
+        return false;
+      }
+      receiveBegin();
+      return false;
+    }
+
+    // as RFM69::burstCopy()
+    bool burstCopy() {
+      unsigned long now = VirtualAir::medium().millis();
+      if ((long) (_burstEnd - now) <= 0) return false;
+      if (SENDERID == _burstSender && (long) (_burstSenderEnd - now) > 0) return true;
+      _burstSender = SENDERID;
+      _burstSenderEnd = _burstEnd;
+      return false;
+    }
+
+    virtual void interruptHandler(const byte* fifo, byte length) {
+      PAYLOADLEN = fifo[0] > 66 ? 66 : fifo[0];
+      TARGETID = fifo[1];
+      if (!(_promiscuousMode || TARGETID == _address || TARGETID == RF69_BROADCAST_ADDR)) {
+        PAYLOADLEN = 0;
+        return;
+      }
+      DATALEN = PAYLOADLEN - 3;
+      SENDERID = fifo[2];
+      byte CTLbyte = fifo[3];
+      ACK_RECEIVED = CTLbyte & 0x80;
+      ACK_REQUESTED = CTLbyte & 0x40;
+      _burstEnd = VirtualAir::medium().millis()
+                  + ((CTLbyte & RF69_CTL_BURST) ? (CTLbyte & 0x1F) * (unsigned long) RF69_BURST_UNIT_MS : 0);
+      for (byte i = 0; i < DATALEN; i++) {
+        DATA[i] = fifo[4 + i];
+      }
+    }
+
+    void sendFrame(byte toAddress, const void* buffer, byte bufferSize, bool requestACK=false, bool sendACK=false, byte ctlFlags=0) {
+      setMode(RF69_MODE_STANDBY);
+      if (bufferSize > MAX_DATA_LEN) bufferSize = MAX_DATA_LEN;
+      byte fifo[MAX_DATA_LEN + 4];
+      fifo[0] = bufferSize + 3;
+      fifo[1] = toAddress;
+      fifo[2] = _address;
+      fifo[3] = (sendACK ? 0x80 : (requestACK ? 0x40 : 0x00)) | ctlFlags;
+      memcpy(fifo + 4, buffer, bufferSize);
+      stats.frames++;
+      stats.bytes += bufferSize + 4;
+      setMode(RF69_MODE_TX);
+      VirtualAir::medium().wait(RF69_SIM_TURNAROUND);
+      VirtualAir::medium().transmit(this, toAddress, toAddress == RF69_BROADCAST_ADDR,
+                                    fifo, bufferSize + 4, RF69_SIM_OVERHEAD);
+      setMode(RF69_MODE_STANDBY);
+    }
+
+    byte _slaveSelectPin;
+    byte _interruptPin;
+    byte _address;
+    bool _promiscuousMode;
+    byte _powerLevel;
+    bool _isRFM69HW;
+    RFM69ModeHook _modeHook;
+    void* _modeContext;
+    word _backoffSeed;
+    unsigned long _listenIdleUs;
+    unsigned long _listenRxUs;
+    int _listenNode;              // woken by a frame, as the MCU by DIO0
+    bool _listenCycling;
+    unsigned long _burstEnd;
+    byte _burstSender;
+    unsigned long _burstSenderEnd;
+    byte _regs[128];
+
+    // The radio's listen timer: idle, a receive window, and on a carrier
+    // RX until a frame for this radio or RF69_LISTEN_TIMEOUT. Runs until
+    // listen mode is left.
+    static void listenCycle(void* arg) {
+      RFM69& radio = *(RFM69*) arg;
+      VirtualAir& air = VirtualAir::medium();
+      uint64_t timeout = RF69_LISTEN_TIMEOUT * 16 * 1000000ULL / radio.airBitrate;
+      while (radio._mode == RF69_MODE_LISTEN) {
+        air.wait(radio._listenIdleUs);
+        if (radio._mode != RF69_MODE_LISTEN) break;
+        air.listen(&radio, true);
+        bool carrier = air.rssiAt(&radio) > VIRTUAL_AIR_NOISE;
+        air.wait(radio._listenRxUs);
+        if (radio._mode != RF69_MODE_LISTEN) break;
+        if (carrier || air.rssiAt(&radio) > VIRTUAL_AIR_NOISE) {
+          uint64_t until = air.now() + timeout;
+          while (radio._mode == RF69_MODE_LISTEN && radio.PAYLOADLEN == 0 && air.now() < until) {
+            air.wait(VIRTUAL_AIR_POLL_US);
+          }
+          if (radio._mode == RF69_MODE_LISTEN && radio.PAYLOADLEN > 0) {
+            air.wake(radio._listenNode);
+          }
+        }
+        if (radio._mode == RF69_MODE_LISTEN) air.listen(&radio, false);
+      }
+      radio._listenCycling = false;
+    }
+
+    // as RFM69::waitForChannel()
+    bool waitForChannel() {
+      VirtualAir& air = VirtualAir::medium();
+      byte exponent = CSMA_MIN_BE;
+      for (byte busy = 0; busy <= CSMA_MAX_BACKOFFS; busy++) {
+        receivePoll();
+        unsigned long wait = (backoffRandom() & ((1 << exponent) - 1)) * (unsigned long) CSMA_SLOT_US;
+        unsigned long start = air.micros();
+        while (air.micros() - start < wait) receivePoll();
+        if (canSend()) return true;
+        stats.backoffs++;
+        if (exponent < CSMA_MAX_BE) exponent++;
+      }
+      stats.busy++;
+      return false;
+    }
+
+    word backoffRandom() {
+      _backoffSeed ^= _backoffSeed << 7;
+      _backoffSeed ^= _backoffSeed >> 9;
+      _backoffSeed ^= _backoffSeed << 8;
+      return _backoffSeed;
+    }
+
+    void receiveBegin() {
+      DATALEN = 0;
+      SENDERID = 0;
+      TARGETID = 0;
+      PAYLOADLEN = 0;
+      ACK_REQUESTED = 0;
+      ACK_RECEIVED = 0;
+      RSSI = 0;
+      setMode(RF69_MODE_RX);
+    }
+
+    void setMode(byte newMode) {
+      if (newMode == _mode) return;
+      _mode = newMode;
+      VirtualAir::medium().listen(this, newMode == RF69_MODE_RX);
+      if (_modeHook) _modeHook(_modeContext, newMode);
+    }
+};
+
+#endif
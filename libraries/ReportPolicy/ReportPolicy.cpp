@@ -0,0 +1,106 @@
+/*
+  ReportPolicy.cpp - Logic for adaptive report-on-change decisions
+  Created by Jon R. Brule, October 19, 2026.
+  Released into the public domain.
+*/
+#include "Arduino.h"
+#include "ReportPolicy.h"
+
+//-----------------------------------------------------------------------------
+ReportPolicy::ReportPolicy(byte fieldCount) {
+  _fieldCount = (fieldCount > REPORT_MAX_FIELDS) ? REPORT_MAX_FIELDS : fieldCount;
+  _signedFields = 0;
+  _heartbeat = DEFAULT_HEARTBEAT;
+  _alertHeartbeat = DEFAULT_ALERT_HEARTBEAT;
+  _alert = false;
+  _lastAlert = false;
+  for (byte i = 0; i < REPORT_MAX_FIELDS; i++) {
+    _deadbands[i] = DEADBAND_ANY_CHANGE;
+    _last[i] = 0;
+  }
+  force();
+}
+
+//-----------------------------------------------------------------------------
+// Sets how far a field may drift from its last reported value before a
+// report is due. Signed fields (e.g. temperatures below zero stored in a
+// byte) are compared as two's complement values.
+//
+void ReportPolicy::setDeadband(byte field, byte deadband, bool isSigned) {
+  if (field >= _fieldCount) return;
+  _deadbands[field] = deadband;
+  if (isSigned) {
+    _signedFields |= (1 << field);
+  } else {
+    _signedFields &= ~(1 << field);
+  }
+}
+
+//-----------------------------------------------------------------------------
+// Sets the longest run of measurement cycles without a report, normally and
+// while an alert is active. Zero means every cycle.
+//
+void ReportPolicy::setHeartbeat(byte cycles, byte alertCycles) {
+  _heartbeat = cycles;
+  _alertHeartbeat = alertCycles;
+}
+
+//-----------------------------------------------------------------------------
+// Called once per measurement cycle; returns true when the data must be
+// reported, either because a field left its deadband, the alert state
+// changed, or the silence interval for the current state expired.
+//
+bool ReportPolicy::due(const byte* data, bool alert) {
+  if (_silence < 255) {
+    _silence++;
+  }
+  _alert = alert;
+  if (_forced || alert != _lastAlert) {
+    return true;
+  }
+  if (_silence >= (alert ? _alertHeartbeat : _heartbeat)) {
+    return true;
+  }
+  for (byte i = 0; i < _fieldCount; i++) {
+    if (crossed(i, data[i])) {
+      return true;
+    }
+  }
+  return false;
+}
+
+//-----------------------------------------------------------------------------
+// Records a delivered report as the new baseline. Only call this once the
+// report was acknowledged, so a lost report is retried on the next cycle.
+//
+void ReportPolicy::sent(const byte* data) {
+  memcpy(_last, data, _fieldCount);
+  _lastAlert = _alert;
+  _silence = 0;
+  _forced = false;
+}
+
+//-----------------------------------------------------------------------------
+// Makes the next due() call report regardless of the data.
+//
+void ReportPolicy::force() {
+  _forced = true;
+  _silence = 0;
+}
+
+//-----------------------------------------------------------------------------
+byte ReportPolicy::silence() {
+  return _silence;
+}
+
+//-----------------------------------------------------------------------------
+bool ReportPolicy::crossed(byte field, byte value) {
+  byte deadband = _deadbands[field];
+  if (deadband == DEADBAND_IGNORE) {
+    return false;
+  }
+  int delta = (_signedFields & (1 << field))
+              ? (int) (int8_t) value - (int) (int8_t) _last[field]
+              : (int) value - (int) _last[field];
+  return abs(delta) > deadband;
+}
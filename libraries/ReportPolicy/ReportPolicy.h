@@ -0,0 +1,42 @@
+/*
+  ReportPolicy.h - Library for adaptive report-on-change decisions.
+  Created by Jon R. Brule, October 19, 2026.
+  Released into the public domain.
+*/
+#ifndef ReportPolicy_h
+#define ReportPolicy_h
+
+#include "Arduino.h"
+
+#define REPORT_MAX_FIELDS     16
+#define DEADBAND_ANY_CHANGE   0     // report on every change of the field
+#define DEADBAND_IGNORE       255   // never report because of this field
+
+#define DEFAULT_HEARTBEAT         30  // measurement cycles of silence allowed
+#define DEFAULT_ALERT_HEARTBEAT   1   // ...while the door is open / alerting
+
+class ReportPolicy {
+  public:
+    ReportPolicy(byte fieldCount);
+    void setDeadband(byte field, byte deadband, bool isSigned = false);
+    void setHeartbeat(byte cycles, byte alertCycles);
+    bool due(const byte* data, bool alert);
+    void sent(const byte* data);
+    void force();
+    byte silence();
+  protected:
+    bool crossed(byte field, byte value);
+  private:
+    byte _fieldCount;
+    byte _deadbands[REPORT_MAX_FIELDS];
+    unsigned int _signedFields;
+    byte _last[REPORT_MAX_FIELDS];
+    byte _heartbeat;
+    byte _alertHeartbeat;
+    byte _silence;
+    bool _alert;
+    bool _lastAlert;
+    bool _forced;
+};
+
+#endif
@@ -0,0 +1,94 @@
+/* -----------------------------------------------------------------------------
+   Report Policy Trace Replay
+  
+   Replays a recorded freezer mote trace through a ReportPolicy and compares
+   the packets/day against the fixed-cadence loop of freezer_mote_v0_3.
+   
+   Send one measurement cycle per line over the serial port, as the decimal
+   SensorData fields in payload order:
+   
+     battery,tempInside,tempOutside,light,door
+     
+   and an empty line to print the summary. Temperatures may be negative.
+----------------------------------------------------------------------------- */
+#include <ReportPolicy.h>
+
+#define BAUD_RATE         57600
+#define FIELDS            5
+#define LINE_LENGTH       40
+
+#define LOOP_MULTIPLIER   10    // seconds slept per normal cycle
+#define ALERT_MULTIPLIER  2     // seconds slept per cycle while door is open
+
+ReportPolicy policy(FIELDS);
+
+char line[LINE_LENGTH];
+byte pos = 0;
+
+unsigned long cycles = 0;
+unsigned long seconds = 0;
+unsigned long reports = 0;
+
+void setup() {
+  Serial.begin(BAUD_RATE);
+  Serial.println("\n[trace replay]");
+  
+  policy.setDeadband(0, 2);           // battery
+  policy.setDeadband(1, 1, true);     // temperature inside
+  policy.setDeadband(2, 2, true);     // temperature outside
+  policy.setDeadband(3, 16);          // light
+  policy.setDeadband(4, DEADBAND_ANY_CHANGE);  // door
+  policy.setHeartbeat(30, 1);
+}
+
+void loop() {
+  if (Serial.available() <= 0) return;
+  char ch = Serial.read();
+  if (ch == '\r') return;
+  if (ch != '\n') {
+    if (pos < LINE_LENGTH - 1) {
+      line[pos++] = ch;
+      line[pos] = 0;
+    }
+    return;
+  }
+  if (pos == 0) {
+    summary();
+  } else {
+    replay(line);
+  }
+  pos = 0;
+}
+
+void replay(char* text) {
+  byte data[FIELDS];
+  memset(data, 0, sizeof(data));
+  char* token = strtok(text, ",");
+  for (byte i = 0; i < FIELDS && token != NULL; i++) {
+    data[i] = (byte) atoi(token);
+    token = strtok(NULL, ",");
+  }
+  
+  bool alert = data[4];
+  cycles++;
+  seconds += alert ? ALERT_MULTIPLIER : LOOP_MULTIPLIER;
+  if (policy.due(data, alert)) {
+    policy.sent(data);
+    reports++;
+  }
+}
+
+void summary() {
+  if (seconds == 0) return;
+  Serial.print("cycles=");
+  Serial.print(cycles);
+  Serial.print(" hours=");
+  Serial.print(seconds / 3600.0);
+  Serial.print(" fixed/day=");
+  Serial.print(cycles * 86400.0 / seconds);
+  Serial.print(" adaptive/day=");
+  Serial.print(reports * 86400.0 / seconds);
+  Serial.print(" reduction=");
+  Serial.print(100.0 - (100.0 * reports) / cycles);
+  Serial.println("%");
+}
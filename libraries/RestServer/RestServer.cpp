@@ -27,6 +27,11 @@
  * Definitions
  ******************************************************************************/
 
+//------------------------------------------------------------------------------
+static void write_no_handler(JsonObjectWriter &root, void *context) {
+  root.add(F("status"), F("NO HANDLER"));
+}
+
 /******************************************************************************
  * Constructors
  ******************************************************************************/
@@ -95,16 +100,44 @@ RestHandlerDef* RestServer::find_handler(RestRequest *request) {
 }	
 
 //------------------------------------------------------------------------------
-void RestServer::generate_header(EthernetClient *client, int code, char *contentType)
+void RestServer::generate_header(EthernetClient *client, int code, 
+                                 char *contentType, long contentLength)
 {
   client->print("HTTP/1.1 ");
   client->print(code);
   client->println(" OK");
   client->print("Content-Type: ");
   client->println(contentType);
+  if (contentLength >= 0) {
+    client->print("Content-Length: ");
+    client->println(contentLength);
+  }
   client->println();
 }
 
+//------------------------------------------------------------------------------
+//
+// Streams a JSON object response straight to the client. The body is first
+// written to a NullPrint to learn its length, so nothing is buffered.
+//
+void RestServer::generate_json(EthernetClient *client, 
+                               restJsonBody body, 
+                               void *context, 
+                               int code)
+{
+  NullPrint counter;
+  JsonWriter sizing(counter);
+  {
+    JsonObjectWriter root(sizing);
+    body(root, context);
+  }
+  generate_header(client, code, TYPE_APPLICATION_JSON, sizing.count());
+  
+  JsonWriter json(*client);
+  JsonObjectWriter root(json);
+  body(root, context);
+}
+
 //------------------------------------------------------------------------------
 void RestServer::generate_response(EthernetClient *client, 
                                    char * content, 
@@ -125,10 +158,7 @@ void RestServer::handle_request(RestRequest *request, EthernetClient *client) {
   if (handler != NULL) {
     handler->handler(request, client);
   } else {
-    client->println("HTTP/1.1 404 OK");
-    client->println("Content-Type: application/json");
-    client->println();
-    client->println("{ \"status\": \"NO HANDLER\" }");
+    generate_json(client, write_no_handler, NULL, HTTP_NOT_FOUND);
   }
 
 }
@@ -24,6 +24,7 @@
 #include <inttypes.h>
 #include <Arduino.h>
 #include <Ethernet.h>
+#include <JsonWriter.h>
 
 #define BUFFER_SIZE 255
 #define MAX_HANDLERS 8
@@ -53,6 +54,11 @@ extern "C" {
   typedef void (*restHandler)(RestRequest *request, EthernetClient *client);
 }
 
+// Writes a JSON response body. It is called twice, once to count the bytes
+// for Content-Length and once to send them, so it must write the same both
+// times.
+typedef void (*restJsonBody)(JsonObjectWriter &root, void *context);
+
 struct RestHandlerDef {
   char* name;
   restHandler handler;
@@ -66,7 +72,12 @@ public:
   void begin();
   void generate_header(EthernetClient *client, 
                        int code = HTTP_OK, 
-                       char *contentType = TYPE_APPLICATION_JSON);
+                       char *contentType = TYPE_APPLICATION_JSON,
+                       long contentLength = -1);
+  void generate_json(EthernetClient *client,
+                     restJsonBody body,
+                     void *context = NULL,
+                     int code = HTTP_OK);
   void generate_response(EthernetClient *client, 
                          char *content = "",
                          int code = HTTP_OK, 
@@ -0,0 +1,305 @@
+/*
+  SleepManager.cpp - Logic for deadline-driven power-down sleep.
+  Created by Jon R. Brule, October 19, 2026.
+  Released into the public domain.
+*/
+#include "Arduino.h"
+#include <avr/wdt.h>
+#include <util/atomic.h>
+#include <LowPower.h>
+#include "SleepManager.h"
+
+#define SLEEP_LONGEST   SLEEP_8S
+#define SLEEP_CAL_US    64000UL   // nominal length of the calibration period
+
+extern volatile unsigned long timer0_millis;
+
+static volatile bool wakeFlag;
+static volatile byte intFired;
+
+//-----------------------------------------------------------------------------
+// A LOW level keeps firing while it lasts, so each handler disarms itself.
+//
+static void wakeInt0() {
+  detachInterrupt(0);
+  intFired |= 1;
+  wakeFlag = true;
+}
+
+static void wakeInt1() {
+  detachInterrupt(1);
+  intFired |= 2;
+  wakeFlag = true;
+}
+
+bool SleepManager::_pinChange = false;
+
+//-----------------------------------------------------------------------------
+// Called by the pin-change vectors in SleepManagerPCINT.h, which also turn
+// on edge wakes before setup() runs.
+//
+void SleepManager::pinChanged() {
+  wakeFlag = true;
+}
+
+void SleepManager::usePinChange() {
+  _pinChange = true;
+}
+
+//-----------------------------------------------------------------------------
+SleepManager::SleepManager() {
+  _pinCount = 0;
+  _radio = NULL;
+  _radioSleep = NULL;
+  _shortest = SLEEP_15Ms;
+  _scale = 1024;
+  _calibrateEvery = SLEEP_CALIBRATE_EVERY;
+  _sinceCalibration = 0;
+  _awakeMicroamps = SLEEP_AWAKE_UA;
+  _asleepMicroamps = SLEEP_ASLEEP_UA;
+  resetLog();
+}
+
+//-----------------------------------------------------------------------------
+void SleepManager::begin() {
+  calibrate();
+  resetLog();
+}
+
+//-----------------------------------------------------------------------------
+// Adds a pin that ends the sleep early. LOW uses INT0/INT1 where the pin has
+// one; RISING, FALLING and CHANGE use pin change interrupts, since INT0/INT1
+// only see levels in power down, and are refused unless the sketch includes
+// SleepManagerPCINT.h. Levels are compared once the oscillator
+// has started again, so an edge that is undone within about a millisecond
+// (e.g. switch bounce) does not end the sleep.
+//
+bool SleepManager::wakeOn(byte pin, byte mode) {
+  if (_pinCount >= SLEEP_MAX_WAKE_PINS) {
+    return false;
+  }
+  _pins[_pinCount] = pin;
+  _modes[_pinCount] = mode;
+  if (interruptFor(_pinCount) < 0 && (!_pinChange || digitalPinToPCICR(pin) == 0)) {
+    return false;
+  }
+  _pinCount++;
+  return true;
+}
+
+//-----------------------------------------------------------------------------
+// Sleeps for up to ms milliseconds, returning early with the pin that woke
+// us, or SLEEP_TIMEOUT. The time is split into the longest watchdog periods
+// that fit, so that no deadline is overslept; less than the shortest period
+// may be left over. Each wake-up costs an oscillator start-up, so callers
+// that can tolerate an early return should raise the shortest period with
+// setShortest(). millis() is advanced by the time asleep (micros() is not).
+//
+byte SleepManager::sleepFor(unsigned long ms) {
+  _awake += millis() - _wokeAt;
+  if (_radioSleep != NULL) {
+    _radioSleep(_radio);
+  }
+  if (_calibrateEvery > 0 && ++_sinceCalibration >= _calibrateEvery) {
+    calibrate();
+  }
+
+  arm();
+  byte woke = SLEEP_TIMEOUT;
+  unsigned long slept = 0;
+  byte period = SLEEP_LONGEST;
+  while (woke == SLEEP_TIMEOUT) {
+    while (period > _shortest && periodMillis(period) > ms - slept) {
+      period--;
+    }
+    unsigned long length = periodMillis(period);
+    if (length > ms - slept) {
+      break;
+    }
+    if (!wakeFlag) {
+      LowPower.powerDown((period_t) period, ADC_OFF, BOD_OFF);
+    }
+    if (wakeFlag) {
+      // interrupted at an unknown point; assume half the period passed
+      slept += length / 2;
+      woke = woken();
+    } else {
+      slept += length;
+      _wakeups++;
+    }
+  }
+  disarm();
+
+  ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+    timer0_millis += slept;
+  }
+  _asleep += slept;
+  _wokeAt = millis();
+  if (woke != SLEEP_TIMEOUT) {
+    _pinWakes++;
+  }
+  return woke;
+}
+
+//-----------------------------------------------------------------------------
+byte SleepManager::sleepUntil(unsigned long deadline) {
+  long left = (long) (deadline - millis());
+  return (left > 0) ? sleepFor(left) : SLEEP_TIMEOUT;
+}
+
+//-----------------------------------------------------------------------------
+// Times one watchdog period against the crystal, which keeps millis() and
+// micros() honest while awake. The watchdog oscillator is only good to 10%
+// or so and moves with temperature and supply voltage, so this repeats
+// every few hundred sleeps. Returns the rate in 1/1024ths of nominal.
+//
+unsigned int SleepManager::calibrate() {
+  unsigned long start, elapsed;
+  
+  _sinceCalibration = 0;
+  ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+    wdt_reset();
+    wdt_enable(WDTO_60MS);
+    WDTCSR |= (1 << WDIE);
+  }
+  start = micros();
+  do {
+    elapsed = micros() - start;
+  } while ((WDTCSR & (1 << WDIE)) && elapsed < 4 * SLEEP_CAL_US);
+  
+  // the interrupt clears WDIE, and LowPower's handler stops the watchdog
+  if (WDTCSR & (1 << WDIE)) {
+    wdt_disable();
+    return _scale;
+  }
+  _scale = (elapsed * 1024 + SLEEP_CAL_US / 2) / SLEEP_CAL_US;
+  return _scale;
+}
+
+//-----------------------------------------------------------------------------
+void SleepManager::setCurrents(unsigned int awakeMicroamps, unsigned int asleepMicroamps) {
+  _awakeMicroamps = awakeMicroamps;
+  _asleepMicroamps = asleepMicroamps;
+}
+
+//-----------------------------------------------------------------------------
+// Estimated from the duty cycle and the currents given to setCurrents(),
+// not measured. The oscillator start-up after each wake-up is spent before
+// millis() runs again, so it is added to the awake time here.
+//
+float SleepManager::averageMicroamps() {
+  float awake = awakeMillis() + (_wakeups + _pinWakes) * (SLEEP_STARTUP_US / 1000.0);
+  float total = awake + _asleep;
+  if (total == 0) {
+    return 0;
+  }
+  return (awake * _awakeMicroamps + (float) _asleep * _asleepMicroamps) / total;
+}
+
+//-----------------------------------------------------------------------------
+void SleepManager::printLog(Print& out) {
+  unsigned long awake = awakeMillis();
+  out.print("awake ");
+  out.print(awake);
+  out.print("ms, asleep ");
+  out.print(_asleep);
+  out.print("ms (");
+  out.print(100.0 * awake / (awake + _asleep + 1), 2);
+  out.print("% duty), wakes ");
+  out.print(_wakeups);
+  out.print(" wdt / ");
+  out.print(_pinWakes);
+  out.print(" pin, wdt scale ");
+  out.print(_scale);
+  out.print(", est. ");
+  out.print(averageMicroamps(), 1);
+  out.println("uA avg");
+}
+
+//-----------------------------------------------------------------------------
+void SleepManager::resetLog() {
+  _awake = 0;
+  _asleep = 0;
+  _wakeups = 0;
+  _pinWakes = 0;
+  _wokeAt = millis();
+}
+
+//-----------------------------------------------------------------------------
+unsigned long SleepManager::periodMillis(byte period) {
+  return ((16UL << period) * _scale) >> 10;
+}
+
+//-----------------------------------------------------------------------------
+// Returns the external interrupt used for wake pin i, or -1 for pin change.
+//
+char SleepManager::interruptFor(byte i) {
+  if (_modes[i] != LOW) {
+    return -1;
+  }
+  byte n = digitalPinToInterrupt(_pins[i]);
+  return (n < 2) ? n : -1;
+}
+
+//-----------------------------------------------------------------------------
+void SleepManager::arm() {
+  wakeFlag = false;
+  intFired = 0;
+  for (byte i = 0; i < _pinCount; i++) {
+    byte pin = _pins[i];
+    char n = interruptFor(i);
+    _levels[i] = digitalRead(pin);
+    if (n >= 0) {
+      attachInterrupt(n, n ? wakeInt1 : wakeInt0, LOW);
+    } else {
+      *digitalPinToPCMSK(pin) |= bit(digitalPinToPCMSKbit(pin));
+      PCIFR = bit(digitalPinToPCICRbit(pin));
+      PCICR |= bit(digitalPinToPCICRbit(pin));
+    }
+  }
+}
+
+//-----------------------------------------------------------------------------
+void SleepManager::disarm() {
+  for (byte i = 0; i < _pinCount; i++) {
+    byte pin = _pins[i];
+    char n = interruptFor(i);
+    if (n >= 0) {
+      detachInterrupt(n);
+    } else {
+      *digitalPinToPCMSK(pin) &= ~bit(digitalPinToPCMSKbit(pin));
+      if (*digitalPinToPCMSK(pin) == 0) {
+        PCICR &= ~bit(digitalPinToPCICRbit(pin));
+      }
+    }
+  }
+}
+
+//-----------------------------------------------------------------------------
+// Finds the wake pin whose condition holds, or returns SLEEP_TIMEOUT when
+// the interrupt came from a change that was not asked for.
+//
+byte SleepManager::woken() {
+  wakeFlag = false;
+  for (byte i = 0; i < _pinCount; i++) {
+    byte level = digitalRead(_pins[i]);
+    char n = interruptFor(i);
+    bool hit;
+    if (n >= 0) {
+      hit = intFired & (1 << n);
+    } else if (_modes[i] == CHANGE) {
+      hit = level != _levels[i];
+    } else if (_modes[i] == RISING) {
+      hit = level && !_levels[i];
+    } else if (_modes[i] == FALLING) {
+      hit = !level && _levels[i];
+    } else {
+      hit = !level;
+    }
+    _levels[i] = level;
+    if (hit) {
+      return _pins[i];
+    }
+  }
+  return SLEEP_TIMEOUT;
+}
@@ -0,0 +1,95 @@
+/*
+  SleepManager.h - Library for deadline-driven power-down sleep.
+  Created by Jon R. Brule, October 19, 2026.
+  Released into the public domain.
+
+  Sleeps until a deadline in the fewest watchdog periods that fit, scaled
+  by a measured watchdog rate so the deadline is not overslept, and moves
+  millis() forward by the time spent asleep. Wake pins are armed only for
+  the duration of the sleep: LOW levels go through INT0/INT1, and edges
+  through pin-change interrupts, which wake the chip from power down. The
+  pin-change vectors are only defined by SleepManagerPCINT.h, so a sketch
+  that wants edge wakes includes it once, and one whose other libraries
+  (e.g. SoftwareSerial) own those vectors leaves it out. An
+  attached radio is put to sleep first. The awake/asleep split is kept as a
+  duty-cycle log for estimating the average supply current.
+*/
+#ifndef SleepManager_h
+#define SleepManager_h
+
+#include "Arduino.h"
+
+#define SLEEP_MAX_WAKE_PINS     4
+#define SLEEP_TIMEOUT           0xFF    // sleepFor() result when no pin woke us
+#define SLEEP_CALIBRATE_EVERY   256     // sleeps between watchdog calibrations
+
+// Typical Moteino figures: awake at 16MHz with the radio in standby, and
+// powered down with the watchdog running and the radio asleep. Measure
+// your own board and pass the results to setCurrents().
+#define SLEEP_AWAKE_UA          7000
+#define SLEEP_ASLEEP_UA         7
+#define SLEEP_STARTUP_US        1000    // 16K CK oscillator start-up at 16MHz
+
+class SleepManager {
+  public:
+    SleepManager();
+    void begin();
+    bool wakeOn(byte pin, byte mode);
+    template <class Radio> void setRadio(Radio& radio);
+    byte sleepFor(unsigned long ms);
+    byte sleepUntil(unsigned long deadline);
+    unsigned int calibrate();
+    inline void setCalibration(unsigned int sleeps) { _calibrateEvery = sleeps; }
+    inline void setShortest(byte period) { _shortest = period; }
+    inline unsigned int watchdogScale() { return _scale; }
+    void setCurrents(unsigned int awakeMicroamps, unsigned int asleepMicroamps);
+    inline unsigned long awakeMillis() { return _awake + (millis() - _wokeAt); }
+    inline unsigned long asleepMillis() { return _asleep; }
+    inline unsigned long watchdogWakes() { return _wakeups; }
+    inline unsigned int pinWakes() { return _pinWakes; }
+    float averageMicroamps();
+    void printLog(Print& out);
+    void resetLog();
+    static void usePinChange();   // called by SleepManagerPCINT.h
+    static void pinChanged();
+  protected:
+    unsigned long periodMillis(byte period);
+    void arm();
+    void disarm();
+    byte woken();
+    char interruptFor(byte i);
+  private:
+    static bool _pinChange;
+    template <class Radio> static void sleepRadio(void* radio);
+    byte _pins[SLEEP_MAX_WAKE_PINS];
+    byte _modes[SLEEP_MAX_WAKE_PINS];
+    byte _levels[SLEEP_MAX_WAKE_PINS];
+    byte _pinCount;
+    void* _radio;
+    void (*_radioSleep)(void*);
+    byte _shortest;
+    unsigned int _scale;
+    unsigned int _calibrateEvery;
+    unsigned int _sinceCalibration;
+    unsigned int _awakeMicroamps;
+    unsigned int _asleepMicroamps;
+    unsigned long _awake;
+    unsigned long _asleep;
+    unsigned long _wokeAt;
+    unsigned long _wakeups;
+    unsigned int _pinWakes;
+};
+
+//-----------------------------------------------------------------------------
+// Any radio with a sleep() method, such as RFM69.
+//
+template <class Radio> void SleepManager::setRadio(Radio& radio) {
+  _radio = &radio;
+  _radioSleep = &sleepRadio<Radio>;
+}
+
+template <class Radio> void SleepManager::sleepRadio(void* radio) {
+  ((Radio*) radio)->sleep();
+}
+
+#endif
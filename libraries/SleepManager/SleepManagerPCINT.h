@@ -0,0 +1,32 @@
+/*
+  SleepManagerPCINT.h - Pin change wakes for SleepManager.
+  Created by Jon R. Brule, October 19, 2026.
+  Released into the public domain.
+
+  Defines the PCINT0..2 interrupt vectors for SleepManager, which then
+  takes RISING, FALLING and CHANGE in wakeOn(). Include it once, in the
+  sketch, after SleepManager.h. Leave it out when another library (e.g.
+  SoftwareSerial) defines those vectors, or the link fails with duplicate
+  vectors; only LOW on the INT0/INT1 pins can wake the sketch then.
+*/
+#ifndef SleepManagerPCINT_h
+#define SleepManagerPCINT_h
+
+#include "SleepManager.h"
+
+ISR(PCINT0_vect) {
+  SleepManager::pinChanged();
+}
+#ifdef PCINT1_vect
+ISR(PCINT1_vect, ISR_ALIASOF(PCINT0_vect));
+#endif
+#ifdef PCINT2_vect
+ISR(PCINT2_vect, ISR_ALIASOF(PCINT0_vect));
+#endif
+
+// enables the edge modes before setup() calls wakeOn()
+static struct SleepManagerPCINT {
+  SleepManagerPCINT() { SleepManager::usePinChange(); }
+} sleepManagerPCINT;
+
+#endif
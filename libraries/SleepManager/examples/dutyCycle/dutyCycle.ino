@@ -0,0 +1,52 @@
+/* -----------------------------------------------------------------------------
+   Sleep Manager Duty Cycle
+  
+   Wakes every 10 seconds, or whenever the button on D3 changes, blinks the
+   LED, and prints the duty-cycle log with the estimated average current.
+   millis() keeps counting across the sleeps, so the schedule holds even
+   though timer0 stops in power down.
+  
+   Circuit:
+   * Moteino w/ RFM69 radio
+   * D3  - Button to ground (internal pullup)
+   * D9  - LED
+----------------------------------------------------------------------------- */
+#include <LowPower.h>
+#include <RFM69.h>
+#include <SPI.h>
+#include <SleepManager.h>
+#include <SleepManagerPCINT.h>
+
+#define BAUD_RATE   57600
+#define BUTTON_PIN  3
+#define LED_PIN     9
+#define PERIOD_MS   10000
+
+RFM69 radio;
+SleepManager sleeper;
+unsigned long deadline;
+
+void setup() {
+  Serial.begin(BAUD_RATE);
+  pinMode(BUTTON_PIN, INPUT_PULLUP);
+  pinMode(LED_PIN, OUTPUT);
+  radio.initialize(RF69_915MHZ, 99, 99);
+  
+  sleeper.setRadio(radio);
+  sleeper.wakeOn(BUTTON_PIN, CHANGE);
+  sleeper.begin();
+  deadline = millis() + PERIOD_MS;
+}
+
+void loop() {
+  digitalWrite(LED_PIN, HIGH);
+  delay(20);
+  digitalWrite(LED_PIN, LOW);
+  
+  sleeper.printLog(Serial);
+  Serial.flush();
+  
+  if (sleeper.sleepUntil(deadline) == SLEEP_TIMEOUT) {
+    deadline += PERIOD_MS;
+  }
+}
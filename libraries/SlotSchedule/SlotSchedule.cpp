@@ -0,0 +1,358 @@
+/*
+  SlotSchedule.cpp - Logic for gateway-coordinated slotted reporting.
+  Created by Jon R. Brule, October 19, 2026.
+  Released into the public domain.
+*/
+#include "Arduino.h"
+#include "SlotSchedule.h"
+
+//-----------------------------------------------------------------------------
+SlotSchedule::SlotSchedule(RFM69& radio) : _radio(radio) {
+  _gateway = 0;
+  _slot = SLOT_NONE;
+  _phase = 0;
+  _period = 1;
+  _misses = 0;
+  _wait = 0;
+  _superframe = 0;
+  _frameAt = 0;
+  _syncedAt = 0;
+  _cellAt = 0;
+  _slotAt = 0;
+  _cellCount = 0;
+  _random = 1;
+  memset(&stats, 0, sizeof(stats));
+}
+
+//-----------------------------------------------------------------------------
+// Gateways: starts the first superframe now, with no cells handed out.
+//
+void SlotSchedule::begin() {
+  _cellCount = 0;
+  _superframe = 0;
+  _frameAt = millis();
+}
+
+//-----------------------------------------------------------------------------
+// Gateways: broadcasts the beacon once a superframe has begun. Call as
+// often as possible; a beacon more than half a slot late is left out, as
+// it would land on the first slot's report.
+//
+void SlotSchedule::poll() {
+  unsigned long late = millis() - _frameAt;
+  if (late < SLOT_FRAME_MS) {
+    return;
+  }
+  unsigned long frames = late / SLOT_FRAME_MS;
+  _frameAt += frames * SLOT_FRAME_MS;
+  _superframe += frames;
+  late -= frames * SLOT_FRAME_MS;
+  if (late > SLOT_MS / 2) {
+    stats.missed++;
+    return;
+  }
+  SlotBeacon beacon;
+  beacon.kind = SLOT_BEACON;
+  beacon.late = late;
+  beacon.superframe = _superframe;
+  _radio.send(RF69_BROADCAST_ADDR, &beacon, sizeof(beacon));
+  stats.beacons++;
+}
+
+//-----------------------------------------------------------------------------
+// Gateways: call with each frame received. Answers a slot request in its
+// ACK and returns true; any other frame only marks its sender as heard.
+//
+boolean SlotSchedule::receive() {
+  byte node = _radio.SENDERID;
+  const SlotRequest* request = (const SlotRequest*) _radio.DATA;
+  if (_radio.DATALEN != sizeof(SlotRequest) || request->kind != SLOT_REQUEST) {
+    touch(node);
+    return false;
+  }
+  byte period = 1;
+  while (period < request->period && period < SLOT_MAX_PERIOD) {
+    period <<= 1;
+  }
+  SlotGrant grant;
+  grant.kind = SLOT_GRANT;
+  Cell* cell = assign(node, period);
+  if (cell) {
+    grant.slot = cell->slot;
+    grant.phase = cell->phase;
+    stats.granted++;
+  } else {
+    grant.slot = SLOT_NONE;
+    grant.phase = 0;
+    stats.refused++;
+  }
+  grant.period = period;
+  if (_radio.ACK_REQUESTED) {
+    grant.superframe = _superframe;
+    grant.elapsed = millis() - _frameAt;
+    _radio.sendACK(&grant, sizeof(grant));
+  }
+  return true;
+}
+
+//-----------------------------------------------------------------------------
+// Motes: our node ID, the gateway to report to, and the report interval in
+// ms, which is rounded down to a whole period (see interval()).
+//
+void SlotSchedule::begin(byte node, byte gateway, unsigned long interval) {
+  _gateway = gateway;
+  _random = 0x0100 | node;
+  _slot = SLOT_NONE;
+  _wait = 0;
+  setInterval(interval);
+}
+
+//-----------------------------------------------------------------------------
+// Motes: a new report interval; a cell of another period is given up.
+//
+void SlotSchedule::setInterval(unsigned long interval) {
+  byte period = 1;
+  while (period < SLOT_MAX_PERIOD && 2 * period * SLOT_FRAME_MS <= interval) {
+    period <<= 1;
+  }
+  if (period != _period) {
+    _period = period;
+    _slot = SLOT_NONE;
+    _wait = 0;
+  }
+}
+
+//-----------------------------------------------------------------------------
+// Motes: ms from now until the mote should wake for its next cell, lead ms
+// ahead of listening for that superframe's beacon, e.g. to take readings
+// first. 0 without a cell.
+//
+unsigned long SlotSchedule::untilCell(unsigned int lead) {
+  if (!assigned()) {
+    return 0;
+  }
+  unsigned long now = millis();
+  unsigned long frames = (now - _frameAt) / SLOT_FRAME_MS + 1;
+  frames += (_phase - (_superframe + frames)) & (_period - 1);
+  while (true) {
+    _cellAt = _frameAt + frames * SLOT_FRAME_MS;
+    unsigned long wake = _cellAt - guard(_cellAt) - lead;
+    if ((long) (wake - now) >= 0) {
+      return wake - now;
+    }
+    frames += _period;
+  }
+}
+
+//-----------------------------------------------------------------------------
+// Motes: listens for the beacon of the superframe untilCell() woke us for,
+// and returns true if it came, in which case untilSlot() tells how long to
+// sleep before send() reports in our slot. Returns false at once if that
+// superframe is not about to begin, e.g. after a wake on a pin. The radio
+// is left asleep.
+//
+boolean SlotSchedule::sync() {
+  _slotAt = 0;
+  if (!assigned()) {
+    return false;
+  }
+  unsigned long now = millis();
+  unsigned long window = guard(_cellAt);
+  if ((long) (_cellAt - now) > (long) window + SLOT_MS || (long) (now - _cellAt) > (long) window) {
+    return false;
+  }
+  unsigned long deadline = _cellAt + window + SLOT_MS / 2 + SLOT_AIR_MS;
+  boolean heard = false;
+  while (!heard && (long) (millis() - deadline) < 0) {
+    if (!_radio.receiveDone()) {
+      continue;
+    }
+    const SlotBeacon* beacon = (const SlotBeacon*) _radio.DATA;
+    if (_radio.SENDERID != _gateway || _radio.DATALEN != sizeof(SlotBeacon) || beacon->kind != SLOT_BEACON) {
+      continue;
+    }
+    uint16_t expected = _superframe + (_cellAt - _frameAt) / SLOT_FRAME_MS;
+    _frameAt = millis() - beacon->late - SLOT_AIR_MS;
+    _superframe = beacon->superframe;
+    _syncedAt = _frameAt;
+    stats.beacons++;
+    if (_superframe != expected) {
+      // the gateway restarted, or we slipped a superframe: ask again
+      _slot = SLOT_NONE;
+      _wait = 0;
+      break;
+    }
+    heard = true;
+  }
+  _radio.sleep();
+  if (!heard) {
+    stats.missed += assigned();
+    return false;
+  }
+  _slotAt = _frameAt + _slot * SLOT_MS + SLOT_TX_OFFSET_MS;
+  return true;
+}
+
+//-----------------------------------------------------------------------------
+// Motes: ms from now until our slot, after sync(); or with contention, until
+// a random point in the next contention slots, for an alert. 0 when there is
+// no slot to wait for, or our clock may be off by a quarter superframe.
+//
+unsigned long SlotSchedule::untilSlot(boolean contention) {
+  unsigned long now = millis();
+  if (!contention) {
+    return (_slotAt && (long) (_slotAt - now) > 0) ? _slotAt - now : 0;
+  }
+  if (!assigned() || guard(now) > SLOT_FRAME_MS / 4) {
+    return 0;
+  }
+  unsigned long into = (now - _frameAt) % SLOT_FRAME_MS;
+  unsigned long at = (SLOT_COUNT - SLOT_CONTENTION) * SLOT_MS + jitter((SLOT_CONTENTION - 1) * SLOT_MS);
+  return (at >= into) ? at - into : SLOT_FRAME_MS - into + at;
+}
+
+//-----------------------------------------------------------------------------
+// Motes: sends a report to the gateway, in our slot if sync() found it and
+// it has not passed, otherwise at once. A slotted report gets one retry, so
+// as not to run into the next slot. A mote without a cell asks for one
+// first, every SLOT_REQUEST_EVERY reports. The ACK payload is left in the
+// radio's DATA, as after sendWithRetry().
+//
+boolean SlotSchedule::send(const void* buffer, byte size) {
+  if (!assigned() && _wait-- == 0) {
+    request();
+  }
+  unsigned long at = _slotAt;
+  _slotAt = 0;
+  if (at && (long) (millis() - at) < SLOT_MS / 4) {
+    if ((long) (at - millis()) > 0) {
+      delay(at - millis());
+    }
+    if (_radio.sendWithRetry(_gateway, buffer, size, 1, SLOT_RETRY_MS)) {
+      _misses = 0;
+      stats.slotted++;
+      return true;
+    }
+    if (++_misses >= SLOT_MISSES) {
+      _slot = SLOT_NONE;
+      _wait = 0;
+    }
+  }
+  stats.unslotted++;
+  return _radio.sendWithRetry(_gateway, buffer, size);
+}
+
+//-----------------------------------------------------------------------------
+// Asks the gateway for a cell, and takes the superframe timing from its
+// answer.
+//
+void SlotSchedule::request() {
+  SlotRequest request;
+  request.kind = SLOT_REQUEST;
+  request.period = _period;
+  _wait = SLOT_REQUEST_EVERY;
+  if (!_radio.sendWithRetry(_gateway, &request, sizeof(request))) {
+    _wait = 0;
+    return;
+  }
+  const SlotGrant* grant = (const SlotGrant*) _radio.DATA;
+  if (_radio.DATALEN != sizeof(SlotGrant) || grant->kind != SLOT_GRANT || grant->slot == SLOT_NONE) {
+    return;                             // no cells at this gateway, or none free
+  }
+  _slot = grant->slot;
+  _phase = grant->phase;
+  _period = grant->period;
+  _superframe = grant->superframe;
+  _frameAt = millis() - grant->elapsed - SLOT_AIR_MS;
+  _syncedAt = _frameAt;
+  _misses = 0;
+  stats.granted++;
+}
+
+//-----------------------------------------------------------------------------
+// How early to listen for a beacon due at the given time: as far as our
+// clock may have drifted since we last heard one, but never more than half
+// a superframe, which finds the next beacon wherever it is.
+//
+unsigned long SlotSchedule::guard(unsigned long at) {
+  unsigned long window = SLOT_GUARD_MS + ((at - _syncedAt) >> SLOT_DRIFT_SHIFT);
+  return (window < SLOT_FRAME_MS / 2) ? window : SLOT_FRAME_MS / 2;
+}
+
+//-----------------------------------------------------------------------------
+// Gives a mote the first free cell of its period, in place of the one it
+// had, and puts it first in the table. Out of entries, the mote heard from
+// least recently loses its cell. NULL if no cell is free.
+//
+SlotSchedule::Cell* SlotSchedule::assign(byte node, byte period) {
+  release(node);
+  if (_cellCount == SLOT_NODES) {
+    _cellCount--;
+  }
+  for (byte phase = 0; phase < period; phase++) {
+    for (byte slot = 1; slot < SLOT_COUNT - SLOT_CONTENTION; slot++) {
+      if (taken(slot, phase, period)) {
+        continue;
+      }
+      memmove(&_cells[1], &_cells[0], _cellCount * sizeof(Cell));
+      _cellCount++;
+      _cells[0].node = node;
+      _cells[0].slot = slot;
+      _cells[0].phase = phase;
+      _cells[0].period = period;
+      return &_cells[0];
+    }
+  }
+  return NULL;
+}
+
+//-----------------------------------------------------------------------------
+// Whether a cell overlaps one handed out: periods are powers of two, so two
+// cells in a slot meet unless their phases differ modulo the shorter period.
+//
+boolean SlotSchedule::taken(byte slot, byte phase, byte period) {
+  for (byte i = 0; i < _cellCount; i++) {
+    const Cell& cell = _cells[i];
+    byte shorter = (cell.period < period) ? cell.period : period;
+    if (cell.slot == slot && ((cell.phase ^ phase) & (shorter - 1)) == 0) {
+      return true;
+    }
+  }
+  return false;
+}
+
+//-----------------------------------------------------------------------------
+void SlotSchedule::release(byte node) {
+  for (byte i = 0; i < _cellCount; i++) {
+    if (_cells[i].node == node) {
+      _cellCount--;
+      memmove(&_cells[i], &_cells[i + 1], (_cellCount - i) * sizeof(Cell));
+      return;
+    }
+  }
+}
+
+//-----------------------------------------------------------------------------
+// Moves a mote with a cell to the front of the table.
+//
+void SlotSchedule::touch(byte node) {
+  for (byte i = 1; i < _cellCount; i++) {
+    if (_cells[i].node == node) {
+      Cell cell = _cells[i];
+      memmove(&_cells[1], &_cells[0], i * sizeof(Cell));
+      _cells[0] = cell;
+      return;
+    }
+  }
+}
+
+//-----------------------------------------------------------------------------
+// A pseudo-random number below range, to spread alerts over the contention
+// slots.
+//
+word SlotSchedule::jitter(word range) {
+  _random ^= _random << 7;
+  _random ^= _random >> 9;
+  _random ^= _random << 8;
+  return _random % range;
+}
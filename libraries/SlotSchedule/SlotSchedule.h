@@ -0,0 +1,140 @@
+/*
+  SlotSchedule.h - Library for gateway-coordinated slotted reporting.
+  Created by Jon R. Brule, October 19, 2026.
+  Released into the public domain.
+
+  TDMA for motes that report on a fixed period, so that their reports stop
+  drifting into each other. The gateway divides time into superframes of
+  SLOT_COUNT slots of SLOT_MS and broadcasts a beacon with the superframe
+  number at the start of each. The slots after the beacon's are handed out
+  to motes; the last SLOT_CONTENTION are open to all, for alerts, slot
+  requests and anything else off the schedule.
+
+  A mote's period is a power of two of superframes, the longest that fits
+  its report interval, and it gets a cell: one slot in every period-th
+  superframe. Cells of different periods share a slot when their phases
+  differ, so a slot carries one mote every superframe or, say, eight motes
+  reporting every eighth. A mote asks for its cell with a SlotRequest in
+  place of a report, which the gateway answers in the ACK (SlotGrant),
+  along with where it is in the superframe. Before each report in its cell
+  the mote wakes just ahead of that superframe's beacon, listening for no
+  longer than its clock may have drifted since the last one it heard (see
+  SLOT_DRIFT_SHIFT), and then sleeps until its slot. A mote that misses the
+  beacon, or its slot SLOT_MISSES times running, reports at once as before
+  and asks for a new cell in time.
+
+  A gateway keeps cells for SLOT_NODES motes and gives the cell of the one
+  heard from least recently to a new mote when they run out. Without a
+  SlotSchedule, a gateway ACKs a request with its usual payload, and the
+  mote carries on unslotted, asking again every SLOT_REQUEST_EVERY reports.
+*/
+#ifndef SlotSchedule_h
+#define SlotSchedule_h
+
+#include "Arduino.h"
+#include <RFM69.h>
+
+#define SLOT_MS              50       // one report, its ACK and a retry
+#define SLOT_COUNT           20       // slots per superframe, the beacon's first...
+#define SLOT_CONTENTION      4        // ...and these last ones open to all
+#define SLOT_FRAME_MS        ((unsigned long) SLOT_MS * SLOT_COUNT)
+#define SLOT_MAX_PERIOD      128      // most superframes between a mote's cells
+#define SLOT_NODES           48       // motes a gateway keeps cells for
+#define SLOT_GUARD_MS        4        // a mote listens this long before the beacon is due...
+#define SLOT_DRIFT_SHIFT     9        // ...and 1/512 of the time since it last heard one
+#define SLOT_TX_OFFSET_MS    2        // a mote sends this far into its slot
+#define SLOT_RETRY_MS        20       // ACK wait in a slot, leaving room for one retry
+#define SLOT_MISSES          3        // slotted reports lost in a row before asking again
+#define SLOT_REQUEST_EVERY   32       // reports between requests while there is no cell
+#define SLOT_AIR_MS          3        // a beacon or ACK's airtime, to its arrival
+
+#define SLOT_BEACON          0xB1     // kinds of frame, the first byte
+#define SLOT_REQUEST         0xB2
+#define SLOT_GRANT           0xB3
+
+#define SLOT_NONE            0xFF     // SlotGrant.slot when no cell was free
+
+typedef struct {
+  byte kind;
+  byte late;            // ms it went out after the superframe began
+  uint16_t superframe;
+} SlotBeacon;
+
+typedef struct {
+  byte kind;
+  byte period;          // superframes between the mote's reports
+} SlotRequest;
+
+typedef struct {
+  byte kind;
+  byte slot;            // slot in the superframe, or SLOT_NONE
+  byte phase;           // the cell's superframes are those equal to phase...
+  byte period;          // ...modulo period
+  uint16_t superframe;  // the gateway's current superframe...
+  uint16_t elapsed;     // ...and ms into it when the ACK went out
+} SlotGrant;
+
+typedef struct {
+  unsigned int beacons;   // sent by a gateway; heard by a mote
+  unsigned int missed;    // beacons a gateway was too late for; a mote listened for in vain
+  unsigned int granted;   // cells granted
+  unsigned int refused;   // requests no cell was free for
+  unsigned int slotted;   // reports ACKed in their slot
+  unsigned int unslotted; // reports sent off the schedule
+} SlotStats;
+
+class SlotSchedule {
+  public:
+    SlotSchedule(RFM69& radio);
+
+    // gateways
+    void begin();
+    void poll();
+    boolean receive();
+
+    // motes
+    void begin(byte node, byte gateway, unsigned long interval);
+    void setInterval(unsigned long interval);
+    inline boolean assigned() { return _slot != SLOT_NONE; }
+    inline byte slot() { return _slot; }
+    inline unsigned long interval() { return _period * SLOT_FRAME_MS; }
+    unsigned long untilCell(unsigned int lead = 0);
+    boolean sync();
+    unsigned long untilSlot(boolean contention = false);
+    boolean send(const void* buffer, byte size);
+
+    SlotStats stats;
+  protected:
+    typedef struct {
+      byte node;
+      byte slot;
+      byte phase;
+      byte period;
+    } Cell;
+
+    Cell* assign(byte node, byte period);
+    boolean taken(byte slot, byte phase, byte period);
+    void release(byte node);
+    void touch(byte node);
+    void request();
+    unsigned long guard(unsigned long at);
+    word jitter(word range);
+  private:
+    RFM69& _radio;
+    byte _gateway;
+    byte _slot;
+    byte _phase;
+    byte _period;
+    byte _misses;
+    byte _wait;                     // reports until the next request
+    uint16_t _superframe;           // the superframe that began at _frameAt
+    unsigned long _frameAt;
+    unsigned long _syncedAt;        // start of the superframe whose beacon was last heard
+    unsigned long _cellAt;          // start of the superframe untilCell() woke us for
+    unsigned long _slotAt;          // when to send in our slot, once sync() heard the beacon
+    Cell _cells[SLOT_NODES];        // most recently heard first
+    byte _cellCount;
+    word _random;
+};
+
+#endif
@@ -0,0 +1,217 @@
+/* -----------------------------------------------------------------------------
+   SlotSchedule Slotted Reports
+
+   Runs a gateway and a fleet of periodic motes on the simulated medium,
+   every mote reporting every PERIOD_MS, and prints the reports delivered,
+   the retries they took, the frames lost to collisions and the time each
+   mote spent listening per report, first with the motes waking on their
+   own schedules as today and then slotted by SlotSchedule. The gateway
+   sits in the middle of the house and the motes are scattered over it; the
+   link RSSI between any two nodes follows a log-distance path loss, so
+   motes on opposite sides do not hear each other and carrier sense cannot
+   keep them apart. Each mote's watchdog runs up to DRIFT_PPM fast or slow,
+   so unslotted motes slide past each other, and slotted ones have to
+   resynchronize on the beacon.
+
+   Host only, on the simulated radios: make -C libraries/VirtualAir/host slottedReports
+----------------------------------------------------------------------------- */
+#include <Message.h>
+#include <RFM69.h>
+#include <SlotSchedule.h>
+#include <VirtualAir.h>
+
+#define BAUD_RATE     57600
+#define GATEWAY_ID    1
+#define NETWORK_ID    99
+#define FREQUENCY     RF69_915MHZ
+#define FIRST_MOTE    10       // node ID of the first mote
+#define MAX_MOTES     48
+#define PERIOD_MS     8000     // report interval of each mote
+#define RUN_MS        1800000UL
+#define DRIFT_PPM     1500     // watchdog error after calibration, either way
+#define SIDE_M        60       // the house is this many metres square
+#define RSSI_1M       -40      // link RSSI at 1m, RFM69W at full power
+#define PATH_LOSS     3.5      // path loss exponent, indoors through walls
+#define FADING_DB     4        // link RSSI jitter, either way
+#define SEED          42
+
+enum { UNSLOTTED, SLOTTED, MODE_END };
+const char* modeNames[] = { "unslotted", "slotted" };
+const byte fleetSizes[] = { 16, 32, 48 };
+
+VirtualAir& air = VirtualAir::medium();
+RFM69 gatewayRadio;
+SlotSchedule* gatewaySlots;
+RFM69 moteRadios[MAX_MOTES];
+SlotSchedule* moteSlots[MAX_MOTES];
+long drift[MAX_MOTES];         // ppm
+
+byte mode;
+unsigned long offered;
+unsigned long delivered;
+uint32_t lastSeq[MAX_MOTES];
+
+//------------------------------------------------------------------------------
+// Sleeps for ms by the mote's own watchdog.
+//
+static void doze(byte i, unsigned long ms) {
+  moteRadios[i].sleep();
+  air.wait((uint64_t) ms * (1000000L + drift[i]) / 1000);
+}
+
+//------------------------------------------------------------------------------
+// The gateway: beacon, hand out cells, and count each report once and ACK
+// it.
+//
+static void gateway(void* arg) {
+  gatewayRadio.initialize(FREQUENCY, GATEWAY_ID, NETWORK_ID);
+  gatewayRadio.setHighPower();
+  gatewaySlots->begin();
+  while (true) {
+    if (mode == SLOTTED) {
+      gatewaySlots->poll();
+    }
+    if (!gatewayRadio.receiveDone()) {
+      continue;
+    }
+    if (mode == SLOTTED && gatewaySlots->receive()) {
+      continue;
+    }
+    if (gatewayRadio.DATALEN == sizeof(Message)) {
+      Message msg;
+      uint32_t seq;
+      memcpy(&msg, (byte*) gatewayRadio.DATA, sizeof(msg));
+      memcpy(&seq, msg.msg.data, sizeof(seq));
+      byte i = msg.msg.source - FIRST_MOTE;
+      if (i < MAX_MOTES && seq != lastSeq[i]) {
+        lastSeq[i] = seq;
+        delivered++;
+      }
+    }
+    if (gatewayRadio.ACK_REQUESTED) {
+      AckRecord ack;
+      ack.pending = 0;
+      ack.rssi = gatewayRadio.RSSI;
+      ack.channel = ACK_NO_CHANNEL;
+      gatewayRadio.sendACK(&ack, sizeof(ack));
+    }
+  }
+}
+
+//------------------------------------------------------------------------------
+// A mote: report every period, when its watchdog says so or in its slot.
+//
+static void mote(void* arg) {
+  byte i = (RFM69*) arg - moteRadios;
+  RFM69& radio = moteRadios[i];
+  SlotSchedule& slots = *moteSlots[i];
+  radio.initialize(FREQUENCY, FIRST_MOTE + i, NETWORK_ID);
+  radio.setHighPower();
+  slots.begin(FIRST_MOTE + i, GATEWAY_ID, PERIOD_MS);
+  Message msg;
+  memset(&msg, 0, sizeof(msg));
+  msg.msg.type = MSG_READING;
+  msg.msg.source = FIRST_MOTE + i;
+  msg.msg.destination = GATEWAY_ID;
+  uint32_t seq = 0;
+  while (true) {
+    if (mode == SLOTTED && slots.assigned()) {
+      doze(i, slots.untilCell());
+      if (slots.sync()) {
+        doze(i, slots.untilSlot());
+      }
+    } else {
+      doze(i, PERIOD_MS);
+    }
+    seq++;
+    memcpy(msg.msg.data, &seq, sizeof(seq));
+    offered++;
+    if (mode == SLOTTED) {
+      slots.send(msg.raw, MSG_LENGTH);
+    } else {
+      radio.sendWithRetry(GATEWAY_ID, msg.raw, MSG_LENGTH);
+    }
+  }
+}
+
+//------------------------------------------------------------------------------
+// Runs one fleet in one mode and prints its row.
+//
+static void run(byte motes) {
+  air.reset();
+  air.seed(SEED);
+  offered = delivered = 0;
+  memset(lastSeq, 0, sizeof(lastSeq));
+  memset(&gatewayRadio.stats, 0, sizeof(gatewayRadio.stats));
+  delete gatewaySlots;
+  gatewaySlots = new SlotSchedule(gatewayRadio);
+  uint64_t start = air.now();
+  air.spawn(gateway, NULL);
+  for (byte i = 0; i < motes; i++) {
+    memset(&moteRadios[i].stats, 0, sizeof(moteRadios[i].stats));
+    delete moteSlots[i];
+    moteSlots[i] = new SlotSchedule(moteRadios[i]);
+    air.spawn(mote, &moteRadios[i], (1000 + air.random(PERIOD_MS)) * 1000ULL);
+  }
+  air.run(start + RUN_MS * 1000ULL);
+
+  unsigned long retries = 0, slotted = 0, missed = 0;
+  uint64_t listening = 0;
+  for (byte i = 0; i < motes; i++) {
+    retries += moteRadios[i].stats.retries;
+    listening += moteRadios[i].airStats.listening;
+    slotted += moteSlots[i]->stats.slotted;
+    missed += moteSlots[i]->stats.missed;
+  }
+  Serial.print(modeNames[mode]);
+  Serial.print(", ");
+  Serial.print(motes);
+  Serial.print(", ");
+  Serial.print(offered ? 100.0 * delivered / offered : 0.0, 2);
+  Serial.print(", ");
+  Serial.print(offered ? (float) retries / offered : 0.0, 3);
+  Serial.print(", ");
+  Serial.print(air.stats.collided);
+  Serial.print(", ");
+  Serial.print(offered ? listening / 1000.0 / offered : 0.0, 1);
+  Serial.print(", ");
+  Serial.print(offered ? 100.0 * slotted / offered : 0.0, 1);
+  Serial.print(", ");
+  Serial.println(missed);
+}
+
+void setup() {
+  Serial.begin(BAUD_RATE);
+  air.seed(7);
+  air.setJitter(FADING_DB);
+  air.setDefaultLink(0, -127);
+
+  // every pair of nodes, both ways
+  const byte nodes = 1 + MAX_MOTES;
+  byte ids[nodes];
+  float at[nodes][2];
+  ids[0] = GATEWAY_ID;
+  at[0][0] = at[0][1] = SIDE_M / 2;
+  for (byte i = 0; i < MAX_MOTES; i++) {
+    ids[1 + i] = FIRST_MOTE + i;
+    at[1 + i][0] = air.random(SIDE_M * 10) / 10.0;
+    at[1 + i][1] = air.random(SIDE_M * 10) / 10.0;
+    drift[i] = (long) air.random(2 * DRIFT_PPM + 1) - DRIFT_PPM;
+  }
+  for (byte a = 0; a < nodes; a++) {
+    for (byte b = 0; b < nodes; b++) {
+      if (a != b) air.setLink(ids[a], ids[b], 0, VirtualAir::pathLossRssi(at[a], at[b], RSSI_1M, PATH_LOSS));
+    }
+  }
+
+  Serial.println("mode, motes, delivered %, retries/report, collided frames, mote rx ms/report, slotted %, beacons missed");
+  for (byte f = 0; f < sizeof(fleetSizes); f++) {
+    for (mode = UNSLOTTED; mode < MODE_END; mode++) {
+      run(fleetSizes[f]);
+    }
+  }
+}
+
+void loop() {
+  air.wait(1000000);
+}
@@ -0,0 +1,215 @@
+/*
+  TaskScheduler.cpp - Logic for millisecond task timers.
+  Created by Jon R. Brule, October 19, 2026.
+  Released into the public domain.
+*/
+#include "Arduino.h"
+#include <avr/sleep.h>
+#include "TaskScheduler.h"
+
+//-----------------------------------------------------------------------------
+TaskScheduler::TaskScheduler(byte max) {
+  _tasks = (SchedulerTask*) malloc(max * sizeof(SchedulerTask));
+  _heap = (byte*) malloc(max);
+  init(max);
+}
+
+//-----------------------------------------------------------------------------
+// Uses caller-supplied storage, for sketches that avoid the heap.
+//
+TaskScheduler::TaskScheduler(SchedulerTask* tasks, byte* heap, byte max) {
+  _tasks = tasks;
+  _heap = heap;
+  init(max);
+}
+
+//-----------------------------------------------------------------------------
+void TaskScheduler::init(byte max) {
+  _count = 0;
+  _sleep = NULL;
+  for (byte i = 0; i < max; i++) {
+    _tasks[i].period = 0;
+    _tasks[i].callback = NULL;
+    _tasks[i].slot = SCHEDULER_NONE;
+  }
+}
+
+//-----------------------------------------------------------------------------
+// Runs the task once, ms milliseconds from now. A waiting task is moved.
+//
+void TaskScheduler::after(byte task, unsigned long ms, SchedulerCallback callback) {
+  _tasks[task].period = 0;
+  _tasks[task].callback = callback;
+  schedule(task, millis() + min(ms, SCHEDULER_MAX_DELAY));
+}
+
+//-----------------------------------------------------------------------------
+// Runs the task every ms milliseconds, first after ms or after first.
+// Repeats are counted from the previous deadline rather than from when
+// poll() got to it, so a late poll does not make the period drift.
+//
+void TaskScheduler::every(byte task, unsigned long ms, SchedulerCallback callback) {
+  every(task, ms, callback, ms);
+}
+
+void TaskScheduler::every(byte task, unsigned long ms, SchedulerCallback callback, unsigned long first) {
+  _tasks[task].period = min(ms, SCHEDULER_MAX_DELAY);
+  _tasks[task].callback = callback;
+  schedule(task, millis() + min(first, SCHEDULER_MAX_DELAY));
+}
+
+//-----------------------------------------------------------------------------
+// JeeLib compatible one-shot timer in tenths of seconds; keeps the callback.
+//
+void TaskScheduler::timer(byte task, word tenths) {
+  _tasks[task].period = 0;
+  schedule(task, millis() + tenths * 100UL);
+}
+
+//-----------------------------------------------------------------------------
+void TaskScheduler::cancel(byte task) {
+  if (_tasks[task].slot != SCHEDULER_NONE) {
+    remove(task);
+  }
+}
+
+//-----------------------------------------------------------------------------
+// The millis() value at which the next task is due, for sleeping until it.
+// With nothing waiting this is as far ahead as a deadline can be.
+//
+unsigned long TaskScheduler::nextDeadline() {
+  if (_count == 0) {
+    return millis() + SCHEDULER_MAX_DELAY;
+  }
+  return _tasks[_heap[0]].deadline;
+}
+
+//-----------------------------------------------------------------------------
+unsigned long TaskScheduler::timeLeft() {
+  long left = (long) (nextDeadline() - millis());
+  return (left > 0) ? left : 0;
+}
+
+//-----------------------------------------------------------------------------
+// Returns the next task that is due, after running its callback, or
+// SCHEDULER_READY if tasks are waiting but none is due yet, or
+// SCHEDULER_IDLE if no task is waiting. A periodic task that has fallen a
+// whole period behind skips the missed runs.
+//
+char TaskScheduler::poll() {
+  if (_count == 0) {
+    return SCHEDULER_IDLE;
+  }
+  byte task = _heap[0];
+  SchedulerTask& t = _tasks[task];
+  unsigned long now = millis();
+  if ((long) (now - t.deadline) < 0) {
+    return SCHEDULER_READY;
+  }
+  if (t.period > 0) {
+    unsigned long next = t.deadline + t.period;
+    if ((long) (now - next) >= 0) {
+      next = now + t.period;
+    }
+    schedule(task, next);
+  } else {
+    remove(task);
+  }
+  if (t.callback != NULL) {
+    t.callback(task);
+  }
+  return task;
+}
+
+//-----------------------------------------------------------------------------
+// Same as poll(), but first waits for the next deadline: asleep through the
+// hook given to setSleep(), then in idle mode (woken by the millis() tick)
+// for whatever the sleep left over. Returns SCHEDULER_READY if the sleep
+// was cut short, so that the sketch can look at what woke it.
+//
+char TaskScheduler::pollWaiting() {
+  if (_count == 0) {
+    return SCHEDULER_IDLE;
+  }
+  unsigned long deadline = nextDeadline();
+  if (_sleep != NULL && timeLeft() > 0 && !_sleep(deadline)) {
+    return SCHEDULER_READY;
+  }
+  set_sleep_mode(SLEEP_MODE_IDLE);
+  while ((long) (millis() - deadline) < 0) {
+    sleep_mode();
+  }
+  return poll();
+}
+
+//-----------------------------------------------------------------------------
+void TaskScheduler::schedule(byte task, unsigned long deadline) {
+  SchedulerTask& t = _tasks[task];
+  t.deadline = deadline;
+  if (t.slot == SCHEDULER_NONE) {
+    place(_count++, task);
+    siftUp(t.slot);
+  } else {
+    siftUp(t.slot);
+    siftDown(t.slot);
+  }
+}
+
+//-----------------------------------------------------------------------------
+void TaskScheduler::remove(byte task) {
+  byte slot = _tasks[task].slot;
+  _tasks[task].slot = SCHEDULER_NONE;
+  if (slot < --_count) {
+    byte moved = _heap[_count];
+    place(slot, moved);
+    siftUp(slot);
+    siftDown(_tasks[moved].slot);
+  }
+}
+
+//-----------------------------------------------------------------------------
+void TaskScheduler::place(byte slot, byte task) {
+  _heap[slot] = task;
+  _tasks[task].slot = slot;
+}
+
+//-----------------------------------------------------------------------------
+void TaskScheduler::siftUp(byte slot) {
+  while (slot > 0) {
+    byte parent = (slot - 1) / 2;
+    byte task = _heap[slot];
+    if (!before(task, _heap[parent])) {
+      break;
+    }
+    place(slot, _heap[parent]);
+    place(parent, task);
+    slot = parent;
+  }
+}
+
+//-----------------------------------------------------------------------------
+void TaskScheduler::siftDown(byte slot) {
+  while (true) {
+    unsigned int child = 2 * slot + 1;
+    if (child >= _count) {
+      break;
+    }
+    if (child + 1 < _count && before(_heap[child + 1], _heap[child])) {
+      child++;
+    }
+    byte task = _heap[slot];
+    if (!before(_heap[child], task)) {
+      break;
+    }
+    place(slot, _heap[child]);
+    place(child, task);
+    slot = child;
+  }
+}
+
+//-----------------------------------------------------------------------------
+// Compares deadlines across the millis() wrap.
+//
+bool TaskScheduler::before(byte a, byte b) {
+  return (long) (_tasks[a].deadline - _tasks[b].deadline) < 0;
+}
@@ -0,0 +1,69 @@
+/*
+  TaskScheduler.h - Library for millisecond task timers.
+  Created by Jon R. Brule, October 19, 2026.
+  Released into the public domain.
+
+  Keeps task deadlines in a binary min-heap, so finding the next task is
+  constant time and (re)scheduling one costs log2(tasks) swaps, rather than
+  a scan of every task on each tick. Deadlines are absolute millis() values
+  compared across the wrap, which allows delays of up to 2^31 - 1 ms (about
+  24 days). Tasks may repeat with a fixed period and may carry a callback.
+
+  poll(), pollWaiting(), timer(), cancel() and idle() behave as in JeeLib's
+  Scheduler, so a sketch can switch over by changing the declaration.
+*/
+#ifndef TaskScheduler_h
+#define TaskScheduler_h
+
+#include "Arduino.h"
+
+#define SCHEDULER_READY     -1      // poll(): tasks are waiting, none is due
+#define SCHEDULER_IDLE      -2      // poll(): no task is waiting
+#define SCHEDULER_NONE      0xFF    // heap slot of a task that is not waiting
+#define SCHEDULER_MAX_DELAY 0x7FFFFFFFUL
+
+typedef void (*SchedulerCallback)(byte task);
+
+// Sleeps until the deadline (a millis() value) and moves millis() forward
+// by the time asleep. Returns false if woken before the deadline.
+typedef bool (*SchedulerSleep)(unsigned long deadline);
+
+typedef struct {
+  unsigned long deadline;
+  unsigned long period;           // 0 for one-shot tasks
+  SchedulerCallback callback;
+  byte slot;                      // position in the heap, or SCHEDULER_NONE
+} SchedulerTask;
+
+class TaskScheduler {
+  public:
+    TaskScheduler(byte max);
+    TaskScheduler(SchedulerTask* tasks, byte* heap, byte max);
+    void after(byte task, unsigned long ms, SchedulerCallback callback = NULL);
+    void every(byte task, unsigned long ms, SchedulerCallback callback = NULL);
+    void every(byte task, unsigned long ms, SchedulerCallback callback, unsigned long first);
+    void timer(byte task, word tenths);
+    void cancel(byte task);
+    inline byte idle(byte task) { return _tasks[task].slot == SCHEDULER_NONE; }
+    inline byte pending() { return _count; }
+    unsigned long nextDeadline();
+    unsigned long timeLeft();
+    char poll();
+    char pollWaiting();
+    inline void setSleep(SchedulerSleep sleep) { _sleep = sleep; }
+  protected:
+    void schedule(byte task, unsigned long deadline);
+    void remove(byte task);
+    void place(byte slot, byte task);
+    void siftUp(byte slot);
+    void siftDown(byte slot);
+    bool before(byte a, byte b);
+  private:
+    void init(byte max);
+    SchedulerTask* _tasks;
+    byte* _heap;
+    byte _count;
+    SchedulerSleep _sleep;
+};
+
+#endif
@@ -0,0 +1,73 @@
+/* -----------------------------------------------------------------------------
+   Task Scheduler Sleepy Tasks
+  
+   Blinks the LED every 1.5 seconds and reads the battery every minute,
+   sleeping in power down between tasks. A press of the button on D3 cuts
+   the sleep short and schedules a one-shot report 250 ms later.
+  
+   Circuit:
+   * Moteino
+   * A0  - Battery voltage divider
+   * D3  - Button to ground (internal pullup)
+   * D9  - LED
+----------------------------------------------------------------------------- */
+#include <LowPower.h>
+#include <SleepManager.h>
+#include <SleepManagerPCINT.h>
+#include <TaskScheduler.h>
+
+#define BAUD_RATE    57600
+#define BATTERY_PIN  A0
+#define BUTTON_PIN   3
+#define LED_PIN      9
+
+enum { BLINK, BATTERY, REPORT, TASK_END };
+
+SleepManager sleeper;
+TaskScheduler scheduler(TASK_END);
+int battery;
+
+static bool sleepUntil(unsigned long deadline) {
+  return sleeper.sleepUntil(deadline) == SLEEP_TIMEOUT;
+}
+
+static void blink(byte task) {
+  digitalWrite(LED_PIN, HIGH);
+  delay(20);
+  digitalWrite(LED_PIN, LOW);
+}
+
+static void readBattery(byte task) {
+  battery = analogRead(BATTERY_PIN);
+}
+
+void setup() {
+  Serial.begin(BAUD_RATE);
+  pinMode(BUTTON_PIN, INPUT_PULLUP);
+  pinMode(LED_PIN, OUTPUT);
+  
+  sleeper.wakeOn(BUTTON_PIN, FALLING);
+  sleeper.begin();
+  scheduler.setSleep(sleepUntil);
+  scheduler.every(BLINK, 1500, blink);
+  scheduler.every(BATTERY, 60000UL, readBattery, 0);
+}
+
+void loop() {
+  switch (scheduler.pollWaiting()) {
+    case SCHEDULER_READY:
+      // woken early by the button
+      if (scheduler.idle(REPORT)) {
+        scheduler.after(REPORT, 250);
+      }
+      break;
+    case REPORT:
+      Serial.print("battery ");
+      Serial.print(battery);
+      Serial.print(", next task in ");
+      Serial.print(scheduler.timeLeft());
+      Serial.println("ms");
+      Serial.flush();
+      break;
+  }
+}
@@ -0,0 +1,512 @@
+/*
+  VirtualAir.h - Simulated radio medium and clock for host builds.
+  Created by Jon R. Brule, October 19, 2026.
+  Released into the public domain.
+
+  The air that SimulatedRFM69.h and SimulatedRFM12B.h transmit into, so a
+  gateway and a fleet of motes can run together in one Linux process. Each
+  node (a gateway loop, a mote) runs as a coroutine on one shared clock in
+  microseconds; it gives up the processor whenever it waits, polls its
+  radio or transmits, and the node due soonest runs next. The host
+  Arduino.h in host/ forwards millis(), micros() and delay() to the medium,
+  so sketch code keeps its own timing loops; the Makefile there builds the
+  host-only examples.
+
+  A frame is on the air for as long as its bits take at the sender's bit
+  rate. When it ends, every radio on the same frequency and network that
+  was listening for all of it receives it, unless the link loses it, it
+  arrives below the sensitivity, or an overlapping frame arrived within
+  VIRTUAL_AIR_CAPTURE_DB of its strength. Loss and RSSI are set per link by
+  node address, or for all links at once; the RSSI follows the sender's
+  power and may be jittered per frame, as fading would.
+*/
+#ifndef VirtualAir_h
+#define VirtualAir_h
+
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ucontext.h>
+
+#define VIRTUAL_AIR_NODES       128
+#define VIRTUAL_AIR_RADIOS      128
+#define VIRTUAL_AIR_FRAMES      256     // frames on the air or awaiting delivery
+#define VIRTUAL_AIR_FRAME_LEN   140     // longest frame, RFM12B with 128 data bytes
+#define VIRTUAL_AIR_STACK       65536   // bytes of stack per node
+#define VIRTUAL_AIR_POLL_US     20      // cost of one radio poll, so busy loops advance
+#define VIRTUAL_AIR_CAPTURE_DB  6       // margin by which a frame survives a collision
+#define VIRTUAL_AIR_RSSI        -70     // default link RSSI, dBm
+#define VIRTUAL_AIR_NOISE       -105    // RSSI with nothing on the air, dBm
+#define VIRTUAL_AIR_SENSITIVITY -97     // weakest frame a radio receives, dBm
+#define VIRTUAL_AIR_DEFAULT     0xFF    // link entry that follows the defaults
+
+enum { VIRTUAL_AIR_RFM69, VIRTUAL_AIR_RFM12B };
+
+// what became of a frame at a radio it was sent to
+enum { VIRTUAL_AIR_DELIVERED, VIRTUAL_AIR_LOST, VIRTUAL_AIR_COLLIDED, VIRTUAL_AIR_DEAF };
+
+typedef struct {
+  unsigned long sent;       // frames put on the air
+  unsigned long delivered;  // frames handed to the radio they were sent to
+  unsigned long lost;       // dropped by the link loss rate or below the sensitivity
+  unsigned long collided;   // corrupted by an overlapping frame
+  unsigned long deaf;       // addressed radio was not listening for all of it
+} VirtualAirStats;
+
+typedef struct {
+  unsigned long received;     // frames handed over by the air
+  unsigned long overwritten;  // received before the last one was read
+  uint64_t listening;         // us spent listening, up to the last time it stopped
+} VirtualRadioStats;
+
+class VirtualRadio;
+
+typedef struct {
+  VirtualRadio* sender;
+  uint8_t format;
+  uint32_t frequency;
+  uint8_t network;
+  uint8_t source;
+  uint8_t target;
+  bool broadcast;
+  int8_t power;             // dB relative to the link RSSI
+  uint64_t start;
+  uint64_t end;
+  bool pending;             // not yet delivered
+  uint8_t length;
+  uint8_t data[VIRTUAL_AIR_FRAME_LEN];
+} VirtualFrame;
+
+// What the air needs to know about a simulated radio. The radio keeps it
+// current and is handed each frame it hears through receive().
+class VirtualRadio {
+  public:
+    virtual void receive(const VirtualFrame& frame, int rssi) = 0;
+    uint8_t airFormat;
+    uint32_t airFrequency;      // Hz
+    uint8_t airNetwork;
+    uint8_t airAddress;
+    uint32_t airBitrate;        // bits per second
+    int8_t airPower;
+    bool airListening;
+    uint64_t airListeningSince;
+    VirtualRadioStats airStats;
+};
+
+// Called for each frame at each radio it was addressed to, with one of the
+// outcomes above, before a delivered frame is handed to the radio.
+typedef void (*VirtualAirObserver)(const VirtualFrame& frame, VirtualRadio* to, uint8_t outcome);
+
+class VirtualAir {
+  public:
+    static VirtualAir& medium() {
+      static VirtualAir air;
+      return air;
+    }
+
+    //--------------------------------------------------------------------------
+    // clock and nodes
+
+    inline uint64_t now() { return _now; }
+    inline unsigned long micros() { return (unsigned long) _now; }
+    inline unsigned long millis() { return (unsigned long) (_now / 1000); }
+
+    // Lets the simulated time pass for the running node. Outside of a node
+    // (e.g. in the driver between runs) the clock simply moves on. A node
+    // that is still due before every other one keeps running, which keeps
+    // busy polling loops cheap.
+    void wait(uint64_t us) {
+      uint64_t t = _now + us;
+      if (_current < 0) {
+        advance(t);
+        return;
+      }
+      _nodes[_current].wake = t;
+      if (t <= _until && t < nextWake(_current)) {
+        advance(t);
+        return;
+      }
+      swapcontext(&_nodes[_current].context, &_driver);
+    }
+
+    void waitUntil(uint64_t t) {
+      wait(t > _now ? t - _now : 0);
+    }
+
+    // Adds a node that runs entry(arg), typically setup() then loop()
+    // forever, starting at the current time plus offset microseconds. The
+    // slot of a node whose entry returned is used again.
+    int spawn(void (*entry)(void*), void* arg, uint64_t offset = 0) {
+      int i = 0;
+      while (i < _nodeCount && !(_nodes[i].done && i != _current)) {
+        i++;
+      }
+      if (i == _nodeCount) {
+        if (_nodeCount >= VIRTUAL_AIR_NODES) {
+          return -1;
+        }
+        _nodeCount++;
+      } else {
+        free(_nodes[i].stack);
+      }
+      VirtualNode& node = _nodes[i];
+      node.entry = entry;
+      node.arg = arg;
+      node.wake = _now + offset;
+      node.done = false;
+      node.stack = (char*) malloc(VIRTUAL_AIR_STACK);
+      getcontext(&node.context);
+      node.context.uc_stack.ss_sp = node.stack;
+      node.context.uc_stack.ss_size = VIRTUAL_AIR_STACK;
+      node.context.uc_link = &_driver;
+      makecontext(&node.context, (void (*)()) start, 1, i);
+      return i;
+    }
+
+    // Runs the nodes in time order until the clock reaches until (us).
+    void run(uint64_t until) {
+      _until = until;
+      while (true) {
+        int next = -1;
+        for (int i = 0; i < _nodeCount; i++) {
+          if (!_nodes[i].done && (next < 0 || _nodes[i].wake < _nodes[next].wake)) {
+            next = i;
+          }
+        }
+        if (next < 0 || _nodes[next].wake > until) {
+          advance(until);
+          return;
+        }
+        advance(_nodes[next].wake);
+        _current = next;
+        swapcontext(&_driver, &_nodes[next].context);
+        _current = -1;
+      }
+    }
+
+    inline int currentNode() { return _current; }
+
+    // Makes a waiting node due now, so that its wait() returns early, as an
+    // interrupt wakes a sleeping MCU.
+    void wake(int node) {
+      if (node >= 0 && node < _nodeCount && !_nodes[node].done && _nodes[node].wake > _now) {
+        _nodes[node].wake = _now;
+      }
+    }
+
+    // Drops every node, radio and frame, for the next run of a sweep. The
+    // clock keeps going. Call from the driver, not from a node.
+    void reset() {
+      for (int i = 0; i < _nodeCount; i++) {
+        free(_nodes[i].stack);
+      }
+      _nodeCount = 0;
+      _radioCount = 0;
+      memset(_frames, 0, sizeof(_frames));
+      memset(&stats, 0, sizeof(stats));
+      _nextEnd = UINT64_MAX;
+    }
+
+    //--------------------------------------------------------------------------
+    // medium
+
+    void attach(VirtualRadio* radio) {
+      for (int i = 0; i < _radioCount; i++) {
+        if (_radios[i] == radio) return;
+      }
+      if (_radioCount < VIRTUAL_AIR_RADIOS) {
+        _radios[_radioCount++] = radio;
+      }
+      radio->airListening = false;
+      memset(&radio->airStats, 0, sizeof(radio->airStats));
+    }
+
+    void listen(VirtualRadio* radio, bool on) {
+      if (on && !radio->airListening) {
+        radio->airListeningSince = _now;
+      } else if (!on && radio->airListening) {
+        radio->airStats.listening += _now - radio->airListeningSince;
+      }
+      radio->airListening = on;
+    }
+
+    // Puts a frame on the air and returns once its last bit is out.
+    // overhead is the bytes the radio adds around data (preamble, sync,
+    // CRC), which count towards the airtime but are not delivered.
+    void transmit(VirtualRadio* sender, uint8_t target, bool broadcast,
+                  const uint8_t* data, uint8_t length, uint8_t overhead) {
+      VirtualFrame* frame = slot();
+      frame->sender = sender;
+      frame->format = sender->airFormat;
+      frame->frequency = sender->airFrequency;
+      frame->network = sender->airNetwork;
+      frame->source = sender->airAddress;
+      frame->target = target;
+      frame->broadcast = broadcast;
+      frame->power = sender->airPower;
+      frame->length = length;
+      memcpy(frame->data, data, length);
+      frame->start = _now;
+      frame->end = _now + airtime(sender, length + overhead);
+      frame->pending = true;
+      if (frame->end < _nextEnd) _nextEnd = frame->end;
+      stats.sent++;
+      listen(sender, false);
+      waitUntil(frame->end);
+    }
+
+    inline uint64_t airtime(VirtualRadio* radio, unsigned int bytes) {
+      return (bytes * 8 * 1000000ULL + radio->airBitrate - 1) / radio->airBitrate;
+    }
+
+    // The strongest signal on the radio's channel right now, or the noise
+    // floor, for carrier sense.
+    int rssiAt(VirtualRadio* radio) {
+      int strongest = VIRTUAL_AIR_NOISE;
+      for (int i = 0; i < VIRTUAL_AIR_FRAMES; i++) {
+        VirtualFrame& f = _frames[i];
+        if (f.sender != NULL && f.sender != radio && f.frequency == radio->airFrequency
+            && f.start <= _now && _now < f.end) {
+          int rssi = linkRssi(f, radio);
+          if (rssi > strongest) strongest = rssi;
+        }
+      }
+      return strongest;
+    }
+
+    //--------------------------------------------------------------------------
+    // links
+
+    void setDefaultLink(uint8_t lossPercent, int8_t rssi) {
+      _defaultLoss = lossPercent;
+      _defaultRssi = rssi;
+    }
+
+    // Loss and RSSI from one node address to another; VIRTUAL_AIR_DEFAULT
+    // as the loss puts the link back on the defaults.
+    void setLink(uint8_t from, uint8_t to, uint8_t lossPercent, int8_t rssi) {
+      _loss[from][to] = lossPercent;
+      _rssi[from][to] = rssi;
+    }
+
+    // RSSI between two points, each {x, y} in metres, by the log-distance path
+    // loss model, for laying out setLink(): rssi1m at a metre, falling 10 *
+    // exponent dB per tenfold distance.
+    static int8_t pathLossRssi(const float* a, const float* b, int rssi1m, float exponent) {
+      float d = sqrt((a[0] - b[0]) * (a[0] - b[0]) + (a[1] - b[1]) * (a[1] - b[1]));
+      if (d < 1) d = 1;
+      float rssi = rssi1m - 10 * exponent * log10(d);
+      return rssi < -127 ? -127 : (int8_t) rssi;
+    }
+
+    inline void setJitter(uint8_t db) { _jitter = db; }
+    inline void setSensitivity(int8_t rssi) { _sensitivity = rssi; }
+    inline void setObserver(VirtualAirObserver observer) { _observer = observer; }
+    inline void seed(uint32_t seed) { _random = seed ? seed : 1; }
+
+    // xorshift32, so runs repeat exactly for a given seed
+    uint32_t random(uint32_t n) {
+      _random ^= _random << 13;
+      _random ^= _random >> 17;
+      _random ^= _random << 5;
+      return n ? _random % n : _random;
+    }
+
+    void resetStats() {
+      memset(&stats, 0, sizeof(stats));
+      for (int i = 0; i < _radioCount; i++) {
+        memset(&_radios[i]->airStats, 0, sizeof(_radios[i]->airStats));
+      }
+    }
+
+    //--------------------------------------------------------------------------
+    // results
+
+    // Sorts n samples (latencies, send times) for percentile().
+    static void sortSamples(unsigned long* samples, unsigned long n) {
+      qsort(samples, n, sizeof(samples[0]), compareSamples);
+    }
+
+    // The p-th percentile of n sorted samples, 0 when there are none; p 50
+    // is the median and p 100 the largest.
+    static unsigned long percentile(const unsigned long* sorted, unsigned long n, uint8_t p) {
+      return n ? sorted[(n - 1) * p / 100] : 0;
+    }
+
+    VirtualAirStats stats;
+
+  private:
+    typedef struct {
+      ucontext_t context;
+      void (*entry)(void*);
+      void* arg;
+      char* stack;
+      uint64_t wake;
+      bool done;
+    } VirtualNode;
+
+    VirtualAir() {
+      _now = 0;
+      _until = 0;
+      _nextEnd = UINT64_MAX;
+      _current = -1;
+      _nodeCount = 0;
+      _radioCount = 0;
+      _defaultLoss = 0;
+      _defaultRssi = VIRTUAL_AIR_RSSI;
+      _jitter = 0;
+      _sensitivity = VIRTUAL_AIR_SENSITIVITY;
+      _observer = NULL;
+      _random = 1;
+      memset(_loss, VIRTUAL_AIR_DEFAULT, sizeof(_loss));
+      memset(_frames, 0, sizeof(_frames));
+      memset(&stats, 0, sizeof(stats));
+    }
+
+    static int compareSamples(const void* a, const void* b) {
+      unsigned long x = *(const unsigned long*) a, y = *(const unsigned long*) b;
+      return (x > y) - (x < y);
+    }
+
+    static void start(int i) {
+      VirtualAir& air = medium();
+      air._nodes[i].entry(air._nodes[i].arg);
+      air._nodes[i].done = true;
+    }
+
+    inline uint8_t linkLoss(const VirtualFrame& f, VirtualRadio* to) {
+      uint8_t loss = _loss[f.source][to->airAddress];
+      return (loss == VIRTUAL_AIR_DEFAULT) ? _defaultLoss : loss;
+    }
+
+    inline int linkRssi(const VirtualFrame& f, VirtualRadio* to) {
+      bool set = _loss[f.source][to->airAddress] != VIRTUAL_AIR_DEFAULT;
+      return (set ? _rssi[f.source][to->airAddress] : _defaultRssi) + f.power;
+    }
+
+    VirtualFrame* slot() {
+      for (int i = 0; i < VIRTUAL_AIR_FRAMES; i++) {
+        if (_frames[i].sender == NULL) return &_frames[i];
+      }
+      fprintf(stderr, "VirtualAir: more than %d frames in flight\n", VIRTUAL_AIR_FRAMES);
+      abort();
+    }
+
+    uint64_t nextWake(int except) {
+      uint64_t wake = UINT64_MAX;
+      for (int i = 0; i < _nodeCount; i++) {
+        if (i != except && !_nodes[i].done && _nodes[i].wake < wake) wake = _nodes[i].wake;
+      }
+      return wake;
+    }
+
+    // Moves the clock to t, delivering the frames that end by then in the
+    // order they end.
+    void advance(uint64_t t) {
+      while (_nextEnd <= t) {
+        VirtualFrame* next = NULL;
+        uint64_t after = UINT64_MAX;
+        for (int i = 0; i < VIRTUAL_AIR_FRAMES; i++) {
+          VirtualFrame& f = _frames[i];
+          if (f.sender == NULL || !f.pending) continue;
+          if (next == NULL || f.end < next->end) {
+            if (next != NULL && next->end < after) after = next->end;
+            next = &f;
+          } else if (f.end < after) {
+            after = f.end;
+          }
+        }
+        _nextEnd = after;
+        _now = next->end;
+        deliver(*next);
+        next->pending = false;
+        release();
+      }
+      _now = t;
+    }
+
+    void deliver(const VirtualFrame& f) {
+      for (int i = 0; i < _radioCount; i++) {
+        VirtualRadio* r = _radios[i];
+        if (r == f.sender || r->airFrequency != f.frequency || r->airNetwork != f.network
+            || r->airFormat != f.format) {
+          continue;
+        }
+        bool addressed = f.broadcast || f.target == r->airAddress;
+        if (!r->airListening || r->airListeningSince > f.start) {
+          if (addressed) observe(f, r, VIRTUAL_AIR_DEAF, stats.deaf);
+          continue;
+        }
+        int rssi = linkRssi(f, r);
+        if (_jitter) {
+          rssi += (int) random(2 * _jitter + 1) - _jitter;
+        }
+        if (random(100) < linkLoss(f, r) || rssi < _sensitivity) {
+          if (addressed) observe(f, r, VIRTUAL_AIR_LOST, stats.lost);
+          continue;
+        }
+        if (collides(f, r, rssi)) {
+          if (addressed) observe(f, r, VIRTUAL_AIR_COLLIDED, stats.collided);
+          continue;
+        }
+        if (addressed) observe(f, r, VIRTUAL_AIR_DELIVERED, stats.delivered);
+        r->airStats.received++;
+        r->receive(f, rssi);
+      }
+    }
+
+    inline void observe(const VirtualFrame& f, VirtualRadio* r, uint8_t outcome, unsigned long& count) {
+      count++;
+      if (_observer) _observer(f, r, outcome);
+    }
+
+    bool collides(const VirtualFrame& f, VirtualRadio* r, int rssi) {
+      for (int i = 0; i < VIRTUAL_AIR_FRAMES; i++) {
+        VirtualFrame& o = _frames[i];
+        if (&o != &f && o.sender != NULL && o.sender != r && o.frequency == f.frequency
+            && o.start < f.end && f.start < o.end
+            && linkRssi(o, r) > rssi - VIRTUAL_AIR_CAPTURE_DB) {
+          return true;
+        }
+      }
+      return false;
+    }
+
+    // frees delivered frames that no pending frame overlaps any more
+    void release() {
+      uint64_t oldest = _now;
+      for (int i = 0; i < VIRTUAL_AIR_FRAMES; i++) {
+        if (_frames[i].sender != NULL && _frames[i].start < oldest) {
+          if (_frames[i].pending || _frames[i].end > _now) oldest = _frames[i].start;
+        }
+      }
+      for (int i = 0; i < VIRTUAL_AIR_FRAMES; i++) {
+        if (_frames[i].sender != NULL && !_frames[i].pending && _frames[i].end <= oldest) {
+          _frames[i].sender = NULL;
+        }
+      }
+    }
+
+    uint64_t _now;
+    uint64_t _until;
+    uint64_t _nextEnd;          // end of the first frame still to be delivered
+    ucontext_t _driver;
+    VirtualNode _nodes[VIRTUAL_AIR_NODES];
+    int _nodeCount;
+    int _current;
+    VirtualRadio* _radios[VIRTUAL_AIR_RADIOS];
+    int _radioCount;
+    VirtualFrame _frames[VIRTUAL_AIR_FRAMES];
+    uint8_t _loss[256][256];
+    int8_t _rssi[256][256];
+    uint8_t _defaultLoss;
+    int8_t _defaultRssi;
+    uint8_t _jitter;
+    int8_t _sensitivity;
+    VirtualAirObserver _observer;
+    uint32_t _random;
+};
+
+#endif
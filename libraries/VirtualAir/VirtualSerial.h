@@ -0,0 +1,146 @@
+/*
+  VirtualSerial.h - Simulated serial port on the VirtualAir clock.
+  Created by Jon R. Brule, October 19, 2026.
+  Released into the public domain.
+
+  Stands in for HardwareSerial in a node on the simulated medium, so the
+  cost of writing to a slow host link shows up in the node's timing. Bytes
+  leave at baud / 10 per second through a transmit buffer of
+  VIRTUAL_SERIAL_TX_BUFFER bytes, as on the ATmega; a write to a full
+  buffer waits for room, and the node gives up the processor meanwhile.
+  Before begin() is called, writes take no time.
+
+  Each line written is handed to the line hook with the time its last
+  byte left the port, and the receive side reads whatever was given to
+  inject(). Needs the host Arduino.h in host/, which provides Print.
+*/
+#ifndef VirtualSerial_h
+#define VirtualSerial_h
+
+#include "Arduino.h"
+#include <VirtualAir.h>
+
+#define VIRTUAL_SERIAL_TX_BUFFER  64
+#define VIRTUAL_SERIAL_RX_BUFFER  256
+#define VIRTUAL_SERIAL_LINE       256   // longest line passed to the hook
+
+// Called with each line written, without its line ending, and the time
+// (us) at which its last byte was out of the port.
+typedef void (*VirtualSerialLine)(void* context, const char* line, uint64_t sentAt);
+
+class VirtualSerial : public Print {
+  public:
+    VirtualSerial() {
+      _byteUs = 0;
+      _lineHook = NULL;
+      _lineContext = NULL;
+      reset();
+    }
+
+    void begin(unsigned long baud) { _byteUs = 10000000ULL / baud; }
+    void end() { flush(); }
+    operator bool() { return true; }
+
+    // Empties both directions and clears the statistics, for the next run
+    // of a sweep. Call from the driver, not from a node.
+    void reset() {
+      _idleAt = 0;
+      _blocked = false;
+      _lineLength = 0;
+      _rxHead = _rxTail = 0;
+      blockedUs = 0;
+      bytesWritten = 0;
+    }
+
+    size_t write(uint8_t c) {
+      VirtualAir& air = VirtualAir::medium();
+      if (_byteUs > 0) {
+        if (_idleAt > air.now() + (VIRTUAL_SERIAL_TX_BUFFER - 1) * _byteUs) {
+          uint64_t from = air.now();
+          _blocked = true;
+          air.waitUntil(_idleAt - (VIRTUAL_SERIAL_TX_BUFFER - 1) * _byteUs);
+          _blocked = false;
+          blockedUs += air.now() - from;
+        }
+        _idleAt = (_idleAt > air.now() ? _idleAt : air.now()) + _byteUs;
+      } else {
+        _idleAt = air.now();
+      }
+      bytesWritten++;
+      line(c);
+      return 1;
+    }
+    using Print::write;
+
+    // waits until the last byte is out, as HardwareSerial::flush() does
+    void flush() { VirtualAir::medium().waitUntil(_idleAt); }
+
+    int availableForWrite() {
+      uint64_t now = VirtualAir::medium().now();
+      if (_byteUs == 0 || _idleAt <= now) return VIRTUAL_SERIAL_TX_BUFFER;
+      return VIRTUAL_SERIAL_TX_BUFFER - (int) ((_idleAt - now + _byteUs - 1) / _byteUs);
+    }
+
+    int available() {
+      return (_rxHead - _rxTail + VIRTUAL_SERIAL_RX_BUFFER) % VIRTUAL_SERIAL_RX_BUFFER;
+    }
+
+    int peek() {
+      return (_rxHead == _rxTail) ? -1 : _rx[_rxTail];
+    }
+
+    int read() {
+      if (_rxHead == _rxTail) return -1;
+      uint8_t c = _rx[_rxTail];
+      _rxTail = (_rxTail + 1) % VIRTUAL_SERIAL_RX_BUFFER;
+      return c;
+    }
+
+    // Queues text as if the host had sent it; what does not fit is dropped,
+    // as on an overrun.
+    void inject(const char* s) {
+      while (*s) {
+        int next = (_rxHead + 1) % VIRTUAL_SERIAL_RX_BUFFER;
+        if (next == _rxTail) return;
+        _rx[_rxHead] = *s++;
+        _rxHead = next;
+      }
+    }
+
+    inline void setLineHook(VirtualSerialLine hook, void* context = NULL) {
+      _lineHook = hook;
+      _lineContext = context;
+    }
+
+    // true while a write is waiting for room in the transmit buffer
+    inline bool blocked() { return _blocked; }
+
+    uint64_t blockedUs;           // time spent waiting for room
+    unsigned long bytesWritten;
+
+  private:
+    void line(uint8_t c) {
+      if (c == '\n' || c == '\r') {
+        if (c == '\n' && _lineHook) {
+          _line[_lineLength] = 0;
+          _lineHook(_lineContext, _line, _idleAt);
+        }
+        if (c == '\n') _lineLength = 0;
+      } else if (_lineLength < VIRTUAL_SERIAL_LINE - 1) {
+        _line[_lineLength++] = c;
+      }
+    }
+
+    uint64_t _byteUs;
+    uint64_t _idleAt;             // when the last byte written is out
+    bool _blocked;
+    VirtualSerialLine _lineHook;
+    void* _lineContext;
+    char _line[VIRTUAL_SERIAL_LINE];
+    int _lineLength;
+    uint8_t _rx[VIRTUAL_SERIAL_RX_BUFFER];
+    int _rxHead;
+    int _rxTail;
+};
+
+#endif
@@ -0,0 +1,169 @@
+/* -----------------------------------------------------------------------------
+   Virtual Air CSMA Contention
+
+   Measures how often frames collide at a gateway as the offered load grows,
+   for RFM69::send()'s randomized backoff and for the old carrier sense loop
+   that spins until the channel clears. Traffic comes in bursts, as when a
+   door opening wakes several motes at once: events arrive at random, and
+   each one has GROUP_SIZE motes send a Message to the gateway at the same
+   instant, without an ACK. Both modes replay the same events.
+
+   Offered load is the airtime of the frames offered over the run time, so
+   1.0 would keep the channel busy if no frame ever waited. For each mode and
+   load the sketch prints the share of frames that collided, were delivered,
+   and were given up on a busy channel, the backoffs per frame, and the
+   median and 99th percentile of the time send() took.
+
+   Host only, on the simulated radios: make -C libraries/VirtualAir/host csmaContention
+----------------------------------------------------------------------------- */
+#include <Message.h>
+#include <RFM69.h>
+#include <VirtualAir.h>
+
+#define BAUD_RATE     57600
+#define GATEWAY_ID    1
+#define NETWORK_ID    99
+#define FREQUENCY     RF69_915MHZ
+#define MOTES         20
+#define GROUP_SIZE    4        // motes woken by each event
+#define RUN_MS        120000UL // simulated time per load
+#define MAX_WAKES     2048     // events a mote takes part in, per run
+#define MAX_SENDS     (MOTES * MAX_WAKES)
+
+const float loads[] = { 0.05, 0.1, 0.2, 0.3, 0.5, 0.7, 1.0 };
+
+// RFM69 with the carrier sense loop send() used before it backed off
+class SpinningRFM69 : public RFM69 {
+  public:
+    bool spin;
+    bool send(byte toAddress, const void* buffer, byte bufferSize) {
+      if (!spin) {
+        return RFM69::send(toAddress, buffer, bufferSize);
+      }
+      while (!canSend()) receiveDone();
+      sendFrame(toAddress, buffer, bufferSize);
+      return true;
+    }
+};
+
+VirtualAir& air = VirtualAir::medium();
+RFM69 gatewayRadio;
+SpinningRFM69 moteRadios[MOTES];
+
+unsigned long wakes[MOTES][MAX_WAKES];   // ms into the run
+unsigned int wakeCount[MOTES];
+unsigned long sendTimes[MAX_SENDS];      // us spent in send()
+unsigned long sends;
+unsigned long start;
+
+//------------------------------------------------------------------------------
+// The gateway only listens, so every frame lost is down to channel access.
+//
+static void gateway(void* arg) {
+  gatewayRadio.initialize(FREQUENCY, GATEWAY_ID, NETWORK_ID);
+  while (true) {
+    gatewayRadio.receiveDone();
+  }
+}
+
+//------------------------------------------------------------------------------
+// A mote: wake with each event it is part of and send one report.
+//
+static void mote(void* arg) {
+  SpinningRFM69& radio = *(SpinningRFM69*) arg;
+  byte index = &radio - moteRadios;
+  radio.initialize(FREQUENCY, GATEWAY_ID + 1 + index, NETWORK_ID);
+  radio.setHighPower();
+  radio.sleep();
+  Message msg;
+  memset(&msg, 0, sizeof(msg));
+  msg.msg.type = MSG_ALERT;
+  msg.msg.source = GATEWAY_ID + 1 + index;
+  for (unsigned int i = 0; i < wakeCount[index]; i++) {
+    air.waitUntil((start + wakes[index][i]) * 1000ULL);
+    unsigned long begin = air.micros();
+    radio.send(GATEWAY_ID, msg.raw, MSG_LENGTH);
+    radio.sleep();
+    if (sends < MAX_SENDS) {
+      sendTimes[sends++] = air.micros() - begin;
+    }
+  }
+}
+
+//------------------------------------------------------------------------------
+// Draws the events for one load: exponential gaps, GROUP_SIZE motes each.
+//
+static unsigned long schedule(float load, unsigned long frameUs) {
+  unsigned long events = 0;
+  float gapMs = frameUs * GROUP_SIZE / load / 1000.0;
+  memset(wakeCount, 0, sizeof(wakeCount));
+  float t = 0;
+  while (true) {
+    t += -log((air.random(65535) + 1) / 65536.0) * gapMs;
+    if (t >= RUN_MS) break;
+    for (byte picked = 0; picked < GROUP_SIZE; ) {
+      byte m = air.random(MOTES);
+      unsigned int n = wakeCount[m];
+      if (n > 0 && wakes[m][n - 1] == (unsigned long) t) continue;
+      if (n < MAX_WAKES) wakes[m][wakeCount[m]++] = (unsigned long) t;
+      picked++;
+    }
+    events++;
+  }
+  return events;
+}
+
+static float percent(unsigned long part, unsigned long whole) {
+  return whole ? 100.0 * part / whole : 0.0;
+}
+
+void setup() {
+  Serial.begin(BAUD_RATE);
+  Serial.println("csma, offered load, collided %, delivered %, busy %, backoffs/frame, send p50 ms, send p99 ms");
+
+  for (byte spin = 0; spin < 2; spin++) {
+    for (byte l = 0; l < sizeof(loads) / sizeof(loads[0]); l++) {
+      air.reset();
+      air.seed(42 + l);
+      unsigned long frameUs = air.airtime(&moteRadios[0], 4 + MSG_LENGTH + RF69_SIM_OVERHEAD);
+      unsigned long events = schedule(loads[l], frameUs);
+      sends = 0;
+      start = air.millis() + 10;
+
+      air.spawn(gateway, NULL);
+      for (byte i = 0; i < MOTES; i++) {
+        moteRadios[i].spin = spin;
+        air.spawn(mote, &moteRadios[i]);
+      }
+      air.run((start + RUN_MS + 1000) * 1000ULL);
+
+      unsigned long offered = events * GROUP_SIZE;
+      unsigned long backoffs = 0, busy = 0;
+      for (byte i = 0; i < MOTES; i++) {
+        backoffs += moteRadios[i].stats.backoffs;
+        busy += moteRadios[i].stats.busy;
+        memset(&moteRadios[i].stats, 0, sizeof(moteRadios[i].stats));
+      }
+      VirtualAir::sortSamples(sendTimes, sends);
+      Serial.print(spin ? "spin" : "backoff");
+      Serial.print(", ");
+      Serial.print(offered * (float) frameUs / (RUN_MS * 1000.0), 2);
+      Serial.print(", ");
+      Serial.print(percent(air.stats.collided, air.stats.sent), 2);
+      Serial.print(", ");
+      Serial.print(percent(air.stats.delivered, offered), 2);
+      Serial.print(", ");
+      Serial.print(percent(busy, offered), 2);
+      Serial.print(", ");
+      Serial.print(offered ? (float) backoffs / offered : 0.0, 2);
+      Serial.print(", ");
+      Serial.print(VirtualAir::percentile(sendTimes, sends, 50) / 1000.0, 2);
+      Serial.print(", ");
+      Serial.println(VirtualAir::percentile(sendTimes, sends, 99) / 1000.0, 2);
+    }
+  }
+}
+
+void loop() {
+  air.wait(1000000);
+}
@@ -0,0 +1,142 @@
+/* -----------------------------------------------------------------------------
+   Virtual Air Fleet Sweep
+  
+   Runs a gateway and a growing fleet of motes on the simulated medium and
+   prints, for each fleet size, the reports offered and delivered per
+   second, the loss, and the report latency percentiles. Each mote sends a
+   Message with sendWithRetry() every PERIOD_MS, jittered by up to 10%; the
+   gateway receives and ACKs as oha_gateway_rf_v0_2 does. Latency runs from
+   the start of the report to its first arrival at the gateway, so it
+   includes carrier sense and retries.
+  
+   Host only, on the simulated radios: make -C libraries/VirtualAir/host fleetSweep
+----------------------------------------------------------------------------- */
+#include <Message.h>
+#include <RFM69.h>
+#include <VirtualAir.h>
+
+#define BAUD_RATE     57600
+#define GATEWAY_ID    1
+#define NETWORK_ID    99
+#define FREQUENCY     RF69_915MHZ
+#define PERIOD_MS     5000     // report interval of each mote
+#define RUN_MS        300000UL // simulated time per fleet size
+#define LOSS_PERCENT  1        // link loss, each way
+#define MAX_MOTES     100
+#define MAX_REPORTS   (MAX_MOTES * (RUN_MS / PERIOD_MS) * 2)
+
+const byte fleetSizes[] = { 5, 10, 20, 40, 60, 80, 100 };
+
+VirtualAir& air = VirtualAir::medium();
+RFM69 gatewayRadio;
+RFM69 moteRadios[MAX_MOTES];
+
+unsigned long offered;
+unsigned long delivered;
+unsigned long latencies[MAX_REPORTS];
+uint32_t lastSeq[MAX_MOTES + 2];
+
+typedef struct {
+  uint32_t seq;
+  uint32_t sentAt;
+} Stamp;
+
+//------------------------------------------------------------------------------
+// The gateway's RF side: take each report, count it once, and ACK.
+//
+static void gateway(void* arg) {
+  gatewayRadio.initialize(FREQUENCY, GATEWAY_ID, NETWORK_ID);
+  gatewayRadio.setHighPower();
+  while (true) {
+    if (gatewayRadio.receiveDone()) {
+      if (gatewayRadio.DATALEN == sizeof(Message)) {
+        Message msg;
+        Stamp stamp;
+        memcpy(&msg, (byte*) gatewayRadio.DATA, sizeof(msg));
+        memcpy(&stamp, msg.msg.data, sizeof(stamp));
+        if (stamp.seq != lastSeq[msg.msg.source]) {
+          lastSeq[msg.msg.source] = stamp.seq;
+          if (delivered < MAX_REPORTS) {
+            latencies[delivered] = air.millis() - stamp.sentAt;
+          }
+          delivered++;
+        }
+      }
+      if (gatewayRadio.ACK_REQUESTED) {
+        AckRecord ack;
+        ack.pending = 0;
+        ack.rssi = gatewayRadio.RSSI;
+        ack.channel = ACK_NO_CHANNEL;
+        gatewayRadio.sendACK(&ack, sizeof(ack));
+      }
+    }
+  }
+}
+
+//------------------------------------------------------------------------------
+// A mote: sleep, report with retries, repeat.
+//
+static void mote(void* arg) {
+  RFM69& radio = *(RFM69*) arg;
+  byte node = &radio - moteRadios + GATEWAY_ID + 1;
+  radio.initialize(FREQUENCY, node, NETWORK_ID);
+  radio.setHighPower();
+  Message msg;
+  Stamp stamp = { 0, 0 };
+  while (true) {
+    radio.sleep();
+    air.wait((PERIOD_MS * (90 + air.random(21)) / 100) * 1000ULL);
+    memset(&msg, 0, sizeof(msg));
+    msg.msg.type = MSG_READING;
+    msg.msg.source = node;
+    stamp.seq++;
+    stamp.sentAt = air.millis();
+    memcpy(msg.msg.data, &stamp, sizeof(stamp));
+    offered++;
+    radio.sendWithRetry(GATEWAY_ID, msg.raw, MSG_LENGTH);
+  }
+}
+
+void setup() {
+  Serial.begin(BAUD_RATE);
+  Serial.println("motes, offered/s, delivered/s, loss %, p50 ms, p90 ms, p99 ms, collided, deaf");
+  air.seed(42);
+  air.setDefaultLink(LOSS_PERCENT, VIRTUAL_AIR_RSSI);
+  
+  for (byte f = 0; f < sizeof(fleetSizes); f++) {
+    byte motes = fleetSizes[f];
+    air.reset();
+    offered = delivered = 0;
+    memset(lastSeq, 0, sizeof(lastSeq));
+    
+    air.spawn(gateway, NULL);
+    for (byte i = 0; i < motes; i++) {
+      air.spawn(mote, &moteRadios[i], air.random(PERIOD_MS) * 1000ULL);
+    }
+    air.run(air.now() + RUN_MS * 1000ULL);
+    
+    unsigned long n = delivered < MAX_REPORTS ? delivered : MAX_REPORTS;
+    VirtualAir::sortSamples(latencies, n);
+    Serial.print(motes);
+    Serial.print(", ");
+    Serial.print(offered * 1000.0 / RUN_MS, 2);
+    Serial.print(", ");
+    Serial.print(delivered * 1000.0 / RUN_MS, 2);
+    Serial.print(", ");
+    Serial.print(offered ? 100.0 * (offered - delivered) / offered : 0.0, 2);
+    Serial.print(", ");
+    Serial.print(VirtualAir::percentile(latencies, n, 50));
+    Serial.print(", ");
+    Serial.print(VirtualAir::percentile(latencies, n, 90));
+    Serial.print(", ");
+    Serial.print(VirtualAir::percentile(latencies, n, 99));
+    Serial.print(", ");
+    Serial.print(air.stats.collided);
+    Serial.print(", ");
+    Serial.println(air.stats.deaf);
+  }
+}
+
+void loop() {
+  air.wait(1000000);
+}
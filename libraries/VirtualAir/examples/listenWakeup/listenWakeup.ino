@@ -0,0 +1,223 @@
+/* -----------------------------------------------------------------------------
+   Virtual Air Listen Wakeup
+
+   Measures how long a command takes to reach a sleeping mote, and what the
+   mote's radio draws meanwhile, with commands held until the mote's next
+   report and with the mote in RFM69 listen mode, for a few listen cycles.
+   Motes report every PERIOD_MS; commands arrive at random, each for a
+   mote with none outstanding, and the gateway handles them as
+   oha_gateway_rf_v0_2 does: a wake-up burst first if motes listen, else
+   (or if no answer comes) a pending count in the ACK to the next report.
+
+   Latency runs from the command reaching the gateway to the mote's answer
+   reaching it. The radio current is an estimate: time listening times
+   RX_UA, airtime sent times TX_UA, and the rest of the time in listen mode
+   times LISTEN_IDLE_UA; oscillator start-ups and radio sleep are left out.
+
+   Host only, on the simulated radios: make -C libraries/VirtualAir/host listenWakeup
+----------------------------------------------------------------------------- */
+#include <Message.h>
+#include <RFM69.h>
+#include <VirtualAir.h>
+
+#define BAUD_RATE       57600
+#define GATEWAY_ID      1
+#define NETWORK_ID      99
+#define FREQUENCY       RF69_915MHZ
+#define MOTES           8
+#define PERIOD_MS       60000    // report interval of each mote
+#define COMMAND_MS      60000    // mean time between commands, fleet wide
+#define RUN_MS          3600000UL
+#define REPLY_TIMEOUT   150      // ms the gateway waits for an answer
+#define COMMAND_WINDOW  150      // ms a mote listens after an ACK with commands pending
+#define MAX_COMMANDS    512
+#define RX_UA           16000
+#define TX_UA           45000
+#define LISTEN_IDLE_UA  1.2
+
+// 0 keeps commands for the next report; the others are listen idle periods
+const unsigned long cycles[] = { 0, 250000, 500000, 1000000 };
+
+VirtualAir& air = VirtualAir::medium();
+RFM69 gatewayRadio;
+RFM69 moteRadios[MOTES];
+
+unsigned long listenIdle;        // us, 0 for no listen mode
+uint64_t issued[MOTES];          // us the outstanding command came in, 0 if none
+uint64_t listenUs[MOTES];        // time spent in listen mode
+unsigned long latencies[MAX_COMMANDS];   // us
+unsigned long answered;
+unsigned long commands;
+
+//------------------------------------------------------------------------------
+// The gateway: ACK reports with the commands pending, deliver them after the
+// ACK, and record each answer.
+//
+static bool gatewayReceive() {
+  if (!gatewayRadio.receiveDone()) {
+    return false;
+  }
+  byte node = gatewayRadio.SENDERID;
+  byte i = node - GATEWAY_ID - 1;
+  bool report = false;
+  if (gatewayRadio.DATALEN == sizeof(Message) && i < MOTES) {
+    Message msg;
+    memcpy(&msg, (byte*) gatewayRadio.DATA, sizeof(msg));
+    if (msg.msg.type == MSG_CONFIG && issued[i] != 0) {
+      if (answered < MAX_COMMANDS) latencies[answered] = air.now() - issued[i];
+      answered++;
+      issued[i] = 0;
+    }
+    report = msg.msg.type == MSG_READING;
+  }
+  if (gatewayRadio.ACK_REQUESTED) {
+    AckRecord ack;
+    ack.pending = (i < MOTES && issued[i] != 0) ? 1 : 0;
+    ack.rssi = gatewayRadio.RSSI;
+    ack.channel = ACK_NO_CHANNEL;
+    gatewayRadio.sendACK(&ack, sizeof(ack));
+  }
+  if (report && issued[i] != 0) {
+    Message command;
+    memset(&command, 0, sizeof(command));
+    command.msg.type = MSG_CONFIG;
+    command.msg.destination = node;
+    command.msg.component = CMD_GET;
+    if (gatewayRadio.sendWithRetry(node, command.raw, MSG_LENGTH)) {
+      unsigned long start = air.millis();
+      while (issued[i] != 0 && air.millis() - start < REPLY_TIMEOUT) gatewayReceive();
+    }
+  }
+  return true;
+}
+
+static void gateway(void* arg) {
+  gatewayRadio.initialize(FREQUENCY, GATEWAY_ID, NETWORK_ID);
+  gatewayRadio.setListenCycle(listenIdle, RF69_LISTEN_RX_US);
+  uint64_t next = air.now() + air.random(2 * COMMAND_MS) * 1000ULL;
+  while (true) {
+    gatewayReceive();
+    if (air.now() < next) continue;
+    next += air.random(2 * COMMAND_MS) * 1000ULL;
+    byte i = air.random(MOTES);
+    if (issued[i] != 0) continue;
+    issued[i] = air.now();
+    commands++;
+    if (listenIdle == 0) continue;
+    Message command;
+    memset(&command, 0, sizeof(command));
+    command.msg.type = MSG_CONFIG;
+    command.msg.destination = GATEWAY_ID + 1 + i;
+    command.msg.component = CMD_GET;
+    if (gatewayRadio.sendBurst(GATEWAY_ID + 1 + i, command.raw, MSG_LENGTH)) {
+      unsigned long start = air.millis();
+      while (issued[i] != 0 && air.millis() - start < REPLY_TIMEOUT) gatewayReceive();
+    }
+  }
+}
+
+//------------------------------------------------------------------------------
+// A mote: sleep, in listen mode if enabled, report every PERIOD_MS and
+// answer commands.
+//
+static bool send(RFM69& radio, byte source, byte type) {
+  Message msg;
+  memset(&msg, 0, sizeof(msg));
+  msg.msg.type = type;
+  msg.msg.source = source;
+  msg.msg.component = CMD_GET;
+  bool acked = radio.sendWithRetry(GATEWAY_ID, msg.raw, MSG_LENGTH);
+  return acked && radio.DATALEN > 0 && radio.DATA[0] > 0;
+}
+
+static void commandWindow(RFM69& radio, byte id) {
+  unsigned long start = air.millis();
+  while (air.millis() - start < COMMAND_WINDOW) {
+    if (radio.receiveDone() && radio.SENDERID == GATEWAY_ID && radio.DATALEN == MSG_LENGTH) {
+      if (radio.ACK_REQUESTED) radio.sendACK();
+      send(radio, id, MSG_CONFIG);
+      break;
+    }
+  }
+  radio.sleep();
+}
+
+static void mote(void* arg) {
+  byte i = (RFM69*) arg - moteRadios;
+  RFM69& radio = moteRadios[i];
+  byte id = GATEWAY_ID + 1 + i;
+  radio.initialize(FREQUENCY, id, NETWORK_ID);
+  radio.setListenCycle(listenIdle, RF69_LISTEN_RX_US);
+  radio.sleep();
+  uint64_t next = air.now() + air.random(PERIOD_MS) * 1000ULL;
+  while (true) {
+    if (listenIdle != 0) {
+      uint64_t start = air.now();
+      radio.listenModeStart();
+      air.waitUntil(next);
+      bool woken = radio.listenModeEnd();
+      listenUs[i] += air.now() - start;
+      radio.sleep();
+      if (woken && radio.SENDERID == GATEWAY_ID) {
+        air.wait(radio.burstRemaining() * 1000ULL);
+        if (send(radio, id, MSG_CONFIG)) commandWindow(radio, id);
+      }
+    } else {
+      air.waitUntil(next);
+    }
+    if (air.now() < next) continue;
+    next += (PERIOD_MS * (95 + air.random(11)) / 100) * 1000ULL;
+    if (send(radio, id, MSG_READING)) commandWindow(radio, id);
+  }
+}
+
+void setup() {
+  Serial.begin(BAUD_RATE);
+  Serial.println("listen idle ms, commands, answered %, latency p50 ms, p90 ms, max ms, mote radio uA");
+
+  for (byte c = 0; c < sizeof(cycles) / sizeof(cycles[0]); c++) {
+    air.reset();
+    air.seed(42);
+    listenIdle = cycles[c];
+    answered = 0;
+    commands = 0;
+    memset(issued, 0, sizeof(issued));
+    memset(listenUs, 0, sizeof(listenUs));
+    uint64_t begin = air.now();
+    air.spawn(gateway, NULL);
+    for (byte i = 0; i < MOTES; i++) {
+      air.spawn(mote, &moteRadios[i]);
+    }
+    air.run(begin + RUN_MS * 1000ULL);
+
+    float charge = 0;   // uA us, all motes
+    for (byte i = 0; i < MOTES; i++) {
+      RFM69& radio = moteRadios[i];
+      uint64_t tx = air.airtime(&radio, radio.stats.bytes + radio.stats.frames * RF69_SIM_OVERHEAD);
+      air.listen(&radio, false);
+      uint64_t rx = radio.airStats.listening;
+      charge += (float) rx * RX_UA + (float) tx * TX_UA;
+      if (listenUs[i] > rx) charge += (listenUs[i] - rx) * LISTEN_IDLE_UA;
+      memset(&radio.stats, 0, sizeof(radio.stats));
+    }
+    unsigned long n = answered < MAX_COMMANDS ? answered : MAX_COMMANDS;
+    VirtualAir::sortSamples(latencies, n);
+    Serial.print(cycles[c] / 1000);
+    Serial.print(", ");
+    Serial.print(commands);
+    Serial.print(", ");
+    Serial.print(commands ? 100.0 * answered / commands : 0.0, 1);
+    Serial.print(", ");
+    Serial.print(VirtualAir::percentile(latencies, n, 50) / 1000.0, 0);
+    Serial.print(", ");
+    Serial.print(VirtualAir::percentile(latencies, n, 90) / 1000.0, 0);
+    Serial.print(", ");
+    Serial.print(VirtualAir::percentile(latencies, n, 100) / 1000.0, 0);
+    Serial.print(", ");
+    Serial.println(charge / MOTES / (RUN_MS * 1000.0), 1);
+  }
+}
+
+void loop() {
+  air.wait(1000000);
+}
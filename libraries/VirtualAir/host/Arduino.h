@@ -0,0 +1,146 @@
+/*
+  Arduino.h - Host stand-in for the Arduino core, for simulations.
+  Created by Jon R. Brule, October 19, 2026.
+  Released into the public domain.
+
+  Just enough of the core for the host-only examples and benches to build
+  with g++ on Linux: the types and macros, Print, and a Serial that writes
+  to stdout and never has input. millis(), micros() and delay() run on the
+  VirtualAir clock, so sketch code waits in simulated time, and outside a
+  node the clock simply moves on. Pins, interrupts and the ADC do nothing.
+  The Makefile next to this file builds every host-only sketch with it.
+*/
+#ifndef Arduino_h
+#define Arduino_h
+
+#include <math.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef uint8_t byte;
+typedef uint16_t word;
+typedef bool boolean;
+
+#define HIGH          1
+#define LOW           0
+#define INPUT         0
+#define OUTPUT        1
+#define INPUT_PULLUP  2
+#define CHANGE        1
+#define FALLING       2
+#define RISING        3
+#define DEC           10
+#define HEX           16
+#define SS            10
+#define A0            14
+#define A1            15
+#define A2            16
+#define A3            17
+
+#ifndef min
+#define min(a,b) ((a)<(b)?(a):(b))
+#endif
+#ifndef max
+#define max(a,b) ((a)>(b)?(a):(b))
+#endif
+#define constrain(amt,low,high) ((amt)<(low)?(low):((amt)>(high)?(high):(amt)))
+
+#define PROGMEM
+#define PGM_P const char*
+#define pgm_read_byte(addr) (*(const uint8_t*) (addr))
+class __FlashStringHelper;
+#define F(string_literal) ((const __FlashStringHelper*) (string_literal))
+
+#include <VirtualAir.h>
+
+inline unsigned long millis() { return VirtualAir::medium().millis(); }
+inline unsigned long micros() { return VirtualAir::medium().micros(); }
+inline void delay(unsigned long ms) { VirtualAir::medium().wait(ms * 1000ULL); }
+inline void delayMicroseconds(unsigned int us) { VirtualAir::medium().wait(us); }
+inline void yield() {}
+
+inline void pinMode(uint8_t pin, uint8_t mode) {}
+inline void digitalWrite(uint8_t pin, uint8_t value) {}
+inline int digitalRead(uint8_t pin) { return LOW; }
+inline int analogRead(uint8_t pin) { return 0; }
+inline void analogWrite(uint8_t pin, int value) {}
+inline void attachInterrupt(uint8_t interrupt, void (*isr)(void), int mode) {}
+inline void detachInterrupt(uint8_t interrupt) {}
+inline void noInterrupts() {}
+inline void interrupts() {}
+
+inline void randomSeed(unsigned long seed) { srandom(seed); }
+inline long random(long howbig) { return howbig > 0 ? ::random() % howbig : 0; }
+inline long random(long howsmall, long howbig) {
+  return howsmall < howbig ? howsmall + random(howbig - howsmall) : howsmall;
+}
+
+//------------------------------------------------------------------------------
+// As the core's Print: a subclass writes single bytes, everything else is
+// formatted here.
+//
+class Print {
+  public:
+    virtual ~Print() {}
+    virtual size_t write(uint8_t c) = 0;
+    virtual size_t write(const uint8_t* buffer, size_t size) {
+      size_t n = 0;
+      while (size--) n += write(*buffer++);
+      return n;
+    }
+    size_t write(const char* str) { return str ? write((const uint8_t*) str, strlen(str)) : 0; }
+    size_t write(const char* buffer, size_t size) { return write((const uint8_t*) buffer, size); }
+
+    size_t print(const __FlashStringHelper* str) { return write((const char*) str); }
+    size_t print(const char* str) { return write(str); }
+    size_t print(char c) { return write((uint8_t) c); }
+    size_t print(unsigned char n, int base = DEC) { return print((unsigned long) n, base); }
+    size_t print(int n, int base = DEC) { return print((long) n, base); }
+    size_t print(unsigned int n, int base = DEC) { return print((unsigned long) n, base); }
+    size_t print(long n, int base = DEC) {
+      char buffer[24];
+      snprintf(buffer, sizeof(buffer), base == HEX ? "%lX" : "%ld", n);
+      return write(buffer);
+    }
+    size_t print(unsigned long n, int base = DEC) {
+      char buffer[24];
+      snprintf(buffer, sizeof(buffer), base == HEX ? "%lX" : "%lu", n);
+      return write(buffer);
+    }
+    size_t print(double n, int digits = 2) {
+      char buffer[48];
+      snprintf(buffer, sizeof(buffer), "%.*f", digits, n);
+      return write(buffer);
+    }
+
+    size_t println() { return write("\r\n"); }
+    template <class T> size_t println(T value) { return print(value) + println(); }
+    template <class T> size_t println(T value, int format) { return print(value, format) + println(); }
+};
+
+//------------------------------------------------------------------------------
+// Serial on stdout. Line endings go out as a bare newline, so the output
+// can be piped into other tools.
+//
+class HostSerial : public Print {
+  public:
+    void begin(unsigned long baud) {}
+    void end() { flush(); }
+    int available() { return 0; }
+    int peek() { return -1; }
+    int read() { return -1; }
+    void flush() { fflush(stdout); }
+    operator bool() { return true; }
+    size_t write(uint8_t c) {
+      if (c == '\r') return 1;
+      return fputc(c, stdout) == EOF ? 0 : 1;
+    }
+    using Print::write;
+};
+
+extern HostSerial Serial;
+
+#endif
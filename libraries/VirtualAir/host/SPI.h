@@ -0,0 +1,13 @@
+/*
+  SPI.h - Host stand-in for the Arduino SPI library.
+  Created by Jon R. Brule, October 19, 2026.
+  Released into the public domain.
+
+  Empty: the simulated radios never touch the bus, but sketches include it.
+*/
+#ifndef SPI_h
+#define SPI_h
+
+#include "Arduino.h"
+
+#endif
@@ -0,0 +1,42 @@
+/*
+  ArduinoJson.h - Host stand-in for the parts of ArduinoJson the gateway uses.
+  Created by Jon R. Brule, October 19, 2026.
+  Released into the public domain.
+
+  The ArduinoJson snapshot in libraries/ is not complete enough to build on
+  the host, and the benches never feed the gateway JSON: they only read what
+  it writes, which goes through JsonWriter. So this declares just what
+  JsonArena.h and the gateway's serial parser compile against, and every
+  parse fails, as it would on a malformed line. Only the Makefile here puts
+  it on the include path, for FleetBench.
+*/
+#ifndef ArduinoJson_h
+#define ArduinoJson_h
+
+#include <stddef.h>
+
+class JsonVariant {
+  public:
+    template <typename T> operator T() const { return T(); }
+    JsonVariant operator[](int index) const { return *this; }
+    JsonVariant operator[](const char* key) const { return *this; }
+};
+
+class JsonObject {
+  public:
+    bool success() const { return false; }
+    JsonVariant operator[](const char* key) const { return JsonVariant(); }
+};
+
+template <typename TAllocator>
+class DynamicJsonBufferBase {
+  public:
+    explicit DynamicJsonBufferBase(size_t initialSize = 256) {}
+    size_t size() const { return 0; }
+    JsonObject& parseObject(char* json) { return _invalid; }
+
+  private:
+    JsonObject _invalid;
+};
+
+#endif
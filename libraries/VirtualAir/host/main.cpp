@@ -0,0 +1,20 @@
+/*
+  main.cpp - Host entry point for the simulations.
+  Created by Jon R. Brule, October 19, 2026.
+  Released into the public domain.
+
+  Runs the sketch's setup() once and exits. The host-only examples and
+  benches do all their work in setup() and print their results; their
+  loop() only lets time pass, so it is not called.
+*/
+#include "Arduino.h"
+
+HostSerial Serial;
+
+void setup();
+
+int main() {
+  setup();
+  Serial.flush();
+  return 0;
+}
@@ -9,11 +9,15 @@
    * Momentary button attached to digital pin 2
    * LED Light attached to digital pin 3
    * RF Status LED attached to digital pin 9
+
+   With REPEATER, the mote, being on mains power, also relays the reports
+   of battery motes out of the gateway's reach (see MeshRouter).
  
    Created 08-JUN-2014 by Jon Brule
 ----------------------------------------------------------------------------- */
 #include <ChibiOS_AVR.h>
 #include <Heartbeat.h>
+#include <MeshRouter.h>
 #include <RFM69.h>
 #include <SPI.h>
 #include <Event.h>
@@ -23,6 +27,7 @@
 
 #define SERIAL      1   // set to 1 to also report readings on the serial port
 #define DEBUG       1   // set to 1 to display each loop() run
+#define REPEATER    0   // set to 1 to relay other motes' reports to the gateway
 #define BAUD_RATE   57600
 
 #define APIN_BATTERY     0
@@ -48,7 +53,11 @@ long lastDebounceTime = 0;  // the last time the output pin was toggled
 long debounceDelay = 100;    // the debounce time; increase if the output flickers
 
 Light light(REPORT_INTERVAL, DPIN_LIGHT, APIN_BATTERY);
+MUTEX_DECL(lightMutex);   // light is shared with the light thread
 RFM69 radio;
+#if REPEATER
+    MeshRouter mesh(radio);
+#endif
 
 EventMessage inbound, outbound;
 
@@ -71,7 +80,9 @@ static msg_t HeartbeatThread(void *arg) {
 static WORKING_AREA(waThread2, 50);
 static msg_t LightThread(void *arg) {
   while (1) {
+    chMtxLock(&lightMutex);
     light.measure();
+    chMtxUnlock();
     chThdSleepMilliseconds(MEASURE_PERIOD);
   }
   return 0;
@@ -113,32 +124,44 @@ void mainThread () {
 //-----------------------------------------------------------------------------
 void loop () {
   
-  // send report to gateway if ready
-  noInterrupts();
-  if (light.isReportReady()) {
+  // send report to gateway if ready; the radio needs interrupts, so only
+  // the light is locked, not the whole exchange
+  chMtxLock(&lightMutex);
+  boolean ready = light.isReportReady();
+  chMtxUnlock();
+  if (ready) {
     sendReadingReport();
   }
-  interrupts();
 
   // process light control buttons    
-  noInterrupts();
   handleLightButton();
-  interrupts();
   
-  // bridge rf to serial messages
-  noInterrupts();
+  // beacon the route to the gateway
+  #if REPEATER
+      mesh.poll();
+  #endif
+
+  // bridge rf to serial messages; MeshRouter relays and ACKs routed frames
   if (radio.receiveDone()) {
-      if (radio.DATALEN != sizeof(EventMessage)) {
-          Serial.print("Invalid payload received, not matching Payload struct!");
+      #if REPEATER
+          boolean routed = mesh.receive() != MESH_NONE;
+      #else
+          boolean routed = false;
+      #endif
+      if (routed) {
+          // relayed, or routing news; MeshRouter has ACKed it already
       } else {
-          memcpy(&inbound, (byte*) radio.DATA, sizeof inbound);
-          consumeRf();
-      }
-      if (radio.ACK_REQUESTED) {
-          radio.sendACK();
+          if (radio.DATALEN != sizeof(EventMessage)) {
+              Serial.print("Invalid payload received, not matching Payload struct!");
+          } else {
+              memcpy(&inbound, (byte*) radio.DATA, sizeof inbound);
+              consumeRf();
+          }
+          if (radio.ACK_REQUESTED) {
+              radio.sendACK();
+          }
       }
   }
-  interrupts();
   
 }
 
@@ -151,6 +174,7 @@ static void consumeRf() {
     Serial.print("command=[");
     Serial.print(inbound.event.data[0], DEC);
     Serial.println("]");
+    chMtxLock(&lightMutex);
     if (event.data[0] == CMD_ON) {
       light.on();
     } else if (event.data[0] == CMD_OFF) {
@@ -158,6 +182,7 @@ static void consumeRf() {
     } else if (event.data[0] == CMD_TOGGLE) {
       light.toggle();
     }
+    chMtxUnlock();
   }
 }
 
@@ -173,7 +198,9 @@ static void handleLightButton() {
     if (reading != buttonState) {
       buttonState = reading;
       if (buttonState == HIGH) {
+        chMtxLock(&lightMutex);
         light.toggle();
+        chMtxUnlock();
       }
     }
   }
@@ -189,8 +216,10 @@ static void sendReadingReport() {
     outbound.event.network = NETWORKID;
     outbound.event.source = NODEID;
     
+    chMtxLock(&lightMutex);
     SensorData* report = light.report();
     memcpy(&outbound.event.data, report, sizeof(*report));
+    chMtxUnlock();
     
     #if DEBUG
         Serial.print("Broadcasting report to gateway...");
@@ -215,6 +244,9 @@ static void setup_radio() {
     #endif
     radio.initialize(FREQUENCY,NODEID,NETWORKID);
     radio.setHighPower();
+    #if REPEATER
+        mesh.begin(NODEID, GATEWAYID, true);
+    #endif
     delay(1000);
     #if DEBUG
         Serial.println("ok!");
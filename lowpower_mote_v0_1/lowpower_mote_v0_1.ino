@@ -1,21 +1,24 @@
 #include <LowPower.h>
 #include <RFM69.h>
 #include <SPI.h>
+#include <SleepManager.h>
 
 #define LED 9
 
 RFM69 radio;
+SleepManager sleeper;
 
 void setup() {
   radio.initialize(RF69_915MHZ, 99, 99);
   radio.setHighPower();
   pinMode(LED, OUTPUT);
+  sleeper.setRadio(radio);
+  sleeper.begin();
 }
 
 void loop() {
   digitalWrite(LED, HIGH);
   delay(4000);
   digitalWrite(LED, LOW);
-  radio.sleep();
-  LowPower.powerDown(SLEEP_4S, ADC_OFF, BOD_OFF);
+  sleeper.sleepFor(4000);
 }
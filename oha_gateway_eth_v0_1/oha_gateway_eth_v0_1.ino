@@ -17,7 +17,7 @@
 #include <Wire.h>
 
 #include <Message.h>
-#include <ArduinoJson.h>
+#include <JsonWriter.h>
 
 
 #define VERSION "v0.1"
@@ -203,25 +203,30 @@ void receiveFromWire(int howMany) {
 //
 void sendToMQTT() {
   
-  memset(i2cbuf, 0, sizeof(i2cbuf));
-    
-  // format message as json
-  StaticJsonBuffer<200> jsonBuffer;
-  JsonObject& root = jsonBuffer.createObject();
-  root["direction"] = msgI2C.msg.direction;
-  root["type"] = msgI2C.msg.type;
-  root["source"] = msgI2C.msg.source;
-  root["destination"] = msgI2C.msg.destination;
-  root["rssi"] = msgI2C.msg.rssi;
-  JsonArray& data = root.createNestedArray("data");
+  // format message as json, straight into the publish buffer
+  BufferPrint out(i2cbuf, sizeof(i2cbuf));
+  JsonWriter json(out);
+  JsonObjectWriter root(json);
+  root.add(F("direction"), msgI2C.msg.direction);
+  root.add(F("type"), msgI2C.msg.type);
+  root.add(F("source"), msgI2C.msg.source);
+  root.add(F("destination"), msgI2C.msg.destination);
+  root.add(F("rssi"), msgI2C.msg.rssi);
+  JsonArrayWriter data(root, F("data"));
   for (int i = 0; i < MSG_DATA_LENGTH; i++) {  
     data.add(msgI2C.msg.data[i]);
   }
-  root.printTo(i2cbuf, sizeof(i2cbuf));
+  data.close();
+  root.close();
+  
+  if (out.overflowed()) {
+    Serial.println("Message too long for buffer, not published!");
+    return;
+  }
   
   #if DEBUG
     Serial.print("i2c -> mqtt: [");
-    root.printTo(Serial);
+    Serial.print(i2cbuf);
     Serial.println("]");
   #endif
     
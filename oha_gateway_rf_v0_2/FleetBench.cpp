@@ -0,0 +1,377 @@
+/* -----------------------------------------------------------------------------
+   OpenHAB RF Gateway Fleet Benchmark
+
+   Runs this gateway sketch, unchanged, against a simulated fleet of motes on
+   the VirtualAir medium and writes one CSV row per fleet size, so its
+   capacity can be plotted across releases. The motes replay the reporting
+   schedules of the field sketches, each on its own clock:
+
+   * freezer  - freezer_mote_v0_3: a 10 s cycle, reporting on change or every
+                30th cycle, and every 2 s cycle while the door is open
+   * laundry  - laundrymote_v0_2: a report every 8 s, every 1 s during a leak
+   * presence - presence_mote_v0_2: a reading every 10 s and alerts on door
+                and motion events (the sketch uses Wi-Fi; replayed over RF)
+   * switch   - switch_node_v0_1: a report every 20 s, sent without an ACK
+
+   Each mote's clock runs up to CLOCK_SKEW_PCT fast or slow, as uncalibrated
+   watchdog sleeps do, and every period is jittered by JITTER_PCT more. A
+   report carries a sequence number and its start time in its data bytes;
+   the gateway's serial output is parsed back into reports, so a report
+   counts as delivered once its JSON line is out of the serial port, and its
+   latency runs from the start of sendWithRetry() to then.
+   With RADIO2 set in the sketch, motes with odd node IDs report on the
+   second radio's channel; with CHANNEL_PLAN that is ChannelPlan's channel
+   1. The motes do not follow channel changes, and no neighbour makes the
+   gateway migrate.
+
+   Columns:
+   * release, motes, seconds          gateway VERSION, fleet size, run length
+   * offered/s, delivered/s, loss %   unique reports started and printed
+   * p50/p90/p99 ms                   report latency percentiles
+   * duplicates                       reports printed again after a lost ACK
+   * overwritten                      frames that replaced an unread RFM69::DATA
+   * serial backlog                   frames missed while writing to a full
+                                      serial buffer
+   * invalid length                   "Invalid payload" lines from the gateway
+   * deaf, collided, link loss        other frames the gateway radio missed
+   * serial blocked %                 share of the run spent waiting on Serial
+
+   The drop columns count frames to the gateway, not reports: a report is
+   only lost when all of its tries are.
+
+   Host only. Arduino builds of the sketch skip this file; to build and run
+   it, from the sketchbook root:
+
+     make -C libraries/VirtualAir/host FleetBench
+     libraries/VirtualAir/host/build/FleetBench > fleet.csv
+
+   The host build stands in for ArduinoJson, so JSON sent to the gateway
+   is never parsed; the bench only reads what the gateway writes.
+----------------------------------------------------------------------------- */
+#ifdef FLEET_BENCH
+
+#include <RFM69.h>
+#include <VirtualAir.h>
+#include <VirtualSerial.h>
+
+// the gateway sketch, with its own setup(), loop() and Serial renamed
+VirtualSerial gatewaySerial;
+#define setup gatewaySetup
+#define loop gatewayLoop
+#define Serial gatewaySerial
+
+// the prototypes the Arduino IDE would generate for the sketch
+static void setup_rf();
+static void setup_serial();
+static void send_ident_msg();
+boolean receiveFromRF();
+boolean receiveFromRF(RFM69& rf);
+RFM69& radioFor(byte node);
+boolean relayed(byte node);
+byte channelFor(byte node);
+void checkChannels();
+boolean receiveFromSerial();
+void sendToRF();
+void sendConfig(byte node);
+void wakeMote(byte node);
+void deliverCommands(byte node);
+boolean awaitReply(byte node);
+void sendToSerial();
+static void reportJsonArena();
+int readline(int readch, char *buffer, int len);
+
+#include "oha_gateway_rf_v0_2.ino"
+#undef setup
+#undef loop
+#undef Serial
+
+#define RUN_MS              600000UL  // simulated time per fleet size
+#define SEED                42
+#define LOSS_PERCENT        1         // link loss, each way
+#define CLOCK_SKEW_PCT      5         // most a mote's clock runs fast or slow
+#define JITTER_PCT          1         // more jitter on each period
+#define FREEZER_HEARTBEAT   30        // freezer cycles between unchanged reports
+#define FREEZER_CHANGE_PCT  10        // freezer cycles whose readings cross a deadband
+#define PRESENCE_MEASURE    10        // presence cycles (1 s) between readings
+#define PRESENCE_EVENT_PCT  2         // presence cycles with a door or motion alert
+#define MAX_MOTES           (VIRTUAL_AIR_NODES - 1)
+#define MAX_REPORTS         65536
+
+const byte fleetSizes[] = { 10, 20, 40, 60, 80, 100, 120 };
+
+enum { FREEZER, LAUNDRY, PRESENCE, SWITCH, PROFILE_END };
+
+typedef struct {
+  uint32_t seq;
+  uint32_t sentAt;
+} Stamp;
+
+typedef struct {
+  RFM69 radio;
+  byte node;
+  byte profile;
+  int skew;               // clock error, in tenths of a percent
+  uint32_t seq;           // last report started
+  uint32_t printed;       // last report seen on the gateway's serial port
+} Mote;
+
+VirtualAir& air = VirtualAir::medium();
+Mote motes[MAX_MOTES];
+
+struct {
+  unsigned long offered;
+  unsigned long delivered;
+  unsigned long duplicates;
+  unsigned long serialBacklog;
+  unsigned long invalidLength;
+  unsigned long deaf;
+  unsigned long collided;
+  unsigned long lost;
+} counts;
+
+unsigned long latencies[MAX_REPORTS];
+
+
+//---------------------------------------------------------------------------//
+// FLEET
+//---------------------------------------------------------------------------//
+
+//------------------------------------------------------------------------------
+// Sleeps for a mote's idea of ms milliseconds.
+//
+static void sleepFor(Mote& mote, unsigned long ms) {
+  long pct = 1000 + mote.skew + (long) air.random(2 * JITTER_PCT * 10 + 1) - JITTER_PCT * 10;
+  mote.radio.sleep();
+  air.wait(ms * pct);
+}
+
+static bool chance(unsigned int percent) {
+  return air.random(100) < percent;
+}
+
+//------------------------------------------------------------------------------
+// Sends one stamped report the way the mote's sketch does.
+//
+static void report(Mote& mote, byte type) {
+  Message msg;
+  Stamp stamp;
+  memset(&msg, 0, sizeof(msg));
+  msg.msg.type = type;
+  msg.msg.source = mote.node;
+  stamp.seq = ++mote.seq;
+  stamp.sentAt = air.millis();
+  memcpy(msg.msg.data, &stamp, sizeof(stamp));
+  counts.offered++;
+  if (mote.profile == SWITCH) {
+    mote.radio.send(NODEID, msg.raw, MSG_LENGTH);
+  } else {
+    mote.radio.sendWithRetry(NODEID, msg.raw, MSG_LENGTH);
+  }
+}
+
+//------------------------------------------------------------------------------
+// A mote: its sketch's schedule, forever.
+//
+static void runMote(void* arg) {
+  Mote& mote = *(Mote*) arg;
+  mote.radio.initialize(FREQUENCY, mote.node, NETWORKID);
+  #if RADIO2
+    if (mote.node & 1) {
+      // half the fleet on the second channel
+      #if CHANNEL_PLAN
+        mote.radio.setFrequency(ChannelPlan::frf(1));
+      #else
+        mote.radio.setFrequency(RADIO2_FRF);
+      #endif
+    }
+  #endif
+  mote.radio.setHighPower();
+  byte cycle = 0;
+  byte alert = 0;         // cycles the open door or leak lasts
+  while (true) {
+    switch (mote.profile) {
+      case FREEZER:
+        if (alert == 0 && chance(1)) alert = 10 + air.random(20);
+        if (alert > 0 || ++cycle >= FREEZER_HEARTBEAT || chance(FREEZER_CHANGE_PCT)) {
+          cycle = 0;
+          report(mote, alert > 0 ? MSG_ALERT : MSG_READING);
+        }
+        sleepFor(mote, alert > 0 ? 2000 : 10000);
+        if (alert > 0) alert--;
+        break;
+      case LAUNDRY:
+        if (alert == 0 && air.random(2000) == 0) alert = 30;
+        report(mote, alert > 0 ? MSG_ALERT : MSG_READING);
+        sleepFor(mote, alert > 0 ? 1000 + 500 : 8000 + 100);
+        if (alert > 0) alert--;
+        break;
+      case PRESENCE:
+        if (++cycle >= PRESENCE_MEASURE) {
+          cycle = 0;
+          report(mote, MSG_READING);
+        }
+        if (chance(PRESENCE_EVENT_PCT)) {
+          report(mote, MSG_ALERT);
+        }
+        sleepFor(mote, 1000);
+        break;
+      case SWITCH:
+        report(mote, MSG_READING);
+        sleepFor(mote, 20000);
+        break;
+    }
+  }
+}
+
+//------------------------------------------------------------------------------
+// The gateway, as on the board.
+//
+static void runGateway(void* arg) {
+  gatewaySetup();
+  while (true) {
+    gatewayLoop();
+  }
+}
+
+
+//---------------------------------------------------------------------------//
+// ACCOUNTING
+//---------------------------------------------------------------------------//
+
+//------------------------------------------------------------------------------
+// Sorts the frames the gateway radios missed by cause.
+//
+static void observe(const VirtualFrame& frame, VirtualRadio* to, uint8_t outcome) {
+  #if RADIO2
+    if (to != &radio && to != &radio2) {
+      return;
+    }
+  #else
+    if (to != &radio) {
+      return;
+    }
+  #endif
+  switch (outcome) {
+    case VIRTUAL_AIR_DEAF:
+      if (gatewaySerial.blocked()) {
+        counts.serialBacklog++;
+      } else {
+        counts.deaf++;
+      }
+      break;
+    case VIRTUAL_AIR_COLLIDED:
+      counts.collided++;
+      break;
+    case VIRTUAL_AIR_LOST:
+      counts.lost++;
+      break;
+  }
+}
+
+//------------------------------------------------------------------------------
+// Reads a report back out of a line the gateway wrote to its serial port.
+//
+static void serialLine(void* context, const char* line, uint64_t sentAt) {
+  const char* invalid = line;
+  while ((invalid = strstr(invalid, "Invalid payload")) != NULL) {
+    counts.invalidLength++;
+    invalid++;
+  }
+  const char* src = strstr(line, "\"src\":");
+  const char* data = strstr(line, "\"data\":[");
+  if (src == NULL || data == NULL) {
+    return;
+  }
+  int node = atoi(src + 6);
+  if (node <= NODEID || node > NODEID + MAX_MOTES) {
+    return;
+  }
+  Mote& mote = motes[node - NODEID - 1];
+  byte bytes[MSG_DATA_LENGTH];
+  data += 8;
+  for (byte i = 0; i < MSG_DATA_LENGTH && data != NULL; i++) {
+    bytes[i] = atoi(data);
+    data = strchr(data, ',');
+    if (data) data++;
+  }
+  Stamp stamp;
+  memcpy(&stamp, bytes, sizeof(stamp));
+  if (stamp.seq <= mote.printed) {
+    counts.duplicates++;
+    return;
+  }
+  mote.printed = stamp.seq;
+  if (counts.delivered < MAX_REPORTS) {
+    latencies[counts.delivered] = sentAt / 1000 - stamp.sentAt;
+  }
+  counts.delivered++;
+}
+
+static int compare(const void* a, const void* b) {
+  unsigned long x = *(const unsigned long*) a, y = *(const unsigned long*) b;
+  return (x > y) - (x < y);
+}
+
+static unsigned long percentile(byte p) {
+  unsigned long n = counts.delivered < MAX_REPORTS ? counts.delivered : MAX_REPORTS;
+  return n ? latencies[(n - 1) * p / 100] : 0;
+}
+
+
+//---------------------------------------------------------------------------//
+// DRIVER
+//---------------------------------------------------------------------------//
+
+void setup() {
+  air.seed(SEED);
+  air.setDefaultLink(LOSS_PERCENT, VIRTUAL_AIR_RSSI);
+  air.setObserver(observe);
+  gatewaySerial.setLineHook(serialLine);
+  printf("release,motes,seconds,offered_per_s,delivered_per_s,loss_pct,p50_ms,p90_ms,"
+         "p99_ms,duplicates,overwritten,serial_backlog,invalid_length,deaf,collided,"
+         "link_loss,serial_blocked_pct\n");
+
+  for (byte f = 0; f < sizeof(fleetSizes); f++) {
+    byte fleet = fleetSizes[f];
+    air.reset();
+    gatewaySerial.reset();
+    memset(&counts, 0, sizeof(counts));
+
+    // let the gateway boot before the fleet starts reporting
+    air.spawn(runGateway, NULL);
+    air.run(air.now() + 2000000ULL);
+    uint64_t start = air.now();
+    uint64_t blocked = gatewaySerial.blockedUs;
+    for (byte i = 0; i < fleet; i++) {
+      Mote& mote = motes[i];
+      mote.node = NODEID + 1 + i;
+      mote.profile = i % PROFILE_END;
+      mote.skew = (int) air.random(2 * CLOCK_SKEW_PCT * 10 + 1) - CLOCK_SKEW_PCT * 10;
+      mote.seq = mote.printed = 0;
+      air.spawn(runMote, &mote, air.random(10000) * 1000ULL);
+    }
+    air.run(start + RUN_MS * 1000ULL);
+
+    unsigned long n = counts.delivered < MAX_REPORTS ? counts.delivered : MAX_REPORTS;
+    qsort(latencies, n, sizeof(latencies[0]), compare);
+    unsigned long overwritten = radio.airStats.overwritten;
+    #if RADIO2
+      overwritten += radio2.airStats.overwritten;
+    #endif
+    double seconds = RUN_MS / 1000.0;
+    printf("%s,%u,%.0f,%.2f,%.2f,%.2f,%lu,%lu,%lu,%lu,%lu,%lu,%lu,%lu,%lu,%lu,%.2f\n",
+           VERSION, fleet, seconds,
+           counts.offered / seconds, counts.delivered / seconds,
+           counts.offered ? 100.0 * (counts.offered - counts.delivered) / counts.offered : 0.0,
+           percentile(50), percentile(90), percentile(99),
+           counts.duplicates, overwritten, counts.serialBacklog,
+           counts.invalidLength, counts.deaf, counts.collided, counts.lost,
+           100.0 * (gatewaySerial.blockedUs - blocked) / (air.now() - start));
+  }
+}
+
+void loop() {
+  air.wait(1000000);
+}
+
+#endif // FLEET_BENCH
@@ -4,9 +4,42 @@
    Transfers messages between an RF Mesh and the Serial port ina bi-directional
    manner. Messages on the RF Mesh use the Message structure, whereas messages 
    on the Serial port are in JSON form.
+   
+   MSG_CONFIG messages (over-the-air config ops) from the Serial port go
+   straight to the node, as other messages do, until it fails to ACK one:
+   it is then taken for a battery mote that keeps its radio asleep, and its
+   config ops are queued until its next report. The ACK to the report
+   carries the number pending, which tells the mote to hold a short receive
+   window open while they are delivered.
+   With LISTEN_WAKEUP, a newly queued op is first sent as a wake-up burst, which
+   a mote sleeping in RFM69 listen mode hears within one listen cycle and
+   answers; only if no answer comes does it wait for the next report. The
+   gateway hears nothing else while a burst is on the air, over half a
+   second at the default listen cycle, so only set it for a fleet whose
+   sleeping motes listen (freezer_mote_v0_3 with LISTEN_MODE).
+   Every ACK also echoes the RSSI the report was heard at, which motes use
+   to turn their transmit power down (see PowerControl).
+   With RADIO2, a second RFM69 listens on a channel of its own, so motes
+   can be split between two channels and the gateway receives on both at
+   once. Each mote is answered on the radio it was last heard on.
+   With CHANNEL_PLAN, the radios take channels from ChannelPlan's plan
+   instead; every ACK tells the mote its channel, odd nodes radio2's, and a
+   radio whose channel a neighbour has taken moves to the quietest free
+   one. Its motes find it again by rejoining.
+   With MESH, reports may also come in over mains-powered repeaters (see
+   MeshRouter), and the gateway beacons so that repeaters find it. A
+   repeater's ACK does not carry the number of commands pending, so
+   commands for a mote heard through one wait until it is heard directly.
+   With SLOT_SCHEDULE, the gateway beacons the start of every superframe
+   and hands periodic motes a slot of their own to report in, so that
+   their reports stop colliding (see SlotSchedule). Only the first radio
+   beacons.
  
    Circuit:
    * FTDI port connects to host for Serial communcations and programming
+   * RFM69 on the SPI bus, CS on digital pin 10 and DIO0 on digital pin 2
+   * With RADIO2, a second RFM69 with CS on digital pin 8 and DIO0 on
+     digital pin 3
    * Heartbeat LED attached to digital pin 9
    * RF Status LED attached to digital pin 12
    * Serial Status LED attached to digital pin 13
@@ -15,19 +48,33 @@
 ----------------------------------------------------------------------------- */
 #include <SPI.h>
 #include <RFM69.h>
+#include <ChannelPlan.h>
+#include <MeshRouter.h>
+#include <SlotSchedule.h>
 #include <Message.h>
+#include <CommandQueue.h>
 #include <ArduinoJson.h>
+#include <JsonArena.h>
+#include <JsonWriter.h>
 
 
 #define VERSION "v0.2"
 
 #define SERIAL          1   // set to 1 to also report readings on the serial port
 #define DEBUG           1   // set to 1 to display each loop() run
+#define LISTEN_WAKEUP   0   // set to 1 to wake motes in listen mode for new config ops
+#define RADIO2          0   // set to 1 to receive on a second RFM69 as well
+#define CHANNEL_PLAN    0   // set to 1 to assign motes channels and leave busy ones
+#define MESH            0   // set to 1 to take reports relayed by repeaters
+#define SLOT_SCHEDULE   0   // set to 1 to beacon superframes and give motes report slots
 #define BAUD_RATE       57600
 
 #define NODEID          1   // unique for each node on same network
 #define NETWORKID       99  // same for all nodes that talk to each other
 #define FREQUENCY       RF69_915MHZ
+#define RADIO2_CS       8   // second radio's chip select...
+#define RADIO2_IRQ      3   // ...and DIO0, on INT1
+#define RADIO2_FRF      0xE54000  // 917MHz, its channel in 61.035Hz steps (see RFM69::setFrequency)
 
 #define DPIN_MOTE_LED   9   // heartbeat
 #define DPIN_RFM_LED    12  // rf message indicator
@@ -35,14 +82,40 @@
 
 #define MAX_BUFFER_SIZE MSG_DATA_LENGTH * 10
 
+#define REPLY_TIMEOUT   150 // ms to wait for a mote to answer a command
+#define JSON_ARENA_SIZE 200 // bytes for parsing json received on the serial port
+
 
 // RF configuration
 RFM69 radio;
+#if RADIO2
+  RFM69 radio2(RADIO2_CS, RADIO2_IRQ);
+  byte radio2Nodes[32];     // bit per node, set if last heard on radio2
+#endif
+#if CHANNEL_PLAN
+  ChannelPlan channels(radio);
+  #if RADIO2
+    ChannelPlan channels2(radio2);
+  #endif
+#endif
+#if MESH
+  MeshRouter mesh(radio);
+#endif
+#if SLOT_SCHEDULE
+  SlotSchedule slots(radio);
+#endif
 
 // Messages & buffers
 Message rfMsg, serialMsg;
 char serialBuffer[MAX_BUFFER_SIZE];
 
+// config ops waiting for their mote to check in
+CommandQueue commands;
+byte asleepNodes[32];       // bit per node, set once it missed a config op
+
+// inbound json documents are parsed in one static pool instead of on the stack
+typedef ArenaJsonBuffer<JSON_ARENA_SIZE> JsonBufferArena;
+
 
 //---------------------------------------------------------------------------// 
 // SETUP
@@ -61,9 +134,32 @@ void setup() {
 // Initializes the RF radio communications.
 //
 static void setup_rf() {
+  #if RADIO2
+    // deselect radio2 before radio talks on the bus
+    digitalWrite(RADIO2_CS, HIGH);
+    pinMode(RADIO2_CS, OUTPUT);
+  #endif
   radio.initialize(FREQUENCY, NODEID, NETWORKID);
   radio.setHighPower();
+  #if CHANNEL_PLAN
+    channels.begin(0);
+  #endif
+  #if RADIO2
+    radio2.initialize(FREQUENCY, NODEID, NETWORKID);
+    #if CHANNEL_PLAN
+      channels2.begin(1);
+    #else
+      radio2.setFrequency(RADIO2_FRF);
+    #endif
+    radio2.setHighPower();
+  #endif
+  #if MESH
+    mesh.begin(NODEID, NODEID);
+  #endif
   delay(1000);
+  #if SLOT_SCHEDULE
+    slots.begin();
+  #endif
 }
 
 //------------------------------------------------------------------------------
@@ -74,16 +170,20 @@ static void setup_serial() {
 }
 
 static void send_ident_msg() {
-  StaticJsonBuffer<200> jsonBuffer;
-  JsonObject& root = jsonBuffer.createObject();
-  root["type"] = MSG_BOOTSTRAP;
-  root["id"] = "OHA RF Gateway";
-  root["version"] = VERSION;
-  JsonObject& rf = root.createNestedObject("rf");
-  rf["nodeID"] = NODEID;
-  rf["networkID"] = NETWORKID;
-  rf["frequency"] = FREQUENCY;
-  root.printTo(Serial);
+  JsonWriter json(Serial);
+  JsonObjectWriter root(json);
+  root.add(F("type"), MSG_BOOTSTRAP);
+  root.add(F("id"), F("OHA RF Gateway"));
+  root.add(F("version"), F(VERSION));
+  JsonObjectWriter rf(root, F("rf"));
+  rf.add(F("nodeID"), NODEID);
+  rf.add(F("networkID"), NETWORKID);
+  rf.add(F("frequency"), FREQUENCY);
+  #if RADIO2
+    rf.add(F("frf2"), RADIO2_FRF);
+  #endif
+  rf.close();
+  root.close();
   Serial.println();
 }
 
@@ -100,6 +200,7 @@ void loop() {
   // process inbound RF message
   if (receiveFromRF()) {
     sendToSerial();
+    deliverCommands(rfMsg.msg.source);
   }
     
   // process inbound Serial message
@@ -107,36 +208,180 @@ void loop() {
     sendToRF();
   }
 
+  #if CHANNEL_PLAN
+    checkChannels();
+  #endif
+
+  #if MESH
+    mesh.poll();
+  #endif
+
+  #if DEBUG
+    reportJsonArena();
+  #endif
+
 }
 
 //------------------------------------------------------------------------------
-// Receives a message from the RF mesh
+// Receives a message from the RF mesh. With RADIO2, the radio polled first
+// alternates, so that neither can keep the other's frames waiting. With
+// SLOT_SCHEDULE, a superframe beacon due is sent first, so that beacons go
+// out on time while a reply is awaited too.
 //
 boolean receiveFromRF() {
+  #if SLOT_SCHEDULE
+    slots.poll();
+  #endif
+  #if RADIO2
+    static boolean second = false;
+    second = !second;
+    return receiveFromRF(second ? radio2 : radio) || receiveFromRF(second ? radio : radio2);
+  #else
+    return receiveFromRF(radio);
+  #endif
+}
+
+//------------------------------------------------------------------------------
+// Receives a message from one radio, and remembers it as the sender's. With
+// MESH, routed frames on the first radio go to MeshRouter, which ACKs them
+// itself and hands back the reports addressed to the gateway.
+//
+boolean receiveFromRF(RFM69& rf) {
   boolean haveData = false;
-  if (radio.receiveDone()) {
-    if (radio.DATALEN != sizeof(Message)) {
+  if (rf.receiveDone()) {
+    #if SLOT_SCHEDULE
+      if (&rf == &radio && slots.receive()) {
+        return false;
+      }
+    #endif
+    #if MESH
+      if (&rf == &radio) {
+        byte frame = mesh.receive();
+        if (frame == MESH_HANDLED) {
+          return false;
+        }
+        if (frame == MESH_DELIVERED) {
+          if (mesh.dataLength() != sizeof(Message)) {
+            Serial.print("Invalid payload relayed, not matching Message struct!");
+            return false;
+          }
+          memcpy(&rfMsg, mesh.data(), sizeof rfMsg);
+          rfMsg.msg.rssi = rf.RSSI;
+          return true;
+        }
+      }
+    #endif
+    #if RADIO2
+      byte node = rf.SENDERID;
+      if (&rf == &radio2) {
+        radio2Nodes[node >> 3] |= 1 << (node & 7);
+      } else {
+        radio2Nodes[node >> 3] &= ~(1 << (node & 7));
+      }
+    #endif
+    if (rf.DATALEN != sizeof(Message)) {
       Serial.print("Invalid payload received, not matching Message struct!");
     } else {
-      memcpy(&rfMsg, (byte*) radio.DATA, sizeof rfMsg);
-      rfMsg.msg.rssi = radio.RSSI;
+      memcpy(&rfMsg, (byte*) rf.DATA, sizeof rfMsg);
+      rfMsg.msg.rssi = rf.RSSI;
       haveData = true;
     }
-    if (radio.ACK_REQUESTED) {
-      radio.sendACK();
+    if (rf.ACK_REQUESTED) {
+      AckRecord ack;
+      ack.pending = commands.pending(rf.SENDERID);
+      ack.rssi = rf.RSSI;
+      ack.channel = channelFor(rf.SENDERID);
+      rf.sendACK(&ack, sizeof(ack));
     }
   }
   return haveData;
 }
 
+//------------------------------------------------------------------------------
+// The radio a node was last heard on; the first for a node not heard yet.
+//
+RFM69& radioFor(byte node) {
+  #if RADIO2
+    if (radio2Nodes[node >> 3] & (1 << (node & 7))) {
+      return radio2;
+    }
+  #endif
+  return radio;
+}
+
+//------------------------------------------------------------------------------
+// Whether a node was last heard through a repeater, and so cannot be sent
+// commands until it is heard directly again.
+//
+boolean relayed(byte node) {
+  #if MESH
+    byte next = mesh.nextHop(node);
+    return next != MESH_NO_ROUTE && next != node;
+  #else
+    return false;
+  #endif
+}
+
+//------------------------------------------------------------------------------
+// The channel a node is to use, announced in every ACK: with two radios,
+// odd nodes go to radio2's, so the motes spread over both.
+//
+byte channelFor(byte node) {
+  #if CHANNEL_PLAN && RADIO2
+    return (node & 1) ? channels2.channel() : channels.channel();
+  #elif CHANNEL_PLAN
+    return channels.channel();
+  #else
+    return ACK_NO_CHANNEL;
+  #endif
+}
+
+#if CHANNEL_PLAN
+//------------------------------------------------------------------------------
+static void reportChannel(ChannelPlan& plan) {
+  #if DEBUG
+    Serial.print("Channel busy, radio moved to channel ");
+    Serial.println(plan.channel());
+  #endif
+}
+
+//------------------------------------------------------------------------------
+// Samples each radio's channel, and moves a radio off its channel once
+// interference has taken it, to one the other radio is not on.
+//
+void checkChannels() {
+  channels.sample();
+  #if RADIO2
+    channels2.sample();
+    if (channels2.bad()) {
+      channels2.migrate(1 << channels.channel());
+      reportChannel(channels2);
+    }
+    if (channels.bad()) {
+      channels.migrate(1 << channels2.channel());
+      reportChannel(channels);
+    }
+  #else
+    if (channels.bad()) {
+      channels.migrate();
+      reportChannel(channels);
+    }
+  #endif
+}
+#endif
+
 //------------------------------------------------------------------------------
 // Receives a message from the Serial port.
 //
 boolean receiveFromSerial() {
   boolean haveData = false;
   if (readline(Serial.read(), serialBuffer, MAX_BUFFER_SIZE) > 0) {
-    StaticJsonBuffer<200> jsonBuffer;
+    JsonBufferArena jsonBuffer;
     JsonObject& root = jsonBuffer.parseObject(serialBuffer);
+    if (!root.success()) {
+      Serial.println("Invalid json received, message dropped!");
+      return false;
+    }
     serialMsg.msg.type = root["type"];
     serialMsg.msg.source = root["src"];
     serialMsg.msg.destination = root["dest"];
@@ -154,7 +399,97 @@ boolean receiveFromSerial() {
 // Publishes an I2C message to the RF mesh.
 //
 void sendToRF() {
-  radio.send(serialMsg.msg.destination, serialMsg.raw, MSG_LENGTH);
+  if (serialMsg.msg.type == MSG_CONFIG) {
+    sendConfig(serialMsg.msg.destination);
+  } else if (serialMsg.msg.destination == RF69_BROADCAST_ADDR) {
+    radio.send(RF69_BROADCAST_ADDR, serialMsg.raw, MSG_LENGTH);
+    #if RADIO2
+      radio2.send(RF69_BROADCAST_ADDR, serialMsg.raw, MSG_LENGTH);
+    #endif
+  } else {
+    radioFor(serialMsg.msg.destination).send(serialMsg.msg.destination, serialMsg.raw, MSG_LENGTH);
+  }
+}
+
+//------------------------------------------------------------------------------
+// Sends a config op straight to a node that is awake, and relays its reply.
+// A node that does not ACK it is asleep: the op, and every later one for the
+// node, waits in the queue for its next report.
+//
+void sendConfig(byte node) {
+  byte bit = 1 << (node & 7);
+  if (!(asleepNodes[node >> 3] & bit) && !relayed(node)) {
+    if (radioFor(node).sendWithRetry(node, serialMsg.raw, MSG_LENGTH)) {
+      awaitReply(node);
+      return;
+    }
+    asleepNodes[node >> 3] |= bit;
+  }
+  if (!commands.push(serialMsg)) {
+    Serial.println("Command queue full, command dropped!");
+    return;
+  }
+  #if LISTEN_WAKEUP
+    wakeMote(node);
+  #endif
+}
+
+//------------------------------------------------------------------------------
+// Delivers commands queued for a mote that has just checked in, one at a
+// time, relaying each reply to the Serial port before sending the next. A
+// command the mote does not acknowledge goes back in the queue for its next
+// report.
+//
+void deliverCommands(byte node) {
+  Message command;
+  if (relayed(node)) {
+    return;
+  }
+  while (commands.pop(node, command)) {
+    if (!radioFor(node).sendWithRetry(node, command.raw, MSG_LENGTH)) {
+      commands.push(command);
+      return;
+    }
+    if (!awaitReply(node)) {
+      return;
+    }
+  }
+}
+
+//------------------------------------------------------------------------------
+// Sends the oldest command queued for a mote as a wake-up burst, for a mote
+// sleeping in listen mode, and delivers the rest once it answers. The burst
+// ends only after the mote's receive window has come round, and the mote
+// answers once it is over. A mote that does not listen misses the burst and
+// gets the command with its next report.
+//
+void wakeMote(byte node) {
+  Message command;
+  if (relayed(node) || !commands.pop(node, command)) {
+    return;
+  }
+  if (!radioFor(node).sendBurst(node, command.raw, MSG_LENGTH) || !awaitReply(node)) {
+    commands.push(command);
+    return;
+  }
+  deliverCommands(node);
+}
+
+//------------------------------------------------------------------------------
+// Waits for a mote's answer to a command. The ACK sent by receiveFromRF()
+// tells the mote how many commands are still queued.
+//
+boolean awaitReply(byte node) {
+  unsigned long start = millis();
+  while (millis() - start < REPLY_TIMEOUT) {
+    if (receiveFromRF()) {
+      sendToSerial();
+      if (rfMsg.msg.source == node) {
+        return true;
+      }
+    }
+  }
+  return false;
 }
 
 //------------------------------------------------------------------------------
@@ -162,21 +497,20 @@ void sendToRF() {
 //
 void sendToSerial() {
     
-  // format message as json
-  StaticJsonBuffer<200> jsonBuffer;
-  JsonObject& root = jsonBuffer.createObject();
-  root["type"] = rfMsg.msg.type;
-  root["src"] = rfMsg.msg.source;
-  root["dest"] = rfMsg.msg.destination;
-  root["comp"] = rfMsg.msg.component;
-  root["rssi"] = rfMsg.msg.rssi;
-  JsonArray& data = root.createNestedArray("data");
+  // stream message as json, straight to the serial port
+  JsonWriter json(Serial);
+  JsonObjectWriter root(json);
+  root.add(F("type"), rfMsg.msg.type);
+  root.add(F("src"), rfMsg.msg.source);
+  root.add(F("dest"), rfMsg.msg.destination);
+  root.add(F("comp"), rfMsg.msg.component);
+  root.add(F("rssi"), rfMsg.msg.rssi);
+  JsonArrayWriter data(root, F("data"));
   for (int i = 0; i < MSG_DATA_LENGTH; i++) {  
     data.add(rfMsg.msg.data[i]);
   }
-
-  // generate json string to serial port
-  root.printTo(Serial);
+  data.close();
+  root.close();
   Serial.println();
   
 }
@@ -186,6 +520,27 @@ void sendToSerial() {
 // SUPPORT METHODS
 //---------------------------------------------------------------------------// 
 
+//------------------------------------------------------------------------------
+// Reports each new high-water mark of the json arena, to help tune
+// JSON_ARENA_SIZE against real traffic. It goes out as an MSG_INFO object,
+// so that it does not break the json stream the serial port carries.
+//
+static void reportJsonArena() {
+  static size_t reported = 0;
+  if (JsonBufferArena::highWater() > reported) {
+    reported = JsonBufferArena::highWater();
+    JsonWriter json(Serial);
+    JsonObjectWriter root(json);
+    root.add(F("type"), MSG_INFO);
+    root.add(F("id"), F("json arena"));
+    root.add(F("highWater"), reported);
+    root.add(F("capacity"), JsonBufferArena::capacity());
+    root.add(F("failures"), JsonBufferArena::failures());
+    root.close();
+    Serial.println();
+  }
+}
+
 //------------------------------------------------------------------------------
 // Reads a line from the Serial port.
 //
@@ -61,6 +61,10 @@ void MQTT::setup() {
   _mountFFS();
   _setupWifi();
   _writeConfig();
+  Serial.print("config json high water - ");
+  Serial.print(MQTTJsonBuffer::highWater());
+  Serial.print("/");
+  Serial.println(MQTTJsonBuffer::capacity());
   Serial.print("local ip - "); Serial.println(WiFi.localIP());
   _setupMQTT();
 }
@@ -88,7 +92,7 @@ void MQTT::_mountFFS() {
         std::unique_ptr<char[]> buf(new char[size]);
 
         configFile.readBytes(buf.get(), size);
-        DynamicJsonBuffer jsonBuffer;
+        MQTTJsonBuffer jsonBuffer;
         JsonObject& json = jsonBuffer.parseObject(buf.get());
         json.printTo(Serial);
         if (json.success()) {
@@ -156,7 +160,7 @@ void MQTT::_setupWifi() {
 //
 void MQTT::_writeConfig() {
   Serial.print("saving config - ");
-  DynamicJsonBuffer jsonBuffer;
+  MQTTJsonBuffer jsonBuffer;
   JsonObject& json = jsonBuffer.createObject();
   json["mqtt_server"] = _mqttServer;
   json["mqtt_port"] = _mqttPort;
@@ -13,8 +13,13 @@
 #include <ESP8266WebServer.h>
 #include <WiFiManager.h>
 #include <ArduinoJson.h>
+#include <JsonArena.h>
 #include <PubSubClient.h>
 
+#define MQTT_JSON_ARENA_SIZE 512  // config.json is parsed and written one at a time
+
+typedef ArenaJsonBuffer<MQTT_JSON_ARENA_SIZE> MQTTJsonBuffer;
+
 class MQTT
 {
   public:
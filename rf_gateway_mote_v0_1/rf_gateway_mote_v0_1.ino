@@ -39,6 +39,9 @@ MessageData inbound, outbound;
 char embuf[MSG_LENGTH * 8];
 EmBdecode decoder(embuf, sizeof embuf);
 
+char txbuf[MSG_LENGTH * 8];
+EmBencodeBuf encoder(txbuf, sizeof txbuf);
+
 
 //------------------------------------------------------------------------------
 // setup the arduino board
@@ -88,7 +91,6 @@ void loop() {
 // consume inbound RF message
 //
 static void consumeRf() {
-    EmBencode encoder;
     encoder.startList();
     encoder.push(inbound.msg.msgtype);
     encoder.push(inbound.msg.network);
@@ -99,6 +101,7 @@ static void consumeRf() {
     }
     encoder.endList();
     encoder.endList();
+    encoder.flush(Serial);
     Serial.println();
 }
 
@@ -182,8 +185,3 @@ static void setup_radio() {
     radio.initialize(FREQUENCY,NODEID,NETWORKID);
     radio.setHighPower();
 }
-
-//------------------------------------------------------------------------------
-void EmBencode::PushChar (char ch) {
-  Serial.write(ch);
-}
@@ -36,8 +36,10 @@ RFM69 radio;
 
 EventMessage inbound, outbound;
 
-char embuf[EVENT_LENGTH * 8];
-EmBdecode decoder(embuf, sizeof embuf);
+EmBextract extractor(outbound.raw, EVENT_LENGTH, offsetof(EventRecord, data));
+
+char txbuf[EVENT_LENGTH * 8];
+EmBencodeBuf encoder(txbuf, sizeof txbuf);
 
 
 //----------------------------------------------------------------------------- 
@@ -114,7 +116,6 @@ void loop() {
 // consume inbound RF message
 //
 static void consumeRf() {
-    EmBencode encoder;
     encoder.startList();
     encoder.push(inbound.event.type);
     encoder.push(inbound.event.network);
@@ -126,6 +127,7 @@ static void consumeRf() {
     }
     encoder.endList();
     encoder.endList();
+    encoder.flush(Serial);
     Serial.println();
 }
 
@@ -133,35 +135,18 @@ static void consumeRf() {
 // generate outbound RF data
 //
 static boolean consumeSerial() {
-  boolean pendingOutbound = false;
-  if (Serial.available() > 0) {
-      char ch = Serial.read();
-      uint8_t bytes = decoder.process(ch);
-      if (bytes > 0) {
-          pendingOutbound = true;
-          uint8_t i = 0;
-          while (i < EVENT_LENGTH) {
-              uint8_t token = decoder.nextToken();
-              if (token == EmBdecode::T_END) {
-                  break;
-              }
-              switch (token) {
-                  case EmBdecode::T_NUMBER:
-                      outbound.raw[i++] = decoder.asNumber();
-                      break;
-                  case EmBdecode::T_LIST:
-                      break;
-              }
-          }
-          decoder.reset();
-          if (i < EVENT_LENGTH) {
-              for (int j = i; j < EVENT_LENGTH; j++) {
-                  outbound.raw[j] = 0x00;
-              }
-          }
+  while (Serial.available() > 0) {
+      switch (extractor.process(Serial.read())) {
+          case EmBextract::X_DONE:
+              return true;
+          case EmBextract::X_ERROR:
+              #if DEBUG
+                  Serial.println("Malformed serial message dropped");
+              #endif
+              break;
       }
   }
-  return pendingOutbound;
+  return false;
 }
 
 //------------------------------------------------------------------------------
@@ -178,8 +163,3 @@ static void setup_radio() {
         Serial.println("ok!");
     #endif
 }
-
-//------------------------------------------------------------------------------
-void EmBencode::PushChar (char ch) {
-  Serial.write(ch);
-}
@@ -8,19 +8,14 @@
 
 #include "Arduino.h"
 #include "Sensor.h"
+#include <AdcSampler.h>
 
-class BatterySensor : public Sensor {
+template <byte Pin>
+class BatterySensor : public Sensor<BatterySensor<Pin> > {
   public:
-    inline BatterySensor(byte userPin) { 
-      _pin = userPin; 
+    inline int read() {
+      return AdcSampler::toByte(Adc.sample(Pin));
     }
-    virtual int read(); 
-  private:
-    byte _pin;
 };
 
-int BatterySensor::read() {
-  return map(analogRead(_pin), 0, 1023, 0, 255);
-}
-
 #endif
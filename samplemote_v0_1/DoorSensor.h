@@ -12,22 +12,16 @@
 #define NC_SWITCH false
 #define NO_SWITCH true
 
-class DoorSensor : public Sensor {
+template <byte Pin, bool Mode = NO_SWITCH>
+class DoorSensor : public Sensor<DoorSensor<Pin, Mode> > {
   public:
-    inline DoorSensor(byte userPin, bool mode = NO_SWITCH) { 
-      _pin = userPin;
-      _mode = mode;
-      pinMode(_pin, INPUT);
+    inline void begin() {
+      pinMode(Pin, INPUT);
+    }
+    inline int read() {
+      bool value = digitalRead(Pin);
+      return (Mode) ? value : !value;
     }
-    virtual int read(); 
-  private:
-    byte _pin;
-    boolean _mode;
 };
 
-int DoorSensor::read() {
-  bool value = digitalRead(_pin);
-  return (_mode) ? value : !value;
-}
-
 #endif
@@ -7,7 +7,9 @@
 #define FreezerMote_h  
 
 #include "Arduino.h"
+#include <util/atomic.h>
 #include "Mote.h"
+#include "SensorList.h"
 #include <Message.h>
 
 #include "BatterySensor.h"
@@ -21,59 +23,41 @@
 #define TEMP_INSIDE_PIN      A2
 #define TEMP_OUTSIDE_PIN     A3
 
-#define VOLTAGE              3.3
+#define VOLTAGE_MV           3300
 #define WARNING_PERIOD_IN_S  10
 
-typedef struct SensorData {
-  union {
-    byte raw[MSG_DATA_LENGTH];
-    struct {
-      byte battery;      // battery voltage
-      byte tempInside;   // temperature sensor: C * 10
-      byte tempOutside;  // temperature sensor: C * 10
-      byte light;        // light sensor: 0..255
-      byte door;         // 0 or 1
-    };
-  };
-};
+typedef BatterySensor<BATTERY_PIN> Battery;
+typedef DoorSensor<DOOR_PIN> Door;
+typedef LightSensor<LIGHT_PIN> Light;
+typedef TemperatureSensor<TEMP_INSIDE_PIN, VOLTAGE_MV> TempInside;
+typedef TemperatureSensor<TEMP_OUTSIDE_PIN, VOLTAGE_MV> TempOutside;
+
+// payload order: battery, tempInside, tempOutside, light, door
+typedef SensorList<Battery, TempInside, TempOutside, Light, Door> FreezerSensors;
 
 typedef struct FreezerMoteConfig : MoteConfig {
 }; 
 
-class FreezerMote : public Mote {
+class FreezerMote : public Mote<FreezerMote, FreezerSensors> {
+  friend class Mote<FreezerMote, FreezerSensors>;
   public:
     FreezerMote(const char* name, const char* version, FreezerMoteConfig* config, bool init);
-    ~FreezerMote();
-    virtual void measure();
   protected:
-    virtual unsigned int calculateLedDelay();
-    virtual byte calculateMessageLevel();
-    virtual byte* sensorData();
-    virtual void setupPorts();
+    unsigned int calculateLedDelay();
+    byte calculateMessageLevel();
+    void printReadings();
+    void setupPorts();
   private:
     bool isAlert();
     bool isNormal();
-    BatterySensor* _battery;
-    DoorSensor* _door;
-    LightSensor* _light;
-    TemperatureSensor* _tempInside;
-    TemperatureSensor* _tempOutside;
-    SensorData _sensorData;
+    inline byte reading(byte offset) { return _sensorData[offset]; }
 };
 
 //-----------------------------------------------------------------------------
 // API Methods
 //-----------------------------------------------------------------------------
-FreezerMote::FreezerMote(const char* name, const char* version, FreezerMoteConfig* config, bool init = false) : Mote(name, version, config, init) {
-  _battery = new BatterySensor(BATTERY_PIN);
-  _door = new DoorSensor(DOOR_PIN);
-  _light = new LightSensor(LIGHT_PIN);
-  _tempInside = new TemperatureSensor(TEMP_INSIDE_PIN, VOLTAGE);
-  _tempOutside = new TemperatureSensor(TEMP_OUTSIDE_PIN, VOLTAGE);
-}
-
-FreezerMote::~FreezerMote() {
-  delete _battery, _door, _light, _tempInside, _tempOutside;
+FreezerMote::FreezerMote(const char* name, const char* version, FreezerMoteConfig* config, bool init = false) 
+  : Mote<FreezerMote, FreezerSensors>(name, version, config, init) {
 }
 
 
@@ -97,38 +81,32 @@ byte FreezerMote::calculateMessageLevel() {
 }
 
 bool FreezerMote::isAlert() {
-  return millis() > _lastIntrTime + (WARNING_PERIOD_IN_S * 1000);
+  unsigned long lastIntrTime;
+  ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+    lastIntrTime = _lastIntrTime;   // four bytes, written by the door ISR
+  }
+  return millis() > lastIntrTime + (WARNING_PERIOD_IN_S * 1000);
 }
 
 bool FreezerMote::isNormal() {
-  return _sensorData.door;
+  return reading(FreezerSensors::Offset<Door>::VALUE);
 }
 
-void FreezerMote::measure() {
-  memset(&_sensorData, 0, sizeof(_sensorData));
-  _sensorData.battery = _battery->read();
-  _sensorData.door = _door->read();
-  _sensorData.light = _light->read();
-  _sensorData.tempInside = _tempInside->read();
-  _sensorData.tempOutside = _tempOutside->read();
+void FreezerMote::printReadings() {
   Serial.print("Sensors<battery = ");
-  Serial.print(_sensorData.battery);
+  Serial.print(reading(FreezerSensors::Offset<Battery>::VALUE));
   Serial.print(", tempInside = ");    
-  Serial.print(_sensorData.tempInside);
+  Serial.print(reading(FreezerSensors::Offset<TempInside>::VALUE));
   Serial.print(", tempOutside = ");    
-  Serial.print(_sensorData.tempOutside);
+  Serial.print(reading(FreezerSensors::Offset<TempOutside>::VALUE));
   Serial.print(", light = ");    
-  Serial.print(_sensorData.light);
+  Serial.print(reading(FreezerSensors::Offset<Light>::VALUE));
   Serial.print(", door = ");    
-  Serial.print(_sensorData.door);
+  Serial.print(reading(FreezerSensors::Offset<Door>::VALUE));
   Serial.println(">");
   Serial.flush();
 }
 
-byte* FreezerMote::sensorData() {
-  return (byte*) &_sensorData.raw;
-}
-
 void FreezerMote::setupPorts() {
   //DDRD  = B10000011;  // set Arduino pins 2 to 7 as inputs, leaves 0 & 1 (RX & TX) as is
   //DDRB  = B00000000;  // set pins 8 to 13 as inputs
@@ -8,19 +8,14 @@
 
 #include "Arduino.h"
 #include "Sensor.h"
+#include <AdcSampler.h>
 
-class LightSensor : public Sensor {
+template <byte Pin>
+class LightSensor : public Sensor<LightSensor<Pin> > {
   public:
-    inline LightSensor(byte userPin) { 
-      _pin = userPin; 
+    inline int read() {
+      return AdcSampler::toByte(Adc.sample(Pin));
     }
-    virtual int read(); 
-  private:
-    byte _pin;
 };
 
-int LightSensor::read() {
-  return map(analogRead(_pin), 0, 1023, 0, 255);
-}
-
 #endif
@@ -7,12 +7,16 @@
 #define Mote_h
 
 #include <Arduino.h>
+#include <ConfigStore.h>
 #include <EEPROM.h>
 #include <LowPower.h>
 #include <Message.h>
+#include <PowerControl.h>
 #include <RFM69.h>
 #include <SPI.h>
 
+#define MOTE_CONFIG_VERSION  1   // bump whenever MoteConfig changes layout
+
 typedef struct MoteConfig {
   byte rfNodeId = 2;
   byte rfNetworkId= 99;
@@ -26,32 +30,41 @@ typedef struct MoteConfig {
   byte waitPeriod = 2;
 };
 
+// Base for a mote built from a compile-time SensorList. Derived (CRTP)
+// supplies calculateLedDelay(), calculateMessageLevel() and, optionally,
+// setupPorts() and printReadings(); nothing is virtual or heap allocated.
+template <class Derived, class Sensors>
 class Mote  {
   public:
     Mote(const char* name, const char* version, MoteConfig* config, bool init);
     void setup();
     void loop();  
-    virtual void measure() = 0;
+    void measure();
     
   protected:
     void blinkStatusLeds();
-    virtual unsigned int calculateLedDelay() = 0;
-    virtual byte calculateMessageLevel() = 0;
     period_t calculateWaitPeriod();
     void loadConfig();
+    bool loadLegacy();
+    inline void printReadings() { /*nothing*/ };
     void report();
-    inline virtual byte* sensorData() { return null; };
     void setupISR();
-    inline virtual void setupPorts() { /*nothing*/ };
+    inline void setupPorts() { /*nothing*/ };
     void setupRadio();
     void setupStatusIndicator();
     void sleep();
     void storeConfig();
+    inline Derived* derived() { return static_cast<Derived*>(this); }
     
     Message _outbound;
     RFM69 _radio;
+    PowerControl _power;
     
     MoteConfig* _config;
+    ConfigStore<MoteConfig, EEPROMClass> _configStore;
+    
+    Sensors _sensors;
+    byte _sensorData[MSG_DATA_LENGTH];
     
     static void wakeup();
     static volatile bool _intr;
@@ -64,21 +77,27 @@ class Mote  {
     bool _init;
 };
 
-volatile bool Mote::_intr = false;
-volatile unsigned long Mote::_lastIntrTime = 0;
+template <class Derived, class Sensors>
+volatile bool Mote<Derived, Sensors>::_intr = false;
+template <class Derived, class Sensors>
+volatile unsigned long Mote<Derived, Sensors>::_lastIntrTime = 0;
 
 
 //-----------------------------------------------------------------------------
 // API Methods
 //-----------------------------------------------------------------------------
-Mote::Mote(const char* name, const char* version, MoteConfig* config, bool init) {
+template <class Derived, class Sensors>
+Mote<Derived, Sensors>::Mote(const char* name, const char* version, MoteConfig* config, bool init) 
+  : _power(_radio), _configStore(EEPROM, MOTE_CONFIG_VERSION) {
   _name = name;
   _version = version;
   _config = config;
   _init = init;
+  static_assert(Sensors::SIZE <= MSG_DATA_LENGTH, "sensor payload exceeds message");
 }
 
-void Mote::setup() {
+template <class Derived, class Sensors>
+void Mote<Derived, Sensors>::setup() {
   Serial.print("\n[");
   Serial.print(_name);
   Serial.print(" - ");
@@ -89,7 +108,7 @@ void Mote::setup() {
   loadConfig();
   
   Serial.print("setup ports...");
-  setupPorts();
+  derived()->setupPorts();
   Serial.println("ok!");
   
   Serial.print("setup status indicators...");
@@ -100,32 +119,46 @@ void Mote::setup() {
   setupRadio();
   Serial.println("ok!");
   
+  Serial.print("setup sensors...");
+  _sensors.begin();
+  Serial.println("ok!");
+  
   Serial.print("setup isr...");
   setupISR();
   Serial.println("ok!");
   
 }
 
-void Mote::loop() {
-  noInterrupts();
+template <class Derived, class Sensors>
+void Mote<Derived, Sensors>::loop() {
+  // no critical section: the ADC noise reduction sleep and the radio both
+  // need interrupts; what the door ISR writes is read atomically instead
   measure();
   report();
-  interrupts();
   sleep();
 }
 
+template <class Derived, class Sensors>
+void Mote<Derived, Sensors>::measure() {
+  memset(_sensorData, 0, sizeof(_sensorData));
+  _sensors.measure(_sensorData);
+  derived()->printReadings();
+}
+
 //-----------------------------------------------------------------------------
 // Support Methods
 //-----------------------------------------------------------------------------
-void Mote::blinkStatusLeds() {
+template <class Derived, class Sensors>
+void Mote<Derived, Sensors>::blinkStatusLeds() {
   digitalWrite(_config->intStatusLedPin, HIGH);
   digitalWrite(_config->extStatusLedPin, HIGH);
-  delay(calculateLedDelay());  
+  delay(derived()->calculateLedDelay());  
   digitalWrite(_config->intStatusLedPin, LOW);
   digitalWrite(_config->extStatusLedPin, LOW);
 }
 
-period_t Mote::calculateWaitPeriod() {
+template <class Derived, class Sensors>
+period_t Mote<Derived, Sensors>::calculateWaitPeriod() {
   if (_config->waitPeriod < 1) {
     return SLEEP_500MS;
   } else if (_config->waitPeriod >= 1 and _config->waitPeriod < 2) {
@@ -139,31 +172,70 @@ period_t Mote::calculateWaitPeriod() {
   }
 }
 
-void Mote::loadConfig() {
+template <class Derived, class Sensors>
+void Mote<Derived, Sensors>::loadConfig() {
+  Serial.print("load config...");
   if (_init) {
     storeConfig();
   } 
-  byte configSize = sizeof(*_config);
-  byte* p = (byte*) _config;
-  for (int i = 0; i < configSize; i++) {
-    *(p + i) = EEPROM.read(i);
-    Serial.print("Config[");
-    Serial.print(i);
-    Serial.print(" of ");
-    Serial.print(configSize);
-    Serial.print("] = ");
-    Serial.println(EEPROM.read(i), DEC);
-  } 
+  if (_configStore.load(*_config)) {
+    Serial.print("slot ");
+    Serial.print(_configStore.slot());
+    Serial.print(", seq ");
+    Serial.println(_configStore.sequence());
+  } else if (loadLegacy()) {
+    Serial.println("migrated from the raw layout");
+    storeConfig();
+  } else {
+    Serial.println("invalid, storing defaults");
+    storeConfig();
+  }
 }
 
-void Mote::report() {
+// Motes flashed before ConfigStore kept MoteConfig as raw bytes at EEPROM 0.
+// Takes them when the radio identity is plausible, so an upgraded mote keeps
+// its node id and frequency; must run before the first store() overwrites
+// those cells.
+template <class Derived, class Sensors>
+bool Mote<Derived, Sensors>::loadLegacy() {
+  MoteConfig legacy;
+  byte* p = (byte*) &legacy;
+  for (byte i = 0; i < sizeof(legacy); i++) {
+    p[i] = EEPROM.read(i);
+  }
+  // slot 0 of a damaged ConfigStore record, not a raw layout
+  if (p[0] == CONFIG_STORE_MAGIC && p[1] == MOTE_CONFIG_VERSION) {
+    return false;
+  }
+  if (legacy.rfNodeId == 0 || legacy.rfNodeId == RF69_BROADCAST_ADDR
+      || legacy.rfNetworkId == 0xFF
+      || legacy.rfGatewayId == 0 || legacy.rfGatewayId == RF69_BROADCAST_ADDR
+      || legacy.rfGatewayId == legacy.rfNodeId) {
+    return false;
+  }
+  if (legacy.rfFrequency != RF69_315MHZ && legacy.rfFrequency != RF69_433MHZ
+      && legacy.rfFrequency != RF69_868MHZ && legacy.rfFrequency != RF69_915MHZ) {
+    return false;
+  }
+  if (legacy.intStatusLedPin >= NUM_DIGITAL_PINS || legacy.extStatusLedPin >= NUM_DIGITAL_PINS) {
+    return false;
+  }
+  if (legacy.loopMultiplier == 0) {
+    legacy.loopMultiplier = _config->loopMultiplier;
+  }
+  *_config = legacy;
+  return true;
+}
+
+template <class Derived, class Sensors>
+void Mote<Derived, Sensors>::report() {
   memset(&_outbound, 0, sizeof(_outbound));
-  _outbound.msg.type = calculateMessageLevel();
+  _outbound.msg.type = derived()->calculateMessageLevel();
   _outbound.msg.source = _config->rfNodeId;
   _outbound.msg.destination = 0;
   _outbound.msg.component = 0;
   _outbound.msg.rssi = 0;
-  memcpy(&_outbound.msg.data, sensorData(), MSG_DATA_LENGTH);
+  memcpy(&_outbound.msg.data, _sensorData, MSG_DATA_LENGTH);
   
   Serial.print("Report<");
   Serial.print(_outbound.msg.type);
@@ -173,32 +245,44 @@ void Mote::report() {
   Serial.print(_config->rfGatewayId);
   Serial.print(">...");
   if (_radio.sendWithRetry(_config->rfGatewayId, _outbound.raw, MSG_LENGTH)) {
-    Serial.println("ACK");
+    if (_radio.DATALEN > offsetof(AckRecord, rssi)) {   // older gateways send no rssi
+      _power.acked((int8_t) _radio.DATA[offsetof(AckRecord, rssi)]);
+    }
+    Serial.print("ACK");
   } else {
-    Serial.println("No ACK!");
+    _power.missed();
+    Serial.print("No ACK!");
   }
+  Serial.print(", power ");
+  Serial.print(_power.dBm());
+  Serial.println("dBm");
   
   blinkStatusLeds();
 }
 
-void Mote::setupISR() {
+template <class Derived, class Sensors>
+void Mote<Derived, Sensors>::setupISR() {
   attachInterrupt(1, wakeup, RISING);
 }
 
-void Mote::setupRadio() {
+template <class Derived, class Sensors>
+void Mote<Derived, Sensors>::setupRadio() {
   _radio.initialize(_config->rfFrequency, _config->rfNodeId, _config->rfNetworkId);
   _radio.setHighPower();
+  _power.begin();
   delay(1000);
 }
 
-void Mote::setupStatusIndicator() {
+template <class Derived, class Sensors>
+void Mote<Derived, Sensors>::setupStatusIndicator() {
   pinMode(_config->intStatusLedPin, OUTPUT);
   pinMode(_config->extStatusLedPin, OUTPUT);
   digitalWrite(_config->intStatusLedPin, LOW);
   digitalWrite(_config->extStatusLedPin, LOW);
 }
 
-void Mote::sleep() {
+template <class Derived, class Sensors>
+void Mote<Derived, Sensors>::sleep() {
   Serial.flush();
   _radio.sleep();
   for (int i = 0; i < _config->loopMultiplier; i++) {
@@ -210,15 +294,13 @@ void Mote::sleep() {
   }
 }
 
-void Mote::storeConfig() {
-  byte configSize = sizeof(*_config);
-  byte* p = (byte*) _config;
-  for (int i = 0; i < configSize; i++) {
-    EEPROM.write(i, *(p + i));
-  }
+template <class Derived, class Sensors>
+void Mote<Derived, Sensors>::storeConfig() {
+  _configStore.store(*_config);
 }
 
-void Mote::wakeup() {
+template <class Derived, class Sensors>
+void Mote<Derived, Sensors>::wakeup() {
   _intr = true;
   _lastIntrTime = millis();
 }
@@ -6,10 +6,21 @@
 #ifndef Sensor_h
 #define Sensor_h
 
+#include "Arduino.h"
+
+// Static (CRTP) base for sensors: Derived supplies int read(), and the
+// sensor contributes its low-order SIZE bytes to the payload. There are no
+// virtual calls, so a sensor with its pin as a template argument takes no
+// RAM at all and read() inlines into the measure cycle.
+template <class Derived, byte Size = 1>
 class Sensor {
   public:
-    inline virtual void begin(){ /*nothing*/ };
-    virtual int read() = 0;
+    enum { SIZE = Size };
+    inline void begin() { /*nothing*/ };
+    inline void measure(byte* data) {
+      int value = static_cast<Derived*>(this)->read();
+      memcpy(data, &value, SIZE);
+    }
 };
 
 #endif
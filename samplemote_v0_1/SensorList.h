@@ -0,0 +1,65 @@
+/*
+  SensorList.h - Compile-time list of the sensors on a mote
+  Created by Jon R. Brule, October 19, 2026.
+  Released into the public domain.
+*/
+#ifndef SensorList_h
+#define SensorList_h
+
+#include "Arduino.h"
+
+// Byte offset of sensor S within the payload laid out by a SensorList.
+template <typename S, typename... Sensors> 
+struct SensorOffset;
+
+template <typename S, typename... Tail> 
+struct SensorOffset<S, S, Tail...> {
+  enum { VALUE = 0 };
+};
+
+template <typename S, typename Head, typename... Tail> 
+struct SensorOffset<S, Head, Tail...> {
+  enum { VALUE = Head::SIZE + SensorOffset<S, Tail...>::VALUE };
+};
+
+// A mote's sensors, stored inline in list order. The payload layout follows
+// the same order: each sensor writes Sensor::SIZE bytes and SIZE is the
+// total. begin() and measure() recurse at compile time, so the measure
+// cycle unrolls into straight-line code with no indirect calls.
+template <typename... Sensors> 
+class SensorList;
+
+template <> 
+class SensorList<> {
+  public:
+    enum { SIZE = 0 };
+    inline void begin() { /*nothing*/ };
+    inline void measure(byte* data) { /*nothing*/ };
+};
+
+template <typename Head, typename... Tail>
+class SensorList<Head, Tail...> {
+  public:
+    enum { SIZE = Head::SIZE + SensorList<Tail...>::SIZE };
+    
+    template <typename S> 
+    struct Offset {
+      enum { VALUE = SensorOffset<S, Head, Tail...>::VALUE };
+    };
+    
+    inline void begin() {
+      _head.begin();
+      _tail.begin();
+    }
+    
+    inline void measure(byte* data) {
+      _head.measure(data);
+      _tail.measure(data + Head::SIZE);
+    }
+    
+  private:
+    Head _head;
+    SensorList<Tail...> _tail;
+};
+
+#endif
@@ -8,23 +8,15 @@
 
 #include "Arduino.h"
 #include "Sensor.h"
+#include <AdcSampler.h>
 
-class TemperatureSensor : public Sensor {
+template <byte Pin, unsigned int Millivolts>
+class TemperatureSensor : public Sensor<TemperatureSensor<Pin, Millivolts> > {
   public:
-    inline TemperatureSensor(byte userPin, int voltage) { 
-      _pin = userPin;
-      _voltage = voltage;
+    inline int read() {
+      int tempMillivolts = AdcSampler::toMillivolts(Adc.sample(Pin), Millivolts);
+      return (tempMillivolts - 500) / 10;
     }
-    virtual int read(); 
-  private:
-    byte _pin;
-    int _voltage;
 };
 
-int TemperatureSensor::read() {
-  int tempRaw = analogRead(_pin);
-  float tempVolts = (((float)tempRaw / 1024) * _voltage);
-  return int((tempVolts - 0.5) / 0.01);
-}
-
 #endif
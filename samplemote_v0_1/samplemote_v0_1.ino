@@ -17,6 +17,8 @@
 ----------------------------------------------------------------------------- */
 
 #include "FreezerMote.h"
+#include <AdcSampler.h>
+#include <ConfigStore.h>
 #include <EEPROM.h>
 #include <LowPower.h>
 #include <Message.h>
@@ -29,17 +31,16 @@
 #define BAUD_RATE  9600
 
 FreezerMoteConfig config;
-FreezerMote* mote;
+FreezerMote mote(MOTE, VERSION, &config, true);
 
 void setup() {
   Serial.begin(BAUD_RATE);
   
   config.rfNodeId = 9;
   
-  mote = new FreezerMote(MOTE, VERSION, &config, true);
-  mote->setup();
+  mote.setup();
 }
 
 void loop() {
-  mote->loop();
+  mote.loop();
 }
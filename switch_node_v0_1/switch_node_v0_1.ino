@@ -13,6 +13,7 @@
 ----------------------------------------------------------------------------- */
 
 #include <JeeLib.h>
+#include <TaskScheduler.h>
 #include <avr/sleep.h>
 
 #define VERSION "v0.1"
@@ -27,7 +28,7 @@
 #define LED_DELAY       500
 #define VDD_RATIO       1.622
 
-#define MEASURE_PERIOD  100   // how often to measure, in tenths of seconds
+#define MEASURE_PERIOD  10000 // how often to measure, in milliseconds
 #define RETRY_PERIOD    10    // how soon to retry if ACK didn't come in
 #define RETRY_LIMIT     5     // maximum number of times to retry
 #define ACK_TIME        10    // number of milliseconds to wait for an ack
@@ -52,7 +53,7 @@
 
 enum { MEASURE, REPORT, TASK_END };
 
-Scheduler scheduler(TASK_END);
+TaskScheduler scheduler(TASK_END);
 
 static byte reportCount;    // count up until next report, i.e. packet send
 
@@ -110,7 +111,8 @@ void setup() {
     rf12_sleep(RF12_SLEEP);
   
     reportCount = REPORT_EVERY;     // report right away for easy debugging
-    scheduler.timer(MEASURE, 0);    // start the measurement loop going
+    scheduler.setSleep(sleepUntil); // power down between tasks
+    scheduler.every(MEASURE, MEASURE_PERIOD, NULL, 0);  // measure now and periodically
   
     sensorData.zone = SWITCH_ZONE;
     sensorData.type = DATA_TYPE;
@@ -130,15 +132,12 @@ void loop() {
     switch (scheduler.pollWaiting()) {
 
         case MEASURE:
-            // reschedule these measurements periodically
-            scheduler.timer(MEASURE, MEASURE_PERIOD);
-    
             doMeasure();
 
             // every so often, a report needs to be sent out
             if (++reportCount >= REPORT_EVERY) {
                 reportCount = 0;
-                scheduler.timer(REPORT, 0);
+                scheduler.after(REPORT, 0);
             }
             break;
             
@@ -167,6 +166,20 @@ static void blink_rf_led(byte pin, int delay_ms) {
     digitalWrite(pin, LOW);
 }
 
+//------------------------------------------------------------------------------
+// powers down until the scheduler's next deadline, returning false if an
+// interrupt cut the sleep short
+//
+static bool sleepUntil(unsigned long deadline) {
+    long left = (long) (deadline - millis());
+    while (left >= 16) {    // the shortest watchdog period
+        if (!Sleepy::loseSomeTime(left > 60000 ? 60000 : left))
+            return false;
+        left = (long) (deadline - millis());
+    }
+    return true;
+}
+
 //------------------------------------------------------------------------------
 // flushes the serial port
 //